@@ -0,0 +1,142 @@
+#ifndef RKALLOCATIONCOUNTER
+
+#define RKALLOCATIONCOUNTER
+
+#include <array>
+#include <cstddef>
+
+#include "../src/rk_statistics.hpp"
+
+
+
+
+/**
+ *
+ * Counts every heap allocation of the program. Eigen allocates with malloc directly (not with operator new), hence we replace
+ * malloc and its relatives themselves and forward to the implementations of glibc. Only include this in one translation unit
+ * of a benchmark or diagnostic program (glibc only).
+ *
+ */
+namespace AllocationCounter{
+
+    inline unsigned long allocations = 0;
+    inline unsigned long allocatedBytes = 0;
+
+}
+
+
+extern "C" {
+
+    void *__libc_malloc(std::size_t size);
+    void *__libc_calloc(std::size_t count, std::size_t size);
+    void *__libc_realloc(void *memory, std::size_t size);
+    void *__libc_memalign(std::size_t alignment, std::size_t size);
+
+    void *malloc(std::size_t size){
+        AllocationCounter::allocations++;
+        AllocationCounter::allocatedBytes += size;
+        return __libc_malloc(size);
+    }
+
+    void *calloc(std::size_t count, std::size_t size){
+        AllocationCounter::allocations++;
+        AllocationCounter::allocatedBytes += count*size;
+        return __libc_calloc(count, size);
+    }
+
+    void *realloc(void *memory, std::size_t size){
+        AllocationCounter::allocations++;
+        AllocationCounter::allocatedBytes += size;
+        return __libc_realloc(memory, size);
+    }
+
+    // used by operator new for over-aligned types (e.g. fixed size Eigen vectors)
+    void *aligned_alloc(std::size_t alignment, std::size_t size){
+        AllocationCounter::allocations++;
+        AllocationCounter::allocatedBytes += size;
+        return __libc_memalign(alignment, size);
+    }
+
+    void *memalign(std::size_t alignment, std::size_t size){
+        return aligned_alloc(alignment, size);
+    }
+
+    int posix_memalign(void **memory, std::size_t alignment, std::size_t size){
+        *memory = aligned_alloc(alignment, size);
+        return *memory == nullptr ? 12 : 0; // ENOMEM
+    }
+
+}
+
+
+
+
+
+/**
+ *
+ * Instrumentation policy which, in addition to the SolverStatistics of StatisticsInstrumentation, counts the heap allocations
+ * in every phase. Phases nest (Phase::Step contains Phase::Stages and Phase::Rhs), every phase is counted on its own, hence
+ * the allocations of Phase::Step minus those of Phase::Rhs are the ones of the integrator itself.
+ *
+ */
+class AllocationInstrumentation {
+
+    public:
+        struct PhaseAllocations {
+            unsigned long allocations = 0;
+            unsigned long bytes = 0;
+        };
+
+        class Timer {
+            public:
+                Timer(StatisticsInstrumentation &statistics, Phase phase, PhaseAllocations &accumulator)
+                    : wall(statistics.time(phase)), accumulator(accumulator),
+                      allocations(AllocationCounter::allocations), bytes(AllocationCounter::allocatedBytes){
+                }
+
+                ~Timer(){
+                    accumulator.allocations += AllocationCounter::allocations - allocations;
+                    accumulator.bytes += AllocationCounter::allocatedBytes - bytes;
+                }
+
+            private:
+                StatisticsInstrumentation::Timer wall;
+                PhaseAllocations &accumulator;
+                unsigned long allocations;
+                unsigned long bytes;
+        };
+
+        void count(Event event, unsigned long n = 1){
+            statisticsPolicy.count(event, n);
+        }
+
+        Timer time(Phase phase){
+            return Timer(statisticsPolicy, phase, phases[static_cast<unsigned int>(phase)]);
+        }
+
+        void reset(){
+            statisticsPolicy.reset();
+            phases = {};
+        }
+
+        const SolverStatistics &statistics() const {
+            return statisticsPolicy.statistics();
+        }
+
+        /**
+         * @return the allocations of all measurements of the given phase
+         */
+        const PhaseAllocations &allocations(Phase phase) const {
+            return phases[static_cast<unsigned int>(phase)];
+        }
+
+    private:
+        StatisticsInstrumentation statisticsPolicy;
+        // one entry per Phase
+        std::array<PhaseAllocations, 5> phases;
+};
+
+
+
+
+#endif
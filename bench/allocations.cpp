@@ -0,0 +1,337 @@
+/**
+ *
+ * Heap allocation accounting of the stepping loop, see bench/README.md.
+ *
+ * Every built-in method is run with fixed size and dynamic size states and the allocations per step are reported, split into
+ * the allocations of the integrator itself and those of the right hand side. The explicit integrators (with fixed and
+ * adaptive step size), the symplectic, Runge-Kutta-Nystroem, Adams and Runge-Kutta-Chebyshev integrators must not allocate in their steps, the program fails (exit code 1) if they do. The
+ * implicit integrators (Runge-Kutta, BDF and the stiffness switching integrator) are only reported, their Newton iteration works on dynamic size matrices.
+ *
+ */
+
+
+
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <Eigen/Dense>
+#include "../src/rk_chebyshev.hpp"
+#include "../src/rk_implementer.hpp"
+#include "../src/rk_multistep.hpp"
+#include "../src/rk_solvers.hpp"
+#include "../src/rk_switching.hpp"
+#include "allocation_counter.hpp"
+
+
+
+// an output which does not store anything, such that only the steps are counted
+struct DiscardOutput {
+    void initialize(unsigned int, unsigned int){
+    }
+    template<typename State>
+    void push(double, const State &){
+    }
+    void finalize(){
+    }
+};
+
+
+// the allocations of the steps of one run
+struct StepAllocations {
+    double integrator;
+    double rhs;
+};
+
+
+template<typename Instrumentation>
+StepAllocations perStep(const Instrumentation &policy, unsigned int steps){
+    const AllocationInstrumentation::PhaseAllocations &step = policy.allocations(Phase::Step);
+    const AllocationInstrumentation::PhaseAllocations &rhs = policy.allocations(Phase::Rhs);
+    return {static_cast<double>(step.allocations - rhs.allocations)/steps, static_cast<double>(rhs.allocations)/steps};
+}
+
+
+void report(const std::string &method, const std::string &stepType, const StepAllocations &allocations, bool checked){
+    std::cout << std::left << std::setw(28) << method << std::setw(12) << stepType << std::setw(18) << allocations.integrator
+              << std::setw(12) << allocations.rhs << (checked ? (allocations.integrator == 0 ? "ok" : "FAILED") : "not checked") << std::endl;
+}
+
+
+/**
+ * Runs all explicit methods for one Step type
+ *
+ * @return false if an integrator allocated in a step
+ */
+template<typename Step>
+bool explicitMethods(const std::string &stepType, unsigned int dimension){
+
+    const unsigned int steps = 1000;
+    Step y0 = Step::Ones(dimension);
+    auto f = [] (const Step &y) -> Step {
+        return -0.5*y;
+    };
+
+    bool success = true;
+    for(const ButcherTableau &tableau : ExplicitRKTableaus::all()){
+        ExplicitRungeKuttaIntegrator<Step, AllocationInstrumentation> integrator(tableau);
+        DiscardOutput output;
+        integrator.solve(f, 1.0, y0, steps, output);
+
+        StepAllocations allocations = perStep(integrator.instrumentationPolicy(), steps);
+        report(tableau.name, stepType, allocations, true);
+        success = success && allocations.integrator == 0;
+    }
+    return success;
+}
+
+
+/**
+ * Runs all embedded methods with adaptive step size and dense output for one Step type
+ *
+ * @return false if an integrator allocated in a step
+ */
+template<typename Step>
+bool adaptiveMethods(const std::string &stepType, unsigned int dimension){
+
+    Step y0 = Step::Ones(dimension);
+    auto f = [] (const Step &y) -> Step {
+        return -0.5*y;
+    };
+    std::vector<double> times;
+    for(int i = 0; i <= 100; i++){
+        times.push_back(0.1*i);
+    }
+
+    bool success = true;
+    for(const EmbeddedButcherTableau &tableau : EmbeddedRKTableaus::all()){
+        AdaptiveRungeKuttaIntegrator<Step, AllocationInstrumentation> integrator(tableau, 1e-10, 1e-12);
+        DiscardOutput output;
+        integrator.solve(f, times, y0, output);
+
+        unsigned int steps = integrator.statistics().acceptedSteps + integrator.statistics().rejectedSteps;
+        StepAllocations allocations = perStep(integrator.instrumentationPolicy(), steps);
+        report(tableau.name, stepType, allocations, true);
+        success = success && allocations.integrator == 0;
+    }
+    return success;
+}
+
+
+/**
+ * Runs all symplectic methods for one Step type of the positions and momenta
+ *
+ * @return false if an integrator allocated in a step
+ */
+template<typename Step>
+bool symplecticMethods(const std::string &stepType, unsigned int dimension){
+
+    const unsigned int steps = 1000;
+    Step q0 = Step::Ones(dimension);
+    Step p0 = Step::Zero(dimension);
+    auto velocity = [] (const Step &p) -> Step {
+        return p;
+    };
+    auto force = [] (const Step &q) -> Step {
+        return -q;
+    };
+
+    bool success = true;
+    for(const PartitionedButcherTableau &tableau : SymplecticTableaus::all()){
+        PartitionedRungeKuttaIntegrator<Step, AllocationInstrumentation> integrator(tableau);
+        DiscardOutput output;
+        integrator.solve(velocity, force, 1.0, q0, p0, steps, output);
+
+        StepAllocations allocations = perStep(integrator.instrumentationPolicy(), steps);
+        report(tableau.name, stepType, allocations, true);
+        success = success && allocations.integrator == 0;
+    }
+    return success;
+}
+
+
+/**
+ * Runs all Runge-Kutta-Nystroem methods for one Step type of the positions and velocities, the embedded pairs with adaptive
+ * step size
+ *
+ * @return false if an integrator allocated in a step
+ */
+template<typename Step>
+bool nystromMethods(const std::string &stepType, unsigned int dimension){
+
+    const unsigned int steps = 1000;
+    Step q0 = Step::Ones(dimension);
+    Step v0 = Step::Zero(dimension);
+    auto g = [] (const Step &q) -> Step {
+        return -q;
+    };
+
+    bool success = true;
+    for(const RungeKuttaNystromTableau &tableau : RKNTableaus::all()){
+        RungeKuttaNystromIntegrator<Step, AllocationInstrumentation> integrator(tableau, 1e-10, 1e-12);
+        DiscardOutput output;
+        StepAllocations allocations;
+        if(tableau.e.size() == 0){
+            integrator.solve(g, 1.0, q0, v0, steps, output);
+            allocations = perStep(integrator.instrumentationPolicy(), steps);
+        }else{
+            integrator.solveAdaptive(g, 10.0, q0, v0, output);
+            allocations = perStep(integrator.instrumentationPolicy(), integrator.statistics().acceptedSteps + integrator.statistics().rejectedSteps);
+        }
+        report(tableau.name + " RKN", stepType, allocations, true);
+        success = success && allocations.integrator == 0;
+    }
+    return success;
+}
+
+
+/**
+ * Runs the Adams method for one Step type. Its starting values are computed once per solve with a Runge-Kutta integrator,
+ * which allocates its result, hence only the allocations of the steps a longer run makes in addition are counted.
+ *
+ * @return false if the integrator allocated in a step
+ */
+template<typename Step>
+bool adamsMethod(const std::string &stepType, unsigned int dimension){
+
+    Step y0 = Step::Ones(dimension);
+    auto f = [] (const Step &y) -> Step {
+        return -0.5*y;
+    };
+
+    AdamsIntegrator<Step, AllocationInstrumentation> integrator(1e-10, 1e-12);
+    DiscardOutput output;
+    integrator.solve(f, 1.0, y0, output);
+    AllocationInstrumentation shortRun = integrator.instrumentationPolicy();
+    unsigned int shortSteps = integrator.statistics().acceptedSteps + integrator.statistics().rejectedSteps;
+
+    integrator.solve(f, 10.0, y0, output);
+    unsigned int steps = integrator.statistics().acceptedSteps + integrator.statistics().rejectedSteps - shortSteps;
+    StepAllocations longAllocations = perStep(integrator.instrumentationPolicy(), steps);
+    StepAllocations shortAllocations = perStep(shortRun, steps);
+    StepAllocations allocations = {longAllocations.integrator - shortAllocations.integrator, longAllocations.rhs - shortAllocations.rhs};
+
+    report("Adams", stepType, allocations, true);
+    return allocations.integrator == 0;
+}
+
+
+/**
+ * Runs the Runge-Kutta-Chebyshev methods RKC, ROCK2 and ROCK4 for one Step type on a problem stiff enough for several stages
+ * per step
+ *
+ * @return false if an integrator allocated in a step
+ */
+template<typename Step>
+bool chebyshevMethod(const std::string &stepType, unsigned int dimension){
+
+    Step y0 = Step::Ones(dimension);
+    auto f = [] (const Step &y) -> Step {
+        return -500*y;
+    };
+
+    RungeKuttaChebyshevIntegrator<Step, AllocationInstrumentation> integrator(1e-6, 1e-8);
+    DiscardOutput output;
+    integrator.solve(f, 1.0, y0, output);
+    unsigned int steps = integrator.statistics().acceptedSteps + integrator.statistics().rejectedSteps;
+    StepAllocations allocations = perStep(integrator.instrumentationPolicy(), steps);
+
+    report("RKC", stepType, allocations, true);
+    bool success = allocations.integrator == 0;
+
+    for(unsigned int order : {2, 4}){
+        ROCKIntegrator<Step, AllocationInstrumentation> rock(order, 1e-6, 1e-8);
+        rock.solve(f, 1.0, y0, output);
+        steps = rock.statistics().acceptedSteps + rock.statistics().rejectedSteps;
+        allocations = perStep(rock.instrumentationPolicy(), steps);
+
+        report("ROCK" + std::to_string(order), stepType, allocations, true);
+        success = success && allocations.integrator == 0;
+    }
+    return success;
+}
+
+
+/**
+ * Runs all implicit methods for one Step type
+ */
+template<typename Step>
+void implicitMethods(const std::string &stepType, unsigned int dimension){
+
+    const unsigned int steps = 100;
+    Step y0 = Step::Ones(dimension);
+    auto f = [] (const Step &y) -> Step {
+        return -0.5*y;
+    };
+    auto J = [dimension] (const Step &) -> Eigen::MatrixXd {
+        return -0.5*Eigen::MatrixXd::Identity(dimension, dimension);
+    };
+
+    for(const ButcherTableau &tableau : ImplicitRKTableaus::all()){
+        ImplicitRungeKuttaIntegrator<Step, AllocationInstrumentation> integrator(tableau);
+        DiscardOutput output;
+        integrator.solve(f, J, 1.0, y0, steps, output);
+
+        report(tableau.name, stepType, perStep(integrator.instrumentationPolicy(), steps), false);
+    }
+
+    BDFIntegrator<Step, AllocationInstrumentation> integrator(1e-8, 1e-10);
+    DiscardOutput output;
+    integrator.solve(f, J, 10.0, y0, output);
+    unsigned int bdfSteps = integrator.statistics().acceptedSteps + integrator.statistics().rejectedSteps;
+    report("BDF", stepType, perStep(integrator.instrumentationPolicy(), bdfSteps), false);
+
+    StiffnessSwitchingIntegrator<Step, AllocationInstrumentation> switching(1e-8, 1e-10);
+    switching.solve(f, J, 10.0, y0, output);
+    unsigned int switchingSteps = switching.statistics().acceptedSteps + switching.statistics().rejectedSteps;
+    report("Stiffness switching", stepType, perStep(switching.instrumentationPolicy(), switchingSteps), false);
+}
+
+
+
+int main() {
+
+    /**
+     * Usage: allocations
+     */
+
+    std::cout << std::left << std::setw(28) << "method" << std::setw(12) << "step type" << std::setw(18) << "integrator/step"
+              << std::setw(12) << "rhs/step" << "result" << std::endl;
+
+    bool success = true;
+    success = explicitMethods<Eigen::Vector2d>("Vector2d", 2) && success;
+    success = explicitMethods<Eigen::Vector4d>("Vector4d", 4) && success;
+    success = explicitMethods<Eigen::Matrix<double, 8, 1>>("Vector8d", 8) && success;
+    success = explicitMethods<Eigen::VectorXd>("VectorXd", 100) && success;
+
+    success = adaptiveMethods<Eigen::Vector2d>("Vector2d", 2) && success;
+    success = adaptiveMethods<Eigen::Vector4d>("Vector4d", 4) && success;
+    success = adaptiveMethods<Eigen::VectorXd>("VectorXd", 100) && success;
+
+    success = symplecticMethods<Eigen::Vector2d>("Vector2d", 2) && success;
+    success = symplecticMethods<Eigen::Vector4d>("Vector4d", 4) && success;
+    success = symplecticMethods<Eigen::VectorXd>("VectorXd", 100) && success;
+
+    success = nystromMethods<Eigen::Vector2d>("Vector2d", 2) && success;
+    success = nystromMethods<Eigen::Vector4d>("Vector4d", 4) && success;
+    success = nystromMethods<Eigen::VectorXd>("VectorXd", 100) && success;
+
+    success = adamsMethod<Eigen::Vector2d>("Vector2d", 2) && success;
+    success = adamsMethod<Eigen::Vector4d>("Vector4d", 4) && success;
+    success = adamsMethod<Eigen::VectorXd>("VectorXd", 100) && success;
+
+    success = chebyshevMethod<Eigen::Vector2d>("Vector2d", 2) && success;
+    success = chebyshevMethod<Eigen::Vector4d>("Vector4d", 4) && success;
+    success = chebyshevMethod<Eigen::VectorXd>("VectorXd", 100) && success;
+
+    implicitMethods<Eigen::VectorXd>("VectorXd", 100);
+
+    if(!success){
+        std::cerr << "The explicit, symplectic, Runge-Kutta-Nystroem, Adams or Runge-Kutta-Chebyshev integrators allocate memory in their steps" << std::endl;
+        return 1;
+    }
+    std::cerr << "The explicit, symplectic, Runge-Kutta-Nystroem, Adams and Runge-Kutta-Chebyshev integrators do not allocate memory in their steps" << std::endl;
+    return 0;
+
+}
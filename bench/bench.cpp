@@ -0,0 +1,247 @@
+/**
+ *
+ * Benchmark of the explicit Runge-Kutta integrator, see bench/README.md.
+ *
+ * For every method of ExplicitRKTableaus, every state dimension and every Step type it measures
+ *
+ *  - solve returning the std::vector of all states
+ *  - solve with an output which discards all states, i.e. the cost of the integration steps alone
+ *
+ * and reports nanoseconds per step, RHS evaluations per second and heap allocations per step as JSON. If the hardware
+ * performance counters can be read, a separate instrumented run additionally reports cycles, instructions, IPC, cache and
+ * branch misses and the memory traffic per step for a whole step, the stage assembly and the RHS.
+ *
+ */
+
+
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <Eigen/Dense>
+#include "../src/rk_implementer.hpp"
+#include "../src/rk_solvers.hpp"
+#include "allocation_counter.hpp"
+#include "perf_counters.hpp"
+
+
+
+// an output which does not store anything, used to time the integration steps alone
+struct DiscardOutput {
+    void initialize(unsigned int, unsigned int){
+    }
+    template<typename State>
+    void push(double, const State &){
+    }
+    void finalize(){
+    }
+};
+
+
+// a cheap right hand side, linear in every component, such that the cost of the integrator itself dominates
+template<typename Step>
+struct LinearDecay {
+    unsigned long *calls;
+
+    Step operator()(const Step &y) const {
+        (*calls)++;
+        return -0.5*y;
+    }
+};
+
+
+struct Result {
+    std::string method;
+    std::string stepType;
+    std::string output;
+    unsigned long dimension;
+    unsigned long steps;
+    double nsPerStep;
+    double rhsCallsPerSecond;
+    double allocationsPerStep;
+    double bytesPerStep;
+    // the hardware counters of every measured phase and the number of steps of the instrumented run, empty if not available
+    std::vector<std::pair<std::string, PerfCounters::Values>> counters;
+    unsigned long counterSteps;
+};
+
+
+/**
+ * Runs the integration repeatedly (at least minimalTime seconds) and keeps the fastest run
+ */
+template<typename Step, typename Run>
+Result measure(const ButcherTableau &tableau, const std::string &stepType, const std::string &output, unsigned long dimension, unsigned long steps, unsigned long &calls, Run run){
+
+    double best = 1e300;
+    double total = 0;
+    unsigned long bestCalls = 0, bestAllocations = 0, bestBytes = 0;
+    const double minimalTime = 0.2;
+
+    for(int repetition = 0; repetition < 100 && (repetition < 2 || total < minimalTime); repetition++){
+        calls = 0;
+        unsigned long allocationsBefore = AllocationCounter::allocations, bytesBefore = AllocationCounter::allocatedBytes;
+
+        auto start = std::chrono::steady_clock::now();
+        run();
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        total += elapsed;
+        if(elapsed < best){
+            best = elapsed;
+            bestCalls = calls;
+            bestAllocations = AllocationCounter::allocations - allocationsBefore;
+            bestBytes = AllocationCounter::allocatedBytes - bytesBefore;
+        }
+    }
+
+    return {tableau.name, stepType, output, dimension, steps, 1e9*best/steps, bestCalls/best,
+            static_cast<double>(bestAllocations)/steps, static_cast<double>(bestBytes)/steps, {}, 0};
+}
+
+
+/**
+ * Benchmarks all methods for one Step type and dimension
+ */
+template<typename Step>
+void benchmark(const std::string &stepType, unsigned long dimension, std::vector<Result> &results){
+
+    // the number of steps is chosen such that every run does about the same amount of work
+    unsigned long steps = std::max(10ul, 20000000ul / (dimension * 4));
+
+    Step y0 = Step::Ones(dimension);
+    unsigned long calls = 0;
+    LinearDecay<Step> f{&calls};
+
+    for(const ButcherTableau &tableau : ExplicitRKTableaus::all()){
+        ExplicitRungeKuttaIntegrator<Step> integrator(tableau);
+
+        // storing all states of a huge system does not fit into memory
+        if(dimension*(steps + 1) <= 100000000ul){
+            results.push_back(measure<Step>(tableau, stepType, "vector", dimension, steps, calls, [&] () {
+                std::vector<Step> states = integrator.solve(f, 1.0, y0, steps);
+            }));
+        }
+
+        results.push_back(measure<Step>(tableau, stepType, "discard", dimension, steps, calls, [&] () {
+            DiscardOutput output;
+            integrator.solve(f, 1.0, y0, steps, output);
+        }));
+
+        Result &last = results.back();
+        std::cerr << last.method << ", " << last.stepType << ", n = " << last.dimension << ": " << last.nsPerStep << " ns/step, "
+                  << last.rhsCallsPerSecond << " RHS calls/s, " << last.allocationsPerStep << " allocations/step";
+
+        // reading the counters costs system calls in every phase, hence a separate (and shorter) run
+        if(PerfCounterGroup::instance().available()){
+            ExplicitRungeKuttaIntegrator<Step, PerfInstrumentation> instrumented(tableau);
+            DiscardOutput output;
+            last.counterSteps = std::min(steps, 100000ul);
+            instrumented.solve(f, 1.0, y0, last.counterSteps, output);
+
+            const PerfInstrumentation &policy = instrumented.instrumentationPolicy();
+            last.counters = {{"step", policy.counters(Phase::Step).values},
+                             {"stages", policy.counters(Phase::Stages).values},
+                             {"rhs", policy.counters(Phase::Rhs).values}};
+
+            const PerfCounters::Values &step = last.counters[0].second;
+            std::cerr << ", IPC " << static_cast<double>(step[PerfCounters::Instructions])/step[PerfCounters::Cycles];
+        }
+        std::cerr << std::endl;
+    }
+}
+
+
+std::string countersToJson(const Result &result){
+    if(result.counters.empty()){
+        return "null";
+    }
+
+    const PerfCounterGroup &group = PerfCounterGroup::instance();
+    std::ostringstream json;
+    json << "{";
+    for(std::size_t p = 0; p < result.counters.size(); p++){
+        const PerfCounters::Values &values = result.counters[p].second;
+        json << (p > 0 ? ", " : "") << "\"" << result.counters[p].first << "\": {";
+
+        // all values per step, null if the CPU does not provide the counter
+        auto perStep = [&] (PerfCounters::Counter counter, double factor = 1) {
+            std::ostringstream value;
+            if(group.available(counter)){
+                value << factor*values[counter]/result.counterSteps;
+            }else{
+                value << "null";
+            }
+            return value.str();
+        };
+        for(unsigned int i = 0; i < PerfCounters::NumberOfCounters; i++){
+            json << "\"" << PerfCounters::names[i] << "\": " << perStep(static_cast<PerfCounters::Counter>(i)) << ", ";
+        }
+
+        json << "\"ipc\": ";
+        if(group.available(PerfCounters::Instructions) && values[PerfCounters::Cycles] > 0){
+            json << static_cast<double>(values[PerfCounters::Instructions])/values[PerfCounters::Cycles];
+        }else{
+            json << "null";
+        }
+        // every last level cache miss moves one cache line from memory
+        json << ", \"memory_bytes\": " << perStep(PerfCounters::LlcMisses, PerfCounters::cacheLineBytes) << "}";
+    }
+    json << "}";
+    return json.str();
+}
+
+
+std::string toJson(const std::vector<Result> &results){
+    std::ostringstream json;
+    json << "[\n";
+    for(std::size_t i = 0; i < results.size(); i++){
+        const Result &r = results[i];
+        json << "  {\"method\": \"" << r.method << "\", \"step_type\": \"" << r.stepType << "\", \"output\": \"" << r.output
+             << "\", \"dimension\": " << r.dimension << ", \"steps\": " << r.steps << ", \"ns_per_step\": " << r.nsPerStep
+             << ", \"rhs_calls_per_second\": " << r.rhsCallsPerSecond << ", \"allocations_per_step\": " << r.allocationsPerStep
+             << ", \"bytes_allocated_per_step\": " << r.bytesPerStep << ", \"counters\": " << countersToJson(r) << "}"
+             << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    json << "]\n";
+    return json.str();
+}
+
+
+int main(int argc, char **argv) {
+
+    /**
+     * Usage: bench [output file] [largest dimension]
+     */
+
+    std::string filename = argc > 1 ? argv[1] : "bench.json";
+    unsigned long largestDimension = argc > 2 ? std::stoul(argv[2]) : 10000000ul;
+
+    std::vector<Result> results;
+
+    if(!PerfCounterGroup::instance().available()){
+        std::cerr << "Hardware performance counters are not available (" << PerfCounterGroup::instance().error()
+                  << "), only wall time and allocations are measured" << std::endl;
+    }
+
+    // fixed size against dynamic size states for small systems
+    benchmark<Eigen::Vector2d>("Vector2d", 2, results);
+    benchmark<Eigen::Vector4d>("Vector4d", 4, results);
+    benchmark<Eigen::Matrix<double, 8, 1>>("Vector8d", 8, results);
+
+    for(unsigned long dimension : {2ul, 4ul, 8ul, 100ul, 1000ul, 10000ul, 100000ul, 1000000ul, 10000000ul}){
+        if(dimension <= largestDimension){
+            benchmark<Eigen::VectorXd>("VectorXd", dimension, results);
+        }
+    }
+
+    std::ofstream file(filename);
+    file << toJson(results);
+    std::cerr << "Results written to " << filename << std::endl;
+
+}
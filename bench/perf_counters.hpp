@@ -0,0 +1,242 @@
+#ifndef RKPERFCOUNTERS
+
+#define RKPERFCOUNTERS
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "../src/rk_statistics.hpp"
+
+
+
+
+/**
+ *
+ * Hardware performance counters (Linux perf_event_open) for the benchmark. Only the calling thread is counted and only in
+ * user space, which is allowed with the default perf_event_paranoid setting of 2. On machines without a PMU (many virtual
+ * machines and containers) or if counting is forbidden the counters are simply reported as unavailable.
+ *
+ */
+namespace PerfCounters {
+
+    enum Counter {
+        Cycles,
+        Instructions,
+        L1Misses,
+        LlcMisses,
+        BranchMisses,
+        NumberOfCounters
+    };
+
+    // the names used in the JSON output
+    const std::array<const char*, NumberOfCounters> names = {"cycles", "instructions", "l1_misses", "llc_misses", "branch_misses"};
+
+    using Values = std::array<std::uint64_t, NumberOfCounters>;
+
+    // the size of a cache line, used to estimate the memory traffic from the last level cache misses
+    const unsigned int cacheLineBytes = 64;
+
+}
+
+
+
+
+/**
+ *
+ * All counters of PerfCounters opened as one group, such that they are always scheduled together and read at once.
+ * Counters the CPU does not support are left out, if not even the cycles can be counted the group is unavailable.
+ *
+ */
+class PerfCounterGroup {
+
+    public:
+        PerfCounterGroup(){
+            fds.fill(-1);
+
+            const std::array<std::pair<std::uint32_t, std::uint64_t>, PerfCounters::NumberOfCounters> events = {{
+                {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+                {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+                {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+                {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+                {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES}
+            }};
+
+            for(unsigned int i = 0; i < events.size(); i++){
+                perf_event_attr attributes;
+                std::memset(&attributes, 0, sizeof(attributes));
+                attributes.size = sizeof(attributes);
+                attributes.type = events[i].first;
+                attributes.config = events[i].second;
+                attributes.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID;
+                attributes.exclude_kernel = 1;
+                attributes.exclude_hv = 1;
+                // the leader starts disabled and enables the whole group once it is complete
+                attributes.disabled = leader < 0 ? 1 : 0;
+
+                int fd = syscall(SYS_perf_event_open, &attributes, 0, -1, leader, 0);
+                if(fd < 0){
+                    if(leader < 0){
+                        reason = std::string("perf_event_open failed: ") + std::strerror(errno);
+                        return;
+                    }
+                    continue;
+                }
+                if(leader < 0){
+                    leader = fd;
+                }
+                fds[i] = fd;
+                ioctl(fd, PERF_EVENT_IOC_ID, &ids[i]);
+            }
+
+            ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+
+        ~PerfCounterGroup(){
+            for(int fd : fds){
+                if(fd >= 0){
+                    close(fd);
+                }
+            }
+        }
+
+        PerfCounterGroup(const PerfCounterGroup&) = delete;
+        PerfCounterGroup &operator=(const PerfCounterGroup&) = delete;
+
+        /**
+         * @return the group of the calling thread, it is opened on first use
+         */
+        static PerfCounterGroup &instance(){
+            static thread_local PerfCounterGroup group;
+            return group;
+        }
+
+        bool available() const {
+            return leader >= 0;
+        }
+
+        bool available(PerfCounters::Counter counter) const {
+            return fds[counter] >= 0;
+        }
+
+        /**
+         * @return why the counters are unavailable
+         */
+        const std::string &error() const {
+            return reason;
+        }
+
+        /**
+         * @return the current values of all counters since the group was opened, unavailable counters are 0
+         */
+        PerfCounters::Values read() const {
+            PerfCounters::Values values{};
+            if(leader < 0){
+                return values;
+            }
+
+            // layout of PERF_FORMAT_GROUP | PERF_FORMAT_ID: the number of counters followed by (value, id) pairs
+            std::uint64_t buffer[1 + 2*PerfCounters::NumberOfCounters];
+            if(::read(leader, buffer, sizeof(buffer)) <= 0){
+                return values;
+            }
+            for(std::uint64_t j = 0; j < buffer[0]; j++){
+                for(unsigned int i = 0; i < PerfCounters::NumberOfCounters; i++){
+                    if(fds[i] >= 0 && ids[i] == buffer[2 + 2*j]){
+                        values[i] = buffer[1 + 2*j];
+                    }
+                }
+            }
+            return values;
+        }
+
+    private:
+        int leader = -1;
+        std::array<int, PerfCounters::NumberOfCounters> fds;
+        std::array<std::uint64_t, PerfCounters::NumberOfCounters> ids{};
+        std::string reason;
+};
+
+
+
+
+/**
+ *
+ * Instrumentation policy which, in addition to the SolverStatistics of StatisticsInstrumentation, accumulates the hardware
+ * counters of every phase. Phases nest (Phase::Step contains Phase::Stages and Phase::Rhs), every phase is accumulated on its
+ * own.
+ *
+ * Every measurement reads the counters twice with a system call. The kernel part is not counted, but the phases are short,
+ * hence the counters of a phase should be compared between methods and state sizes rather than taken as absolute numbers.
+ *
+ */
+class PerfInstrumentation {
+
+    public:
+        struct PhaseCounters {
+            PerfCounters::Values values{};
+            unsigned long measurements = 0;
+        };
+
+        class Timer {
+            public:
+                Timer(StatisticsInstrumentation &statistics, Phase phase, PhaseCounters &accumulator)
+                    : wall(statistics.time(phase)), accumulator(accumulator), start(PerfCounterGroup::instance().read()){
+                }
+
+                ~Timer(){
+                    PerfCounters::Values end = PerfCounterGroup::instance().read();
+                    for(unsigned int i = 0; i < PerfCounters::NumberOfCounters; i++){
+                        accumulator.values[i] += end[i] - start[i];
+                    }
+                    accumulator.measurements++;
+                }
+
+            private:
+                StatisticsInstrumentation::Timer wall;
+                PhaseCounters &accumulator;
+                PerfCounters::Values start;
+        };
+
+        void count(Event event, unsigned long n = 1){
+            statisticsPolicy.count(event, n);
+        }
+
+        Timer time(Phase phase){
+            return Timer(statisticsPolicy, phase, phases[static_cast<unsigned int>(phase)]);
+        }
+
+        void reset(){
+            statisticsPolicy.reset();
+            phases = {};
+        }
+
+        const SolverStatistics &statistics() const {
+            return statisticsPolicy.statistics();
+        }
+
+        /**
+         * @return the counters accumulated over all measurements of the given phase
+         */
+        const PhaseCounters &counters(Phase phase) const {
+            return phases[static_cast<unsigned int>(phase)];
+        }
+
+    private:
+        StatisticsInstrumentation statisticsPolicy;
+        // one entry per Phase
+        std::array<PhaseCounters, 5> phases;
+};
+
+
+
+
+#endif
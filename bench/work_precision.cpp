@@ -0,0 +1,320 @@
+/**
+ *
+ * Work-precision diagrams for the explicit Runge-Kutta methods, see bench/README.md.
+ *
+ * Every method is run with an increasing number of steps on a set of reference problems, every embedded method with adaptive
+ * step size and decreasing tolerances. For every run the error at the end of the time interval (against a high accuracy
+ * reference solution), the wall time and the number of RHS evaluations are written as one line of CSV. Plotting error against time or against RHS evaluations gives the work-precision diagrams.
+ *
+ */
+
+
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <Eigen/Dense>
+#include "../src/rk_adaptive.hpp"
+#include "../src/rk_implementer.hpp"
+#include "../src/rk_solvers.hpp"
+#include "../src/rk_trajectory.hpp"
+
+
+
+// an initial value problem y' = f(y), y(0) = y0 solved over [0, time]
+struct Problem {
+    std::string name;
+    std::function<Eigen::VectorXd(const Eigen::VectorXd&)> f;
+    Eigen::VectorXd y0;
+    double time;
+};
+
+
+namespace ReferenceProblems{
+
+    Problem lotkaVolterra(){
+        Eigen::VectorXd y0(2);
+        y0 << 6,3;
+        return {"Lotka-Volterra", [] (const Eigen::VectorXd &y) {
+            Eigen::VectorXd df(2);
+            df << y(0)*(4-4.0/3*y(1)) , -y(1)*(0.8-0.4*y(0));
+            return df;
+        }, y0, 10};
+    }
+
+    // only a short interval, for longer ones the chaotic behaviour makes any reference meaningless
+    Problem lorenz(){
+        Eigen::VectorXd y0(3);
+        y0 << 1,1,1;
+        return {"Lorenz", [] (const Eigen::VectorXd &y) {
+            Eigen::VectorXd df(3);
+            df << 10*(y(1) - y(0)), y(0)*(28-y(2)) - y(1), y(0)*y(1) - 8.0/3*y(2);
+            return df;
+        }, y0, 2};
+    }
+
+    Problem vanDerPol(){
+        Eigen::VectorXd y0(2);
+        y0 << 2,0;
+        return {"Van der Pol", [] (const Eigen::VectorXd &y) {
+            const double mu = 5;
+            Eigen::VectorXd df(2);
+            df << y(1), mu*(1 - y(0)*y(0))*y(1) - y(0);
+            return df;
+        }, y0, 10};
+    }
+
+    // stiff chemical reaction, explicit methods are only stable for small steps
+    Problem robertson(){
+        Eigen::VectorXd y0(3);
+        y0 << 1,0,0;
+        return {"Robertson", [] (const Eigen::VectorXd &y) {
+            Eigen::VectorXd df(3);
+            df << -0.04*y(0) + 1e4*y(1)*y(2),
+                  0.04*y(0) - 1e4*y(1)*y(2) - 3e7*y(1)*y(1),
+                  3e7*y(1)*y(1);
+            return df;
+        }, y0, 1};
+    }
+
+    // u_t = u_xx on [0, 1] with u = 0 on the boundary, discretized with finite differences on n inner points
+    Problem heatEquation(){
+        const int n = 50;
+        Eigen::VectorXd y0(n);
+        for(int i = 0; i < n; i++){
+            double x = (i + 1.0)/(n + 1);
+            y0(i) = std::sin(M_PI*x) + 0.5*std::sin(3*M_PI*x);
+        }
+        return {"Heat equation", [] (const Eigen::VectorXd &u) {
+            const int n = u.size();
+            const double dx2 = 1.0/((n + 1.0)*(n + 1.0));
+            Eigen::VectorXd du(n);
+            for(int i = 0; i < n; i++){
+                du(i) = ((i > 0 ? u(i - 1) : 0) - 2*u(i) + (i < n - 1 ? u(i + 1) : 0))/dx2;
+            }
+            return du;
+        }, y0, 0.1};
+    }
+
+}
+
+
+
+/**
+ *
+ * Runs every registered method on every registered problem.
+ *
+ */
+class WorkPrecision {
+
+    public:
+        /**
+         * Constructor for WorkPrecision
+         *
+         * @param referenceSteps the number of steps of the classical 4th order method used for the reference solutions
+         */
+        WorkPrecision(unsigned int referenceSteps = 1 << 20) : referenceSteps(referenceSteps){
+        }
+
+        void addProblem(const Problem &problem){
+            problems.push_back(problem);
+        }
+
+        void addMethod(const ButcherTableau &tableau){
+            methods.push_back(tableau);
+        }
+
+        void addAdaptiveMethod(const EmbeddedButcherTableau &tableau){
+            adaptiveMethods.push_back(tableau);
+        }
+
+        /**
+         * Runs all methods on all problems with 2^minimalExponent to 2^maximalExponent steps, all adaptive methods with the
+         * tolerances 1e-3 to 1e-13, and writes the results as CSV. For adaptive methods steps are the accepted steps.
+         */
+        void run(unsigned int minimalExponent, unsigned int maximalExponent, std::ostream &csv){
+
+            csv << "problem,method,order,steps,rhs_evaluations,wall_time_s,error" << std::endl;
+
+            for(const Problem &problem : problems){
+                Eigen::VectorXd reference = solve(problem, ExplicitRKTableaus::classical4thOrder(), referenceSteps);
+                std::cerr << problem.name << ": reference solution " << reference.transpose().head(std::min<int>(3, reference.size())) << " ..." << std::endl;
+
+                for(const ButcherTableau &method : methods){
+                    for(unsigned int exponent = minimalExponent; exponent <= maximalExponent; exponent++){
+                        unsigned int steps = 1u << exponent;
+
+                        unsigned long evaluations = 0;
+                        Eigen::VectorXd result;
+
+                        double best = timed([&] () {
+                            evaluations = 0;
+                            result = solve(problem, method, steps, &evaluations);
+                        });
+
+                        csv << problem.name << "," << method.name << "," << method.order << "," << steps << "," << evaluations << ","
+                            << best << "," << relativeError(result, reference) << std::endl;
+                    }
+                }
+
+                for(const EmbeddedButcherTableau &method : adaptiveMethods){
+                    for(int exponent = 3; exponent <= 13; exponent++){
+                        double tolerance = std::pow(10.0, -exponent);
+
+                        SolverStatistics statistics;
+                        Eigen::VectorXd result;
+                        double best;
+                        try{
+                            best = timed([&] () {
+                                AdaptiveRungeKuttaIntegrator<Eigen::VectorXd, StatisticsInstrumentation> integrator(method, tolerance, tolerance);
+                                FinalState final;
+                                integrator.solve(problem.f, problem.time, problem.y0, final);
+                                result = final.value();
+                                statistics = integrator.statistics();
+                            });
+                        }catch(const char *error){
+                            std::cerr << problem.name << ", " << method.name << ", tolerance " << tolerance << ": " << error << std::endl;
+                            continue;
+                        }
+
+                        csv << problem.name << "," << method.name << "," << method.order << "," << statistics.acceptedSteps << ","
+                            << statistics.rhsEvaluations << "," << best << "," << relativeError(result, reference) << std::endl;
+                    }
+                }
+            }
+        }
+
+    private:
+        /**
+         * @return the fastest wall time of run, short runs are repeated to get a reliable time
+         */
+        template<typename Run>
+        static double timed(Run &&run){
+            double best = 1e300, total = 0;
+            for(int repetition = 0; repetition < 50 && (repetition == 0 || total < 0.05); repetition++){
+                auto start = std::chrono::steady_clock::now();
+                run();
+                double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                best = std::min(best, elapsed);
+                total += elapsed;
+            }
+            return best;
+        }
+
+        // relative error in the maximum norm, inf or nan if the method was unstable
+        static double relativeError(const Eigen::VectorXd &result, const Eigen::VectorXd &reference){
+            return (result - reference).lpNorm<Eigen::Infinity>() / reference.lpNorm<Eigen::Infinity>();
+        }
+
+        Eigen::VectorXd solve(const Problem &problem, const ButcherTableau &method, unsigned int steps, unsigned long *evaluations = nullptr){
+            unsigned long calls = 0;
+            auto f = [&problem, &calls] (const Eigen::VectorXd &y) {
+                calls++;
+                return problem.f(y);
+            };
+
+            ExplicitRungeKuttaIntegrator<Eigen::VectorXd> integrator(method);
+            FinalState result;
+            integrator.solve(f, problem.time, problem.y0, steps, result);
+
+            if(evaluations != nullptr){
+                *evaluations = calls;
+            }
+            return result.value();
+        }
+
+        unsigned int referenceSteps;
+        std::vector<Problem> problems;
+        std::vector<ButcherTableau> methods;
+        std::vector<EmbeddedButcherTableau> adaptiveMethods;
+};
+
+
+
+/**
+ * Reads a butcher tableau from a text file: the name, the order, the number of stages s, s rows of A and finally b.
+ * Coefficients may be written as fractions, e.g. 1/6. Lines starting with # are ignored.
+ */
+ButcherTableau readTableau(const std::string &filename){
+
+    std::ifstream file(filename);
+    std::vector<std::string> lines;
+    for(std::string line; std::getline(file, line);){
+        if(!line.empty() && line[0] != '#'){
+            lines.push_back(line);
+        }
+    }
+
+    auto number = [] (const std::string &token) {
+        std::size_t slash = token.find('/');
+        return slash == std::string::npos ? std::stod(token) : std::stod(token.substr(0, slash)) / std::stod(token.substr(slash + 1));
+    };
+
+    if(lines.size() < 3){
+        throw "Not a butcher tableau";
+    }
+    ButcherTableau tableau;
+    tableau.name = lines[0];
+    tableau.order = std::stoul(lines[1]);
+    unsigned int stages = std::stoul(lines[2]);
+    if(lines.size() < 4 + stages){
+        throw "Not a butcher tableau";
+    }
+
+    tableau.A.resize(stages, stages);
+    tableau.b.resize(stages);
+    for(unsigned int i = 0; i <= stages; i++){
+        std::istringstream row(lines[3 + i]);
+        std::string token;
+        for(unsigned int j = 0; j < stages; j++){
+            if(!(row >> token)){
+                throw "Not a butcher tableau";
+            }
+            (i < stages ? tableau.A(i, j) : tableau.b(j)) = number(token);
+        }
+    }
+    return tableau;
+}
+
+
+
+int main(int argc, char **argv) {
+
+    /**
+     * Usage: work_precision [output file] [tableau files ...]
+     */
+
+    std::string filename = argc > 1 ? argv[1] : "work_precision.csv";
+
+    WorkPrecision benchmark;
+
+    benchmark.addProblem(ReferenceProblems::lotkaVolterra());
+    benchmark.addProblem(ReferenceProblems::lorenz());
+    benchmark.addProblem(ReferenceProblems::vanDerPol());
+    benchmark.addProblem(ReferenceProblems::robertson());
+    benchmark.addProblem(ReferenceProblems::heatEquation());
+
+    for(const ButcherTableau &tableau : ExplicitRKTableaus::all()){
+        benchmark.addMethod(tableau);
+    }
+    for(const EmbeddedButcherTableau &tableau : EmbeddedRKTableaus::all()){
+        benchmark.addAdaptiveMethod(tableau);
+    }
+
+    // user supplied methods
+    for(int i = 2; i < argc; i++){
+        benchmark.addMethod(readTableau(argv[i]));
+    }
+
+    std::ofstream csv(filename);
+    benchmark.run(4, 16, csv);
+    std::cerr << "Results written to " << filename << std::endl;
+
+}
@@ -6,6 +6,7 @@
 #include <Eigen/Dense>
 #include "../src/rk_implementer.hpp"
 #include "../src/rk_solvers.hpp"
+#include "../src/rk_trajectory.hpp"
 
 namespace plt = matplotlibcpp;
 
@@ -37,16 +38,27 @@ void lotkaVolterra(){
    * Solve using built in solver:
    */
 
-  std::vector<Eigen::VectorXd> result = ExplicitRKSolvers::classical4thOrderRuleIntegrator(f, time,y0, steps);
+  Eigen::MatrixXd A(4,4);
+  A << 0,0,0,0,
+      0.5,0,0,0,
+      0,0.5,0,0,
+      0,0,1,0;
+  Eigen::VectorXd b(4);
+  b << 1.0/6,2.0/6,2.0/6,1.0/6;
+
+  ExplicitRungeKuttaIntegrator<Eigen::VectorXd> solver(A,b);
+
+  Trajectory result;
+  solver.solve(f, time, y0, steps, result);
 
-  std::vector<double> t(steps);
-  std::vector<double> prey(steps);
-  std::vector<double> predator(steps);
+  // the rows of the trajectory are the populations over time
+  std::vector<double> t(result.times().data(), result.times().data() + result.size());
+  std::vector<double> prey(result.size());
+  std::vector<double> predator(result.size());
 
     for(size_t i = 0; i < t.size(); i++) {
-        t[i] = i*(time / (double) steps);
-        prey[i] = result[i](0);
-        predator[i] = result[i](1);
+        prey[i] = result.row(0)(i);
+        predator[i] = result.row(1)(i);
     }
     plt::title("Lotka-Volterra Integration Example");
 
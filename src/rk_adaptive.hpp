@@ -0,0 +1,583 @@
+#ifndef RKADAPTIVE
+
+#define RKADAPTIVE
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "rk_implementer.hpp"
+#include "rk_statistics.hpp"
+
+
+
+
+/**
+ *
+ * An embedded Runge Kutta pair: a butcher tableau of an explicit method together with an error estimator and optionally a
+ * continuous extension (dense output).
+ *
+ * The stages are numbered as follows: the s stages of A, then f(y1) at the end of the step (which is the first stage of
+ * the next step, hence it costs nothing for FSAL methods and one evaluation per step otherwise), then the additional stages
+ * of the dense output.
+ *
+ */
+struct EmbeddedButcherTableau {
+    std::string name;
+    // the s x s coefficients matrix, strictly lower triangular
+    Eigen::MatrixXd A;
+    // the weights of the propagated solution (the one of higher order)
+    Eigen::VectorXd b;
+    // the error estimate of a step is h * sum_i e(i) k_i, over the s stages and f(y1)
+    Eigen::VectorXd e;
+    // a second error estimate which is combined with e as in DOP853, empty for all other methods
+    Eigen::VectorXd e2;
+    // the order of the propagated solution
+    unsigned int order;
+    // the error estimate behaves like h^(estimatorOrder + 1), it determines how the step size is adapted
+    unsigned int estimatorOrder;
+    // the coefficients of the additional stages of the dense output, one row per stage over all previous stages
+    Eigen::MatrixXd denseA;
+    // the dense output is y0 + h * sum_i b_i(theta) k_i with b_i(theta) = sum_p P(i,p) theta^(p+1), over all stages.
+    // If empty, the cubic Hermite interpolation of y0, y1, f(y0) and f(y1) is used.
+    Eigen::MatrixXd P;
+
+    /**
+     * @return the propagated method as butcher tableau, e.g. to use it with a fixed step size in ExplicitRungeKuttaIntegrator
+     */
+    ButcherTableau butcherTableau() const {
+        return {name, A, b, order};
+    }
+};
+
+
+
+
+// helpers shared by the integrators with adaptive step size
+namespace StepSizeControl{
+
+    // the step size controller of Hairer, Norsett, Wanner, Sec. II.4: the next step size aims at an error of safety (instead of 1)
+    // and changes by at most these factors
+    constexpr double safety = 0.9;
+    constexpr double minFactor = 0.2;
+    constexpr double maxFactor = 10;
+
+    /**
+     * Computes the factor of the step size for the next attempt after a step
+     *
+     * @param error the scaled norm of the error estimate of the step, it is accepted if error <= 1
+     * @param order the error estimate behaves like h^(order + 1)
+     * @param rejected true if the step before was rejected, then an accepted step does not increase the step size
+     * @param largest the largest factor after an accepted step, e.g. smaller for multistep methods
+     *
+     * @return the factor, between minFactor and 1 after a rejected step (error > 1)
+     */
+    inline double factor(double error, unsigned int order, bool rejected = false, double largest = maxFactor){
+        if(error > 1){
+            return std::max(minFactor, safety*std::pow(error, -1.0/(order + 1)));
+        }
+        double result = error == 0 ? largest : std::min(largest, safety*std::pow(error, -1.0/(order + 1)));
+        // no increase directly after a rejected step
+        return rejected ? std::min(1.0, result) : result;
+    }
+
+    /**
+     * @return true if the step size h is too small to make progress at time t
+     */
+    inline bool tooSmall(double h, double t){
+        return h < 10*std::numeric_limits<double>::epsilon()*std::max(1.0, std::abs(t));
+    }
+
+    /**
+     * Chooses the first step size from the behaviour of f at y0 (Hairer, Norsett, Wanner, Sec. II.4)
+     *
+     * @param evaluate computes f, evaluate(y, result) stores f(y) in result
+     * @param y0 the initial state
+     * @param f0 f(y0)
+     * @param time the length of the time interval
+     * @param order the error of a step behaves like h^(order + 1)
+     * @param stage workspace like y0, overwritten
+     * @param difference workspace like y0, overwritten
+     *
+     * @return the first step size
+     */
+    template<typename Step, typename Evaluate>
+    double initialStep(Evaluate &&evaluate, const Step &y0, const Step &f0, double time, unsigned int order, double rtol, double atol, double maxStep, Step &stage, Step &difference){
+
+        auto rms = [&] (const Step &v) {
+            return std::sqrt((v.array() / (atol + rtol*y0.array().abs())).matrix().squaredNorm() / y0.size());
+        };
+
+        double d0 = rms(y0);
+        double d1 = rms(f0);
+        double h0 = (d0 < 1e-5 || d1 < 1e-5) ? 1e-6 : 0.01*d0/d1;
+        h0 = std::min(h0, time);
+
+        // one explicit euler step
+        stage = y0 + h0*f0;
+        evaluate(stage, difference);
+        difference -= f0;
+        double d2 = rms(difference)/h0;
+
+        double h1 = (d1 <= 1e-15 && d2 <= 1e-15) ? std::max(1e-6, 1e-3*h0) : std::pow(0.01/std::max(d1, d2), 1.0/(order + 1));
+        return std::min({100*h0, h1, time, maxStep});
+    }
+
+    /**
+     * @return the RMS norm of error, every component scaled by atol + rtol * max(|y0|, |y1|)
+     */
+    template<typename Error, typename State>
+    double errorNorm(const Error &error, const State &y0, const State &y1, double rtol, double atol){
+        return std::sqrt((error.array() / (atol + rtol*y0.array().abs().max(y1.array().abs()))).matrix().squaredNorm() / y0.size());
+    }
+
+}
+
+
+
+
+/**
+ *
+ * Implementation of an explicit Runge Kutta solver with adaptive step size. The error of every step is estimated with the
+ * embedded method of the tableau, a step is accepted if its scaled RMS error is at most 1, where the error of a component
+ * is scaled by atol + rtol * max(|y0|, |y1|). The next step size is chosen from the asymptotic behaviour of the error.
+ *
+ * Like ExplicitRungeKuttaIntegrator the stages are kept in a workspace which is allocated once per solve, a step does not
+ * allocate any memory apart from what f allocates for its result.
+ *
+ * The Instrumentation policy decides whether statistics are collected, see ExplicitRungeKuttaIntegrator.
+ *
+ */
+template <class Step, class Instrumentation = NoInstrumentation> class AdaptiveRungeKuttaIntegrator {
+
+    public:
+        /**
+         * Constructor for the AdaptiveRungeKuttaIntegrator
+         *
+         * @param tableau the embedded pair, e.g. one of EmbeddedRKTableaus
+         * @param rtol the relative tolerance of a step
+         * @param atol the absolute tolerance of a step
+         * @param maxStep the largest step size the integrator may use
+         */
+        AdaptiveRungeKuttaIntegrator(const EmbeddedButcherTableau &tableau, double rtol = 1e-6, double atol = 1e-9, double maxStep = std::numeric_limits<double>::infinity())
+            : tableau(tableau), size(tableau.A.cols()), rtol(rtol), atol(atol), maxStep(maxStep){
+            if(tableau.b.size() != size || tableau.e.size() != size + 1 || (tableau.e2.size() != 0 && tableau.e2.size() != size + 1)){
+                throw "Inconsistent embedded butcher tableau";
+            }
+            if(tableau.P.size() != 0 && tableau.P.rows() != size + 1 + tableau.denseA.rows()){
+                throw "Inconsistent dense output of the embedded butcher tableau";
+            }
+        }
+
+        /**
+         * Integrates over [0, time] with adaptive step sizes and hands the state after every accepted step to the output
+         *
+         * @param f the function we are integrating over
+         * @param time the time interval we want to integrate over
+         * @param y0 the initial state of the system
+         * @param output receives y0 and the state of every accepted step, see rk_trajectory.hpp for the interface of an output
+         *
+         * @exception if the step size becomes too small (e.g. due to a singularity) an error will be thrown
+         */
+        template<typename Function, typename Output>
+        void solve(Function &&f, double time, const Step &y0, Output &output){
+
+            instrumentation.reset();
+
+            // the number of steps is not known in advance
+            output.initialize(y0.size(), 0);
+            output.push(0.0, y0);
+
+            integrate(f, time, y0, [&] (double, double, double tNext) {
+                auto timer = instrumentation.time(Phase::Output);
+                output.push(tNext, y1);
+            });
+
+            output.finalize();
+
+        }
+
+        /**
+         * Same as solve above, but additionally writes a checkpoint every few accepted steps from which the integration can be
+         * resumed. Besides the state a checkpoint holds the next step size, the state of the step size controller and the
+         * first stage f(y) of the next step.
+         *
+         * @param checkpointer the file and interval (in accepted steps) for the checkpoints
+         */
+        template<typename Function, typename Output>
+        void solve(Function &&f, double time, const Step &y0, Output &output, const Checkpointer &checkpointer){
+
+            instrumentation.reset();
+
+            output.initialize(y0.size(), 0);
+            output.push(0.0, y0);
+
+            integrate(f, time, y0, [&] (double, double, double tNext) {
+                auto timer = instrumentation.time(Phase::Output);
+                output.push(tNext, y1);
+            }, &checkpointer);
+
+            output.finalize();
+
+        }
+
+        /**
+         * Continues an integration started with solve from its last checkpoint. The integration has to be resumed with the same
+         * tableau, tolerances and time, the accepted states are then exactly the same as without interruption.
+         *
+         * @param f the function we are integrating over
+         * @param time the time interval of the interrupted integration
+         * @param output receives the states after the checkpoint (not the state of the checkpoint itself)
+         * @param checkpointer the file to resume from, new checkpoints are written to it as in solve
+         *
+         * @exception if the checkpoint does not belong to this integration an error will be thrown
+         */
+        template<typename Function, typename Output>
+        void resume(Function &&f, double time, Output &output, const Checkpointer &checkpointer){
+
+            Checkpoint checkpoint = checkpointer.load();
+            const auto n = checkpoint.state.size();
+            if(checkpoint.method != fingerprint(time) || checkpoint.extra.size() != n + 1 || checkpoint.t > time){
+                throw "Checkpoint does not belong to this integration";
+            }
+
+            instrumentation.reset();
+
+            output.initialize(n, 0);
+
+            prepare(checkpoint.state);
+            y = checkpoint.state;
+            k[0] = checkpoint.extra.tail(n);
+            control(f, time, checkpoint.t, checkpoint.h, checkpoint.extra(0) != 0, checkpoint.step, [&] (double, double, double tNext) {
+                auto timer = instrumentation.time(Phase::Output);
+                output.push(tNext, y1);
+            }, &checkpointer);
+
+            output.finalize();
+
+        }
+
+        /**
+         * Integrates over [0, times.back()] with adaptive step sizes and hands the states at the given times to the output.
+         * The states between the steps are computed with the dense output of the method, hence the output times do not
+         * influence the step sizes.
+         *
+         * @param f the function we are integrating over
+         * @param times the times of the states handed to the output, sorted in ascending order and not negative
+         * @param y0 the initial state of the system
+         * @param output receives the states at the given times
+         *
+         * @exception if the times are not sorted or the step size becomes too small an error will be thrown
+         */
+        template<typename Function, typename Output>
+        void solve(Function &&f, const std::vector<double> &times, const Step &y0, Output &output){
+
+            if(times.empty() || times.front() < 0 || !std::is_sorted(times.begin(), times.end())){
+                throw "Output times must be sorted and not negative";
+            }
+
+            instrumentation.reset();
+
+            output.initialize(y0.size(), times.size());
+
+            std::size_t next = 0;
+            for(; next < times.size() && times[next] == 0; next++){
+                output.push(0.0, y0);
+            }
+
+            integrate(f, times.back(), y0, [&] (double t, double h, double tNext) {
+                auto timer = instrumentation.time(Phase::Output);
+                bool extraStages = false;
+                for(; next < times.size() && times[next] <= tNext; next++){
+                    if(times[next] == tNext){
+                        output.push(times[next], y1);
+                    }else{
+                        if(!extraStages){
+                            denseStages(f, h);
+                            extraStages = true;
+                        }
+                        denseOutput(h, (times[next] - t)/h, interpolated);
+                        output.push(times[next], interpolated);
+                    }
+                }
+            });
+
+            output.finalize();
+
+        }
+
+        /**
+         * @return the statistics of the last solve (all zero unless the integrator uses StatisticsInstrumentation)
+         */
+        SolverStatistics statistics() const {
+            return instrumentation.statistics();
+        }
+
+        /**
+         * @return the instrumentation policy, for the data of a policy which goes beyond SolverStatistics
+         */
+        const Instrumentation &instrumentationPolicy() const {
+            return instrumentation;
+        }
+
+    private:
+        /**
+         * Starts the step size control loop at y0, see control
+         */
+        template<typename Function, typename Accepted>
+        void integrate(Function &&f, double time, const Step &y0, Accepted &&accepted, const Checkpointer *checkpointer = nullptr){
+
+            if(time <= 0){
+                return;
+            }
+
+            prepare(y0);
+            y = y0;
+
+            double h;
+            {
+                auto timer = instrumentation.time(Phase::Step);
+                evaluate(f, y, k[0]);
+                h = initialStep(f, time);
+            }
+
+            control(f, time, 0, h, false, 0, accepted, checkpointer);
+
+        }
+
+        /**
+         * The step size control loop from t on with the proposed step size h, y and k[0] = f(y) have to hold the state at t.
+         * accepted(t, h, tNext) is called after every accepted step of size h from t to tNext while y holds the state at t,
+         * y1 the one at tNext and k the stages of the step. The last step ends exactly at time.
+         *
+         * @param rejected true if the last attempted step was rejected
+         * @param step the number of steps accepted before t
+         * @param checkpointer writes checkpoints if not nullptr
+         */
+        template<typename Function, typename Accepted>
+        void control(Function &&f, double time, double t, double h, bool rejected, std::uint64_t step, Accepted &&accepted, const Checkpointer *checkpointer){
+
+            while(t < time){
+                // the last step ends exactly at time
+                bool last = t + h >= time;
+                if(last){
+                    h = time - t;
+                }
+
+                iteration(f, h);
+                double error = errorNorm(h);
+
+                if(error <= 1){
+                    double tNext = last ? time : t + h;
+                    instrumentation.count(Event::AcceptedStep);
+                    accepted(t, h, tNext);
+
+                    t = tNext;
+                    std::swap(y, y1);
+                    std::swap(k[0], k[size]);
+
+                    h = std::min(h*StepSizeControl::factor(error, tableau.estimatorOrder, rejected), maxStep);
+                    rejected = false;
+
+                    if(checkpointer != nullptr && checkpointer->due(++step)){
+                        save(*checkpointer, step, t, h, rejected, time);
+                    }
+                }else{
+                    instrumentation.count(Event::RejectedStep);
+                    h *= StepSizeControl::factor(error, tableau.estimatorOrder);
+                    rejected = true;
+                }
+
+                if(t < time && StepSizeControl::tooSmall(h, t)){
+                    throw "Step size too small";
+                }
+            }
+
+        }
+
+        /**
+         * Writes a checkpoint of the state y at t, extra holds the rejected flag followed by the first stage k[0] = f(y)
+         */
+        void save(const Checkpointer &checkpointer, std::uint64_t step, double t, double h, bool rejected, double time){
+            Checkpoint checkpoint;
+            checkpoint.step = step;
+            checkpoint.t = t;
+            checkpoint.h = h;
+            checkpoint.method = fingerprint(time);
+            checkpoint.state = Eigen::Map<const Eigen::VectorXd>(y.data(), y.size());
+            checkpoint.extra.resize(y.size() + 1);
+            checkpoint.extra(0) = rejected;
+            checkpoint.extra.tail(y.size()) = Eigen::Map<const Eigen::VectorXd>(k[0].data(), k[0].size());
+            checkpointer.save(checkpoint);
+        }
+
+        /**
+         * @return the fingerprint of the tableau, the tolerances and the time, the step sizes depend on all of them
+         */
+        std::uint64_t fingerprint(double time) const {
+            return Checkpoint::fingerprint(tableau.A, tableau.b, tableau.e, tableau.e2, Eigen::Vector4d(rtol, atol, maxStep, time));
+        }
+
+        /**
+         * Sizes the workspace for states like y0, this is the only place where the integrator itself allocates memory
+         */
+        void prepare(const Step &y0){
+            k.assign(size + 1 + tableau.denseA.rows(), y0);
+            stage = y0;
+            y1 = y0;
+            interpolated = y0;
+        }
+
+        template<typename Function>
+        void evaluate(Function &&f, const Step &argument, Step &result){
+            auto timer = instrumentation.time(Phase::Rhs);
+            result = f(argument);
+            instrumentation.count(Event::RhsEvaluation);
+        }
+
+        /**
+         * Computes the stages 1 to s-1 of a step of size h from y (the first stage k[0] = f(y) is already known), the new
+         * state y1 and f(y1)
+         */
+        template<typename Function>
+        void iteration(Function &&f, const double h){
+
+            auto stepTimer = instrumentation.time(Phase::Step);
+
+            for(unsigned int i = 1; i < size; i++){
+                {
+                    auto timer = instrumentation.time(Phase::Stages);
+                    stage = y;
+                    for(unsigned int j = 0; j < i; j++){
+                        if(tableau.A(i,j) != 0){
+                            stage += h*tableau.A(i,j) * k[j];
+                        }
+                    }
+                }
+                evaluate(f, stage, k[i]);
+            }
+
+            {
+                auto timer = instrumentation.time(Phase::Stages);
+                y1 = y;
+                for(unsigned int i = 0; i < size; i++){
+                    if(tableau.b(i) != 0){
+                        y1 += h*tableau.b(i) * k[i];
+                    }
+                }
+            }
+            evaluate(f, y1, k[size]);
+
+        }
+
+        /**
+         * @return the scaled RMS norm of the error estimate of the last step
+         */
+        double errorNorm(const double h){
+
+            auto timer = instrumentation.time(Phase::Stages);
+
+            // stage is free at this point and holds the error estimate
+            auto estimate = [&] (const Eigen::VectorXd &weights) {
+                stage.setZero();
+                for(unsigned int i = 0; i <= size; i++){
+                    if(weights(i) != 0){
+                        stage += weights(i) * k[i];
+                    }
+                }
+                return (stage.array() / (atol + rtol*y.array().abs().max(y1.array().abs()))).matrix().squaredNorm();
+            };
+
+            const double n = y.size();
+            double error = estimate(tableau.e);
+            if(tableau.e2.size() == 0){
+                return std::abs(h)*std::sqrt(error/n);
+            }
+
+            // DOP853: the estimate of order 5 is corrected with the one of order 3, see Hairer, Norsett, Wanner, Sec. II.10
+            double error2 = estimate(tableau.e2);
+            if(error == 0 && error2 == 0){
+                return 0;
+            }
+            return std::abs(h)*error/std::sqrt((error + 0.01*error2)*n);
+        }
+
+        /**
+         * Chooses the first step size, k[0] holds f(y0)
+         */
+        template<typename Function>
+        double initialStep(Function &&f, double time){
+            // the stages are free at this point
+            return StepSizeControl::initialStep([&] (const Step &argument, Step &result) { evaluate(f, argument, result); },
+                                                y, k[0], time, tableau.estimatorOrder, rtol, atol, maxStep, stage, k[1]);
+        }
+
+        /**
+         * Computes the additional stages of the dense output of the last step of size h
+         */
+        template<typename Function>
+        void denseStages(Function &&f, const double h){
+            auto stepTimer = instrumentation.time(Phase::Step);
+            for(unsigned int r = 0; r < tableau.denseA.rows(); r++){
+                {
+                    auto timer = instrumentation.time(Phase::Stages);
+                    stage = y;
+                    for(unsigned int j = 0; j < size + 1 + r; j++){
+                        if(tableau.denseA(r,j) != 0){
+                            stage += h*tableau.denseA(r,j) * k[j];
+                        }
+                    }
+                }
+                evaluate(f, stage, k[size + 1 + r]);
+            }
+        }
+
+        /**
+         * Evaluates the dense output of the last step of size h at y + theta*h, 0 <= theta <= 1
+         */
+        void denseOutput(const double h, const double theta, Step &result){
+
+            if(tableau.P.size() == 0){
+                // cubic Hermite interpolation
+                double t2 = theta*theta, t3 = t2*theta;
+                result = (2*t3 - 3*t2 + 1)*y + (-2*t3 + 3*t2)*y1;
+                result += ((t3 - 2*t2 + theta)*h)*k[0] + ((t3 - t2)*h)*k[size];
+                return;
+            }
+
+            result = y;
+            for(unsigned int i = 0; i < tableau.P.rows(); i++){
+                // Horner scheme for b_i(theta)
+                double weight = 0;
+                for(unsigned int p = tableau.P.cols(); p-- > 0;){
+                    weight = (weight + tableau.P(i,p))*theta;
+                }
+                if(weight != 0){
+                    result += h*weight * k[i];
+                }
+            }
+        }
+
+
+        const EmbeddedButcherTableau tableau;
+        unsigned int size;
+        double rtol;
+        double atol;
+        double maxStep;
+        Instrumentation instrumentation;
+
+        // workspace: the stages, the state at the beginning and the end of the current step, the argument of f and the dense output
+        std::vector<Step> k;
+        Step y;
+        Step y1;
+        Step stage;
+        Step interpolated;
+};
+
+
+
+
+#endif
@@ -0,0 +1,437 @@
+#ifndef RKADJOINT
+
+#define RKADJOINT
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <vector>
+
+#include "rk_implementer.hpp"
+#include "rk_statistics.hpp"
+
+
+
+
+/**
+ *
+ * Binomial checkpointing after Griewank and Walther (Algorithm 799: revolve, 2000). The reversal of l steps from a stored
+ * state with s stored states (including that one) repeats every step at most r times, where r is the smallest number with
+ * binomial(s + r, s) >= l, and needs the least number of recomputed steps if the next checkpoint is placed as below.
+ *
+ */
+namespace Revolve {
+
+    /**
+     * @param steps the number of steps to reverse, at least 2
+     * @param snapshots the number of states which can be stored, including the one at the beginning of the steps
+     *
+     * @return the number of steps after which the next checkpoint is stored (between 1 and steps - 1)
+     */
+    inline unsigned long split(unsigned long steps, unsigned long snapshots){
+        unsigned long repetitions = 0;
+        unsigned long range = 1;
+        while(range < steps){
+            repetitions++;
+            range = range*(repetitions + snapshots)/repetitions;
+        }
+
+        // binomial(snapshots + repetitions - 1, ...) with one repetition or some snapshots less
+        const unsigned long bino1 = range*repetitions/(snapshots + repetitions);
+        const unsigned long bino2 = snapshots > 1 ? bino1*snapshots/(snapshots + repetitions - 1) : 1;
+        const unsigned long bino3 = snapshots == 1 ? 0 : (snapshots > 2 ? bino2*(snapshots - 1)/(snapshots + repetitions - 2) : 1);
+        const unsigned long bino4 = bino2*(repetitions - 1)/snapshots;
+        const unsigned long bino5 = snapshots < 3 ? 0 : (snapshots > 3 ? bino3*(snapshots - 2)/repetitions : 1);
+
+        unsigned long result;
+        if(steps <= bino1 + bino3){
+            result = bino4;
+        }else if(steps >= range - bino5){
+            result = bino1;
+        }else{
+            result = steps - bino2 - bino3;
+        }
+        return std::min(std::max(result, 1ul), steps - 1);
+    }
+
+    /**
+     * @param steps the number of steps
+     * @param snapshots the number of states which can be stored, including the initial state
+     *
+     * @return the number of steps the reversal of all steps computes to reach the states of the adjoint steps from the
+     * stored states, each adjoint step computes its own step once more
+     */
+    inline unsigned long recomputations(unsigned long steps, unsigned long snapshots){
+        if(steps <= 1){
+            return 0;
+        }
+        if(snapshots <= 1){
+            return steps*(steps - 1)/2;
+        }
+        const unsigned long m = split(steps, snapshots);
+        return m + recomputations(steps - m, snapshots - 1) + recomputations(m, snapshots);
+    }
+
+}
+
+
+
+
+/**
+ *
+ * Implementation of the discrete adjoint of a Runge Kutta method: computes the gradient of an objective g(y(T)) of the final
+ * state with respect to parameters p of f and with respect to the initial state. The adjoint runs backwards through the
+ * steps, with one linear solve per step (none for explicit methods) and the transposed Jacobians at the stages, so its cost
+ * does not depend on the number of parameters (compare ForwardSensitivityIntegrator, one column per parameter). It is the
+ * exact gradient of the computed solution.
+ *
+ * The backward sweep needs the states in reverse order. Instead of all steps+1 states only a fixed number of checkpoints are
+ * stored, the other states are recomputed from the nearest checkpoint before them (binomial checkpointing, see Revolve).
+ * With c checkpoints every step is computed at most r + 1 times, where binomial(c + 1 + r, r) >= steps, e.g. log2(steps)
+ * checkpoints need few repetitions. For implicit methods the stages are solved with OptimizationMethods::dampedNewton like
+ * in ImplicitRungeKuttaIntegrator, also when a step is recomputed.
+ *
+ * The state and the adjoint are Eigen::VectorXd. f_p is evaluated as an n x np matrix but only multiplied with vectors.
+ *
+ * The Instrumentation policy decides whether statistics are collected, see ExplicitRungeKuttaIntegrator. All evaluations of f
+ * are counted, including the recomputations, every adjoint step is an accepted step. Jacobian evaluations are the Newton
+ * matrices and every evaluation of f_y and f_p at a stage of the adjoint.
+ *
+ */
+template <class Instrumentation = NoInstrumentation> class AdjointSensitivityIntegrator {
+
+    public:
+        /**
+         * Constructor for the AdjointSensitivityIntegrator
+         *
+         * @param tableau the butcher tableau, explicit or implicit
+         * @param checkpoints the number of states stored in addition to the initial state (0 for log2 of the number of steps)
+         */
+        AdjointSensitivityIntegrator(const ButcherTableau &tableau, unsigned int checkpoints = 0)
+            : A(tableau.A), b(tableau.b), size(tableau.A.cols()), checkpoints(checkpoints){
+            explicitMethod = A.template triangularView<Eigen::Upper>().toDenseMatrix().isZero(0);
+        }
+
+        /**
+         * Integrates over [0, time] with a fixed number of steps and computes the gradient of g(y(time)) backwards
+         *
+         * @param f the function we are integrating over, f(y) with the parameters fixed
+         * @param fy the Jacobian of f with respect to y, an n x n matrix
+         * @param fp the Jacobian of f with respect to the parameters, an n x np matrix
+         * @param dg the gradient of the objective with respect to the final state, dg(y) returns a vector of size n
+         * @param time the time interval we want to integrate over
+         * @param y0 the initial state of the system
+         * @param steps the number of integration steps
+         *
+         * @return the gradient of the objective with respect to the parameters (size np), the one with respect to y0 is
+         * initialAdjoint()
+         *
+         * @exception if the Newton iteration of an implicit method does not converge an error will be thrown
+         */
+        template<typename Function, typename Jacobian, typename ParameterJacobian, typename ObjectiveGradient>
+        Eigen::VectorXd gradient(Function &&f, Jacobian &&fy, ParameterJacobian &&fp, ObjectiveGradient &&dg, double time,
+                                 const Eigen::VectorXd &y0, unsigned int steps){
+
+            if(steps == 0){
+                throw "The adjoint needs at least one step";
+            }
+
+            instrumentation.reset();
+            recomputed = 0;
+            used = 0;
+            totalSteps = steps;
+            h = time/steps;
+            n = y0.size();
+
+            // more checkpoints than steps are never used
+            unsigned int available = checkpoints;
+            if(available == 0){
+                while((1ul << available) < steps){
+                    available++;
+                }
+            }
+            available = std::min(available, steps - 1);
+
+            states.assign(available + 1, y0);
+            lambda.resize(n);
+            parameterGradient.resize(0);
+
+            reverse(f, fy, fp, dg, 0, 0, steps, available);
+
+            return parameterGradient;
+        }
+
+        /**
+         * @return the gradient of the objective with respect to the initial state of the last gradient computation
+         */
+        const Eigen::VectorXd &initialAdjoint() const {
+            return lambda;
+        }
+
+        /**
+         * @return the final state of the last gradient computation
+         */
+        const Eigen::VectorXd &finalState() const {
+            return final;
+        }
+
+        /**
+         * @return the number of steps of the last gradient computation which were computed to reach the states of the
+         * adjoint steps, see Revolve::recomputations (with all states stored it would be steps - 1)
+         */
+        unsigned long recomputedSteps() const {
+            return recomputed;
+        }
+
+        /**
+         * @return the largest number of states stored at the same time by the last gradient computation, including y0
+         */
+        unsigned int storedStates() const {
+            return used + 1;
+        }
+
+        /**
+         * @return the statistics of the last gradient computation (all zero unless the integrator uses StatisticsInstrumentation)
+         */
+        SolverStatistics statistics() const {
+            return instrumentation.statistics();
+        }
+
+        /**
+         * @return the instrumentation policy, for the data of a policy which goes beyond SolverStatistics
+         */
+        const Instrumentation &instrumentationPolicy() const {
+            return instrumentation;
+        }
+
+    private:
+        /**
+         * Runs the adjoint backwards over the steps [first, last), the state at first is states[slot] and free more
+         * checkpoints can be stored after it. The later part is reversed first, then the loop continues with the earlier one.
+         */
+        template<typename Function, typename Jacobian, typename ParameterJacobian, typename ObjectiveGradient>
+        void reverse(Function &&f, Jacobian &&fy, ParameterJacobian &&fp, ObjectiveGradient &&dg, unsigned int slot,
+                     unsigned int first, unsigned int last, unsigned int free){
+
+            while(last - first > 1 && free > 0){
+                const unsigned int m = first + Revolve::split(last - first, free + 1);
+                Eigen::VectorXd &checkpoint = states[slot + 1];
+                checkpoint = states[slot];
+                for(unsigned int i = first; i < m; i++){
+                    checkpoint = advance(f, fy, checkpoint);
+                }
+                recomputed += m - first;
+                used = std::max(used, slot + 1);
+
+                reverse(f, fy, fp, dg, slot + 1, m, last, free - 1);
+                last = m;
+            }
+
+            // without free checkpoints every step is recomputed from the state at first
+            for(unsigned int k = last; k-- > first;){
+                Eigen::VectorXd y = states[slot];
+                for(unsigned int i = first; i < k; i++){
+                    y = advance(f, fy, y);
+                }
+                recomputed += k - first;
+                adjointStep(f, fy, fp, dg, y, k);
+            }
+        }
+
+        /**
+         * One step from y, keeps the increments of the stages (stacked) in increments
+         */
+        template<typename Function, typename Jacobian>
+        Eigen::VectorXd advance(Function &&f, Jacobian &&fy, const Eigen::VectorXd &y){
+
+            auto stepTimer = instrumentation.time(Phase::Step);
+
+            increments.resize(size*n);
+            if(explicitMethod){
+                for(unsigned int i = 0; i < size; i++){
+                    Eigen::VectorXd Y = stage(y, i);
+                    auto timer = instrumentation.time(Phase::Rhs);
+                    increments.segment(i*n, n) = f(Y);
+                    instrumentation.count(Event::RhsEvaluation);
+                }
+            }else{
+                // the increments are the root of this function
+                auto F = [&] (const Eigen::VectorXd &current) {
+                    increments = current;
+                    Eigen::VectorXd result(size*n);
+                    for(unsigned int i = 0; i < size; i++){
+                        Eigen::VectorXd Y = stage(y, i);
+                        auto timer = instrumentation.time(Phase::Rhs);
+                        result.segment(i*n, n) = current.segment(i*n, n) - f(Y);
+                        instrumentation.count(Event::RhsEvaluation);
+                    }
+                    return result;
+                };
+
+                auto DF = [&] (const Eigen::VectorXd &current) {
+                    increments = current;
+                    Eigen::MatrixXd result = Eigen::MatrixXd::Identity(size*n, size*n);
+                    for(unsigned int i = 0; i < size; i++){
+                        Eigen::VectorXd Y = stage(y, i);
+                        auto timer = instrumentation.time(Phase::Rhs);
+                        Eigen::MatrixXd jacobian = fy(Y);
+                        for(unsigned int j = 0; j < size; j++){
+                            result.block(i*n, j*n, n, n) -= h*A(i,j) * jacobian;
+                        }
+                    }
+                    return result;
+                };
+
+                // all increments start as f(y0), the increment of the explicit euler method
+                Eigen::VectorXd start(size*n);
+                {
+                    auto timer = instrumentation.time(Phase::Rhs);
+                    start.segment(0, n) = f(y);
+                    instrumentation.count(Event::RhsEvaluation);
+                }
+                for(unsigned int i = 1; i < size; i++){
+                    start.segment(i*n, n) = start.segment(0, n);
+                }
+
+                // the gradient is only as accurate as the stages
+                Eigen::VectorXd solution = OptimizationMethods::dampedNewton(F, DF, start, 1e-12, 1e-14, instrumentation);
+                increments = solution;
+            }
+
+            auto timer = instrumentation.time(Phase::Stages);
+            Eigen::VectorXd result = y;
+            for(unsigned int i = 0; i < size; i++){
+                if(b(i) != 0){
+                    result += h*b(i) * increments.segment(i*n, n);
+                }
+            }
+            return result;
+        }
+
+        /**
+         * The argument of f for the i-th stage of the step from y, with the current increments
+         */
+        Eigen::VectorXd stage(const Eigen::VectorXd &y, unsigned int i){
+            auto timer = instrumentation.time(Phase::Stages);
+            Eigen::VectorXd result = y;
+            for(unsigned int j = 0; j < size; j++){
+                if(A(i,j) != 0){
+                    result += h*A(i,j) * increments.segment(j*n, n);
+                }
+            }
+            return result;
+        }
+
+        /**
+         * The adjoint of step k from y: the stage adjoints u solve u_i = h b_i lambda + h sum_j A(j,i) f_y(Y_j)^T u_j, then
+         * lambda becomes lambda + sum_i f_y(Y_i)^T u_i and the gradient grows by sum_i f_p(Y_i)^T u_i
+         */
+        template<typename Function, typename Jacobian, typename ParameterJacobian, typename ObjectiveGradient>
+        void adjointStep(Function &&f, Jacobian &&fy, ParameterJacobian &&fp, ObjectiveGradient &&dg, const Eigen::VectorXd &y, unsigned int k){
+
+            Eigen::VectorXd y1 = advance(f, fy, y);
+
+            auto stepTimer = instrumentation.time(Phase::Step);
+
+            // the backward sweep starts at the last step
+            if(k + 1 == totalSteps){
+                final = y1;
+                lambda = dg(final);
+            }
+
+            std::vector<Eigen::MatrixXd> jacobians(size);
+            std::vector<Eigen::VectorXd> stageAdjoints(size);
+            for(unsigned int i = 0; i < size; i++){
+                Eigen::VectorXd Y = stage(y, i);
+                auto timer = instrumentation.time(Phase::Rhs);
+                jacobians[i] = fy(Y);
+                instrumentation.count(Event::JacobianEvaluation);
+            }
+
+            if(explicitMethod){
+                // stage i only depends on the earlier ones, hence its adjoint only on the later ones
+                for(unsigned int i = size; i-- > 0;){
+                    auto timer = instrumentation.time(Phase::Stages);
+                    Eigen::VectorXd u = h*b(i) * lambda;
+                    for(unsigned int j = i + 1; j < size; j++){
+                        if(A(j,i) != 0){
+                            u += h*A(j,i) * stageAdjoints[j];
+                        }
+                    }
+                    stageAdjoints[i] = jacobians[i].transpose()*u;
+                    accumulate(fp, y, i, u);
+                }
+            }else{
+                // the transposed Newton matrix of the stages
+                Eigen::MatrixXd M = Eigen::MatrixXd::Identity(size*n, size*n);
+                Eigen::VectorXd rhs(size*n);
+                for(unsigned int i = 0; i < size; i++){
+                    rhs.segment(i*n, n) = h*b(i) * lambda;
+                    for(unsigned int j = 0; j < size; j++){
+                        M.block(i*n, j*n, n, n) -= h*A(j,i) * jacobians[j].transpose();
+                    }
+                }
+                Eigen::VectorXd u;
+                {
+                    auto timer = instrumentation.time(Phase::LinearAlgebra);
+                    u = M.partialPivLu().solve(rhs);
+                    instrumentation.count(Event::LuFactorization);
+                    instrumentation.count(Event::LinearSolve);
+                }
+                for(unsigned int i = 0; i < size; i++){
+                    stageAdjoints[i] = jacobians[i].transpose()*u.segment(i*n, n);
+                    accumulate(fp, y, i, u.segment(i*n, n));
+                }
+            }
+
+            for(unsigned int i = 0; i < size; i++){
+                lambda += stageAdjoints[i];
+            }
+            instrumentation.count(Event::AcceptedStep);
+        }
+
+        /**
+         * Adds f_p(Y_i)^T u to the gradient of the parameters
+         */
+        template<typename ParameterJacobian>
+        void accumulate(ParameterJacobian &&fp, const Eigen::VectorXd &y, unsigned int i, const Eigen::VectorXd &u){
+            Eigen::VectorXd Y = stage(y, i);
+            Eigen::VectorXd contribution;
+            {
+                auto timer = instrumentation.time(Phase::Rhs);
+                contribution = fp(Y).transpose()*u;
+                instrumentation.count(Event::JacobianEvaluation);
+            }
+            if(parameterGradient.size() == 0){
+                parameterGradient = Eigen::VectorXd::Zero(contribution.size());
+            }
+            parameterGradient += contribution;
+        }
+
+
+        const Eigen::MatrixXd A;
+        const Eigen::VectorXd b;
+        unsigned int size;
+        unsigned int checkpoints;
+        bool explicitMethod;
+        Instrumentation instrumentation;
+
+        // the current gradient computation
+        double h = 0;
+        unsigned int n = 0;
+        unsigned int totalSteps = 0;
+        Eigen::VectorXd increments;
+        // the checkpoints, used like a stack: states[0] is y0, a later slot is only written after the earlier ones
+        std::vector<Eigen::VectorXd> states;
+
+        // the results of the last gradient computation
+        Eigen::VectorXd lambda;
+        Eigen::VectorXd parameterGradient;
+        Eigen::VectorXd final;
+        unsigned long recomputed = 0;
+        unsigned int used = 0;
+};
+
+
+
+
+#endif
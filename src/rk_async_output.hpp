@@ -0,0 +1,216 @@
+#ifndef RKASYNCOUTPUT
+
+#define RKASYNCOUTPUT
+
+#include <Eigen/Dense>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+
+
+/**
+ *
+ * What an AsyncOutput does if the consumer thread can not keep up with the integration and the ring buffer is full.
+ *
+ */
+enum class Backpressure {
+    // the integration waits until the consumer has freed a slot, no state is lost
+    Block,
+    // the state is dropped and counted, the integration never waits
+    Drop
+};
+
+
+
+
+/**
+ *
+ * An output which moves the work of another output (writing files, computing statistics, ...) to a separate consumer thread.
+ *
+ * The integrating thread copies every state into a slot of a bounded lock-free single-producer/single-consumer ring buffer. All slots
+ * are allocated once in initialize. The consumer thread takes the states out of the buffer and pushes them to the wrapped output,
+ * hence the wrapped output is only used from the consumer thread (apart from initialize and finalize). An idle consumer spins for a
+ * short while and then sleeps until the next state arrives, so it does not occupy a core while the integration computes the next
+ * steps. Needs to be linked with -pthread.
+ *
+ */
+template<typename Output> class AsyncOutput {
+
+    public:
+        /**
+         * Constructor for the AsyncOutput
+         *
+         * @param output the output the states are forwarded to on the consumer thread
+         * @param slots the number of states the ring buffer can hold
+         * @param backpressure what to do if the ring buffer is full
+         *
+         * @exception if slots is 0 an error will be thrown
+         */
+        AsyncOutput(Output &output, std::size_t slots = 1024, Backpressure backpressure = Backpressure::Block) :
+            output(output),slots(slots),backpressure(backpressure),slotSize(0),head(0),tail(0),done(false),failed(false),sleeping(false),dropped(0){
+            // the buffer would always be full
+            if(slots == 0){
+                throw "The ring buffer needs at least one slot";
+            }
+        }
+
+        AsyncOutput(const AsyncOutput &) = delete;
+        AsyncOutput &operator=(const AsyncOutput &) = delete;
+
+        ~AsyncOutput(){
+            stop();
+        }
+
+        void initialize(unsigned int dimension, unsigned int count){
+            // the consumer of an earlier solve may still run, e.g. if that solve threw before finalize
+            stop();
+            output.initialize(dimension, count);
+
+            // every slot holds the time followed by the state
+            slotSize = dimension + 1;
+            buffer.assign(slots*slotSize, 0.0);
+            head = 0;
+            tail = 0;
+            done = false;
+            failed = false;
+            sleeping = false;
+            dropped = 0;
+            error = nullptr;
+
+            consumer = std::thread(&AsyncOutput::consume, this);
+        }
+
+        template<typename State>
+        void push(double t, const State &y){
+
+            std::size_t position = head.load(std::memory_order_relaxed);
+            while(position - tail.load(std::memory_order_acquire) == slots){
+                // if the consumer has failed nobody frees slots anymore, the error is reported in finalize
+                if(failed.load(std::memory_order_acquire)){
+                    return;
+                }
+                if(backpressure == Backpressure::Drop){
+                    dropped++;
+                    return;
+                }
+                std::this_thread::yield();
+            }
+
+            double *slot = &buffer[(position % slots)*slotSize];
+            slot[0] = t;
+            std::memcpy(slot + 1, y.data(), (slotSize - 1)*sizeof(double));
+
+            // sequentially consistent with the check of the consumer before it sleeps, else the wake up could get lost
+            head.store(position + 1, std::memory_order_seq_cst);
+            if(sleeping.load(std::memory_order_seq_cst)){
+                wake();
+            }
+        }
+
+        /**
+         * Waits until the consumer thread has handed all states to the wrapped output and finalizes it
+         *
+         * @exception errors thrown by the wrapped output on the consumer thread are rethrown here
+         */
+        void finalize(){
+            stop();
+            if(error){
+                std::rethrow_exception(error);
+            }
+            output.finalize();
+        }
+
+        /**
+         * @return the number of states which have been dropped because the ring buffer was full (only with Backpressure::Drop)
+         */
+        std::size_t droppedStates() const {
+            return dropped;
+        }
+
+    private:
+        void consume(){
+            try {
+                unsigned int idle = 0;
+                while(true){
+                    std::size_t position = tail.load(std::memory_order_relaxed);
+                    if(position == head.load(std::memory_order_acquire)){
+                        // the producer sets done only after its last push, hence we have to check the buffer once more
+                        if(done.load(std::memory_order_acquire) && position == head.load(std::memory_order_acquire)){
+                            return;
+                        }
+                        if(++idle < spinLimit){
+                            std::this_thread::yield();
+                        }else{
+                            sleep(position);
+                        }
+                        continue;
+                    }
+                    idle = 0;
+
+                    const double *slot = &buffer[(position % slots)*slotSize];
+                    output.push(slot[0], Eigen::Map<const Eigen::VectorXd>(slot + 1, slotSize - 1));
+
+                    tail.store(position + 1, std::memory_order_release);
+                }
+            } catch(...) {
+                error = std::current_exception();
+                failed.store(true, std::memory_order_release);
+            }
+        }
+
+        /**
+         * Blocks the consumer until the producer has pushed a state after position or is done
+         */
+        void sleep(std::size_t position){
+            std::unique_lock<std::mutex> lock(mutex);
+            sleeping.store(true, std::memory_order_seq_cst);
+            wakeUp.wait(lock, [&] {
+                return head.load(std::memory_order_seq_cst) != position || done.load(std::memory_order_seq_cst);
+            });
+            sleeping.store(false, std::memory_order_relaxed);
+        }
+
+        void wake(){
+            std::lock_guard<std::mutex> lock(mutex);
+            wakeUp.notify_one();
+        }
+
+        void stop(){
+            if(consumer.joinable()){
+                done.store(true, std::memory_order_seq_cst);
+                wake();
+                consumer.join();
+            }
+        }
+
+        // the number of times an idle consumer yields before it sleeps
+        static constexpr unsigned int spinLimit = 256;
+
+        Output &output;
+        std::size_t slots;
+        Backpressure backpressure;
+        std::size_t slotSize;
+        std::vector<double> buffer;
+        // written by the producer and the consumer respectively, on cache lines of their own
+        alignas(64) std::atomic<std::size_t> head;
+        alignas(64) std::atomic<std::size_t> tail;
+        alignas(64) std::atomic<bool> done;
+        std::atomic<bool> failed;
+        std::atomic<bool> sleeping;
+        std::mutex mutex;
+        std::condition_variable wakeUp;
+        std::size_t dropped;
+        std::exception_ptr error;
+        std::thread consumer;
+};
+
+
+
+
+#endif
@@ -0,0 +1,1010 @@
+#ifndef RKCHEBYSHEV
+
+#define RKCHEBYSHEV
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "rk_adaptive.hpp"
+#include "rk_statistics.hpp"
+
+
+
+
+// estimation of the spectral radius of the Jacobian of f without computing the Jacobian
+namespace SpectralRadius{
+
+    /**
+     * Estimates the spectral radius of f'(y) with a nonlinear power iteration (Sommeijer, Shampine, Verwer, 1997): the
+     * difference f(y + dv) - f(y) approximates f'(y) dv for a small perturbation dv, which is rescaled after every iteration.
+     * The estimate is enlarged by 20% for safety.
+     *
+     * @param evaluate computes f, evaluate(y, result) stores f(y) in result
+     * @param y the state at which the Jacobian is taken
+     * @param fy f(y)
+     * @param direction the start of the iteration, e.g. the result of a previous call, it is overwritten with the dominant
+     * direction (the eigenvector of the largest eigenvalue)
+     * @param perturbed workspace like y, overwritten
+     * @param difference workspace like y, overwritten
+     *
+     * @return the estimate of the spectral radius
+     */
+    template<typename Step, typename Evaluate>
+    double powerIteration(Evaluate &&evaluate, const Step &y, const Step &fy, Step &direction, Step &perturbed, Step &difference){
+
+        const double yNorm = y.norm();
+        double directionNorm = direction.norm();
+        // the size of the perturbation
+        const double size = (yNorm == 0 ? 1.0 : yNorm)*std::sqrt(std::numeric_limits<double>::epsilon());
+        if(directionNorm == 0){
+            // an arbitrary direction which is not special for most problems
+            for(int i = 0; i < direction.size(); i++){
+                direction(i) = (i % 2 == 0 ? 1.0 : -1.0)*(1 + 0.1*i/direction.size());
+            }
+            directionNorm = direction.norm();
+        }
+        perturbed = y + (size/directionNorm)*direction;
+
+        double sigma = 0;
+        for(unsigned int iteration = 0; iteration < 50; iteration++){
+            evaluate(perturbed, difference);
+            difference -= fy;
+            const double differenceNorm = difference.norm();
+            const double previous = sigma;
+            sigma = differenceNorm/size;
+            if(differenceNorm == 0){
+                break;
+            }
+            // the direction is kept for the next estimate
+            direction = difference/differenceNorm;
+            if(iteration >= 1 && std::abs(sigma - previous) <= 0.01*std::max(sigma, 1e-12)){
+                break;
+            }
+            perturbed = y + size*direction;
+        }
+
+        return 1.2*sigma;
+    }
+
+}
+
+
+
+
+/**
+ *
+ * Implementation of the Runge Kutta Chebyshev method RKC of order 2 (Sommeijer, Shampine, Verwer, 1997) for mildly stiff
+ * problems whose Jacobian has eigenvalues close to the negative real axis, e.g. discretized parabolic equations. The s stages
+ * are built from the Chebyshev polynomial T_s, the stability region along the negative real axis grows like 0.65 s^2. Hence
+ * the number of stages grows with the stiffness (like the square root of h times the spectral radius), while the step size is
+ * only limited by the accuracy.
+ *
+ * The spectral radius of the Jacobian is estimated with SpectralRadius::powerIteration every 25 steps and after rejected
+ * steps. Neither the Jacobian nor any linear system is needed, the workspace consists of seven states. Like the other explicit
+ * integrators a step does not allocate memory apart from what f allocates for its result.
+ *
+ * The Instrumentation policy decides whether statistics are collected, see ExplicitRungeKuttaIntegrator.
+ *
+ */
+template <class Step, class Instrumentation = NoInstrumentation> class RungeKuttaChebyshevIntegrator {
+
+    public:
+        /**
+         * Constructor for the RungeKuttaChebyshevIntegrator
+         *
+         * @param rtol the relative tolerance of a step
+         * @param atol the absolute tolerance of a step
+         * @param maxStages the largest number of stages of a step, the step size is reduced if more would be needed
+         * @param maxStep the largest step size the integrator may use
+         */
+        RungeKuttaChebyshevIntegrator(double rtol = 1e-6, double atol = 1e-9, unsigned int maxStages = 250, double maxStep = std::numeric_limits<double>::infinity())
+            : rtol(rtol), atol(atol), maxStages(std::max(2u, maxStages)), maxStep(maxStep){
+        }
+
+        /**
+         * Integrates over [0, time] with adaptive step size and hands the state after every accepted step to the output
+         *
+         * @param f the function we are integrating over
+         * @param time the time interval we want to integrate over
+         * @param y0 the initial state of the system
+         * @param output receives y0 and the state after every accepted step, see rk_trajectory.hpp for the interface of an output
+         *
+         * @exception if the step size becomes too small an error will be thrown
+         */
+        template<typename Function, typename Output>
+        void solve(Function &&f, double time, const Step &y0, Output &output){
+
+            instrumentation.reset();
+            prepare(y0);
+            y = y0;
+            largestStages = 0;
+
+            output.initialize(y0.size(), 0);
+            output.push(0.0, y0);
+
+            if(time > 0){
+                integrate(f, time, output);
+            }
+
+            output.finalize();
+
+        }
+
+        /**
+         * @return the largest number of stages of a step in the last solve
+         */
+        unsigned int maximalStages() const {
+            return largestStages;
+        }
+
+        /**
+         * @return the statistics of the last solve (all zero unless the integrator uses StatisticsInstrumentation)
+         */
+        SolverStatistics statistics() const {
+            return instrumentation.statistics();
+        }
+
+        /**
+         * @return the instrumentation policy, for the data of a policy which goes beyond SolverStatistics
+         */
+        const Instrumentation &instrumentationPolicy() const {
+            return instrumentation;
+        }
+
+    private:
+        template<typename Function, typename Output>
+        void integrate(Function &&f, double time, Output &output){
+
+            auto evaluate = [&] (const Step &argument, Step &result) {
+                auto timer = instrumentation.time(Phase::Rhs);
+                result = f(argument);
+                instrumentation.count(Event::RhsEvaluation);
+            };
+
+            double t = 0;
+            double h;
+            double spectralRadius;
+            {
+                auto timer = instrumentation.time(Phase::Step);
+                evaluate(y, fy);
+                spectralRadius = SpectralRadius::powerIteration(evaluate, y, fy, direction, stage, previous);
+                h = StepSizeControl::initialStep(evaluate, y, fy, time, 2, rtol, atol, maxStep, stage, previous);
+            }
+
+            bool rejected = false;
+            unsigned int stepsSinceEstimate = 0;
+
+            while(t < time){
+                // the last step ends exactly at time
+                bool last = t + h >= time;
+                if(last){
+                    h = time - t;
+                }
+
+                // the stability region has to contain h times the spectral radius
+                unsigned int s = 1 + static_cast<unsigned int>(std::sqrt(1 + 1.54*h*spectralRadius));
+                if(s > maxStages){
+                    s = maxStages;
+                    h = ((s - 1.0)*(s - 1.0) - 1)/(1.54*spectralRadius);
+                    last = false;
+                }
+                s = std::max(2u, s);
+                largestStages = std::max(largestStages, s);
+
+                double error;
+                {
+                    auto timer = instrumentation.time(Phase::Step);
+                    iteration(evaluate, h, s);
+                    evaluate(y1, fy1);
+                    error = errorNorm(h);
+                }
+
+                if(error <= 1){
+                    instrumentation.count(Event::AcceptedStep);
+                    t = last ? time : t + h;
+                    std::swap(y, y1);
+                    std::swap(fy, fy1);
+                    {
+                        auto timer = instrumentation.time(Phase::Output);
+                        output.push(t, y);
+                    }
+
+                    h = std::min(h*StepSizeControl::factor(error, 2, rejected), maxStep);
+                    rejected = false;
+                    stepsSinceEstimate++;
+                }else{
+                    instrumentation.count(Event::RejectedStep);
+                    h *= StepSizeControl::factor(error, 2);
+                    rejected = true;
+                    // the rejection might be caused by an instability
+                    stepsSinceEstimate = estimateInterval;
+                }
+
+                if(t < time && stepsSinceEstimate >= estimateInterval){
+                    auto timer = instrumentation.time(Phase::Step);
+                    spectralRadius = SpectralRadius::powerIteration(evaluate, y, fy, direction, stage, previous);
+                    stepsSinceEstimate = 0;
+                }
+
+                if(t < time && StepSizeControl::tooSmall(h, t)){
+                    throw "Step size too small";
+                }
+            }
+
+        }
+
+        /**
+         * Sizes the workspace for states like y0, this is the only place where the integrator itself allocates memory
+         */
+        void prepare(const Step &y0){
+            fy = y0;
+            y1 = y0;
+            fy1 = y0;
+            stage = y0;
+            previous = y0;
+            direction = Step::Zero(y0.size());
+        }
+
+        /**
+         * Computes a step of size h with s stages from y in y1, f(y) = fy is known
+         */
+        template<typename Evaluate>
+        void iteration(Evaluate &&evaluate, const double h, const unsigned int s){
+
+            // the damping moves the stability region away from the real axis
+            const double w0 = 1 + 2.0/(13*s*s);
+            const double temp1 = w0*w0 - 1;
+            const double temp2 = std::sqrt(temp1);
+            const double argument = s*std::log(w0 + temp2);
+            const double w1 = std::sinh(argument)*temp1/(std::cosh(argument)*s*temp2 - w0*std::sinh(argument));
+
+            // the Chebyshev polynomials T_j(w0) and their derivatives by recurrence
+            double bjm1 = 1/(4*w0*w0);
+            double bjm2 = bjm1;
+            double zjm1 = w0, zjm2 = 1;
+            double dzjm1 = 1, dzjm2 = 0;
+            double d2zjm1 = 0, d2zjm2 = 0;
+
+            // the first stage, previous holds stage j-2 and y1 stage j-1
+            {
+                auto timer = instrumentation.time(Phase::Stages);
+                previous = y;
+                y1 = y + (h*w1*bjm1)*fy;
+            }
+
+            for(unsigned int j = 2; j <= s; j++){
+                const double zj = 2*w0*zjm1 - zjm2;
+                const double dzj = 2*w0*dzjm1 - dzjm2 + 2*zjm1;
+                const double d2zj = 2*w0*d2zjm1 - d2zjm2 + 4*dzjm1;
+                const double bj = d2zj/(dzj*dzj);
+                const double ajm1 = 1 - zjm1*bjm1;
+                const double mu = 2*w0*bj/bjm1;
+                const double nu = -bj/bjm2;
+                const double muTilde = mu*w1/w0;
+
+                evaluate(y1, stage);
+                {
+                    auto timer = instrumentation.time(Phase::Stages);
+                    // stage j overwrites stage j-2
+                    previous = mu*y1 + nu*previous + (1 - mu - nu)*y + (h*muTilde)*(stage - ajm1*fy);
+                    std::swap(previous, y1);
+                }
+
+                bjm2 = bjm1;
+                bjm1 = bj;
+                zjm2 = zjm1;
+                zjm1 = zj;
+                dzjm2 = dzjm1;
+                dzjm1 = dzj;
+                d2zjm2 = d2zjm1;
+                d2zjm1 = d2zj;
+            }
+
+        }
+
+        /**
+         * @return the scaled RMS norm of the error estimate 0.8 (y0 - y1) + 0.4 h (f(y0) + f(y1)) of the last step
+         */
+        double errorNorm(const double h){
+            auto timer = instrumentation.time(Phase::Stages);
+            return StepSizeControl::errorNorm(0.8*(y - y1) + (0.4*h)*(fy + fy1), y, y1, rtol, atol);
+        }
+
+
+        double rtol;
+        double atol;
+        unsigned int maxStages;
+        double maxStep;
+        unsigned int largestStages = 0;
+        Instrumentation instrumentation;
+        // the number of accepted steps after which the spectral radius is estimated again
+        static constexpr unsigned int estimateInterval = 25;
+
+        // workspace: the state and f before and after the step, the stages and the direction of the power iteration
+        Step y;
+        Step fy;
+        Step y1;
+        Step fy1;
+        Step stage;
+        Step previous;
+        Step direction;
+};
+
+
+
+
+// the coefficients of the orthogonal Runge Kutta Chebyshev methods ROCK2 and ROCK4
+namespace OrthogonalChebyshev{
+
+    /**
+     * A degree of the stability polynomial R_s(z) = w(z) P_(s-order)(z) of ROCK2 or ROCK4 (Abdulle, Medovikov, 2001 and
+     * Abdulle, 2002): P is orthogonal with respect to w(z)^2/sqrt(1 - x^2) on [-1, 1], where x = w0 + (w0 + 1) z/length,
+     * and w(z) = 1 + sum_k w_k z^k has degree order. Along the negative real axis |R_s| <= 1 on [-length, 0].
+     */
+    struct Degree {
+        // the number of stages s
+        unsigned int stages;
+        // the length of the stability interval
+        double length;
+        // w_1 to w_order of the weight (the coefficients of w for which P is orthogonal)
+        std::array<double, 4> w;
+    };
+
+    /**
+     * The coefficients of one degree: the stages g_j of P, g_0 = y and g_(j+1) = mu_j g_j + nu_j g_(j-1) + kappa_j h f(g_j),
+     * followed by the finishing procedure of order stages, which realizes w
+     */
+    struct Method {
+        unsigned int stages;
+        double length;
+        std::vector<double> mu;
+        std::vector<double> nu;
+        std::vector<double> kappa;
+        // ROCK2: w(z) = 1 + 2 sigma z + tau z^2
+        double sigma = 0;
+        double tau = 0;
+        // ROCK4: the explicit Runge Kutta method of 4 stages, started at g_(s-4), and the weights e of the error estimate
+        // h sum_i e_i k_i over its stages and f(y1)
+        Eigen::Matrix4d A = Eigen::Matrix4d::Zero();
+        Eigen::Vector4d b = Eigen::Vector4d::Zero();
+        Eigen::Matrix<double, 5, 1> e = Eigen::Matrix<double, 5, 1>::Zero();
+    };
+
+    // the damping of the stability polynomial, w0 = 1 + damping/s^2 as in RKC
+    constexpr double damping = 0.15;
+
+    /**
+     * The degrees of ROCK2 or ROCK4. The weights are the fixed points of the construction of Abdulle and Medovikov and the
+     * lengths the largest ones for which |R_s| <= 1 on [-length, 0], both computed for this implementation (they are not
+     * the tables of the published codes). Like there only a subset of the degrees is used above 20.
+     *
+     * @param order 2 or 4
+     */
+    inline const std::vector<Degree> &degrees(unsigned int order){
+        static const std::vector<Degree> rock2 = {
+            {2, 2.0, {1.0, 0.5}},
+            {3, 6.2284799442855405, {0.8227491360366614, 0.35416700481241137}},
+            {4, 12.023365239718418, {0.7821408269351215, 0.31821735520857564}},
+            {5, 19.439794161599867, {0.7656957553654605, 0.3033621157722549}},
+            {6, 28.49133390404866, {0.7572857570605473, 0.29569724298512673}},
+            {7, 39.18279467959189, {0.7523794251416244, 0.2912038246924367}},
+            {8, 51.50192203047243, {0.7491849875853985, 0.28828659764498443}},
+            {9, 65.4620332803082, {0.7470230502427332, 0.28630847236488416}},
+            {10, 81.06355258898292, {0.7454904440864882, 0.2849042973272366}},
+            {11, 98.3067382444564, {0.7443638727800553, 0.2838711212045446}},
+            {12, 117.19170512375031, {0.7435111386344718, 0.2830885204671742}},
+            {13, 137.7185646062485, {0.7428499955955321, 0.2824814108536483}},
+            {14, 159.88737947475116, {0.7423269510491826, 0.2820008978675121}},
+            {15, 183.69815409477124, {0.7419059349314758, 0.2816139891167149}},
+            {16, 209.15092306830286, {0.7415619980554237, 0.2812978294371037}},
+            {17, 236.2457635547156, {0.7412774480320297, 0.28103618705040245}},
+            {18, 264.9826226777139, {0.7410392762302117, 0.2808171522696054}},
+            {19, 295.36153008137137, {0.7408379279803649, 0.2806319526369929}},
+            {20, 327.3824844534445, {0.7406661688839021, 0.28047394940199555}},
+            {22, 396.35060497465463, {0.7403905562694058, 0.2802203655718743}},
+            {25, 512.1183938542242, {0.7400949185140839, 0.2799482924089162}},
+            {28, 642.664819257467, {0.739889325235827, 0.2797590599924053}},
+            {31, 787.9901253781935, {0.7397406535495722, 0.27962219100608576}},
+            {35, 1004.7463355049292, {0.7395988124227979, 0.2794916018876427}},
+            {39, 1247.7758629688515, {0.7394983700015764, 0.27939912402240796}},
+            {43, 1517.0790010961389, {0.7394246973406157, 0.2793312808586362}},
+            {48, 1890.6548139589072, {0.7393572323490742, 0.27926915588489604}},
+            {53, 2305.282899812157, {0.7393079600619507, 0.2792237812509845}},
+            {59, 2857.02557146977, {0.7392645707781557, 0.2791838234015638}},
+            {65, 3467.883706407703, {0.7392326540943751, 0.2791544264409587}},
+            {72, 4255.266564680136, {0.7392050249538337, 0.2791289798541279}},
+            {80, 5253.6578485224, {0.7391818837160671, 0.27910767006013787}},
+            {88, 6357.142939326506, {0.7391647633940447, 0.2790919044683534}},
+            {97, 7724.1835953623495, {0.7391503372896482, 0.2790786198941717}},
+            {107, 9399.117623825949, {0.7391384222731326, 0.27906763853220146}},
+            {118, 11431.205560284488, {0.7391286268772016, 0.27905861697575784}},
+            {130, 13874.63697459596, {0.7391206404203211, 0.2790512631422101}},
+            {143, 16788.52751594536, {0.7391141564698759, 0.27904529254779}},
+            {158, 20495.54803861009, {0.7391085725936932, 0.27904015069784094}},
+            {174, 24856.940696974903, {0.7391041227440598, 0.2790360560100194}},
+            {192, 30265.991505243906, {0.7391004254214467, 0.2790326446715368}},
+            {212, 36900.04158978031, {0.7390973609667656, 0.2790298195011233}},
+            {234, 44956.13806075865, {0.7390948251076424, 0.2790274886747775}},
+            {250, 51314.31310178958, {0.7390933872545857, 0.27902616676932124}}
+        };
+        static const std::vector<Degree> rock4 = {
+            {5, 6.052917016148162, {0.825515635780961, 0.3559604291378833, 0.10455713750140683, 0.023423081005171053}},
+            {6, 9.939872836319138, {0.7651962771972325, 0.30674339577403836, 0.08424647154269206, 0.01771796706846724}},
+            {7, 14.528636643814568, {0.7360304761389406, 0.2829897847452756, 0.07460293802275551, 0.015073010707560513}},
+            {8, 19.826033867424744, {0.7194621417780247, 0.26947980359197427, 0.06915782609617419, 0.013599214293052041}},
+            {9, 25.832525262655672, {0.7090607337769037, 0.26098242772752156, 0.0657452276518937, 0.012682864461286785}},
+            {10, 32.54775463856202, {0.7020653721880916, 0.255256970031272, 0.06345018444793772, 0.012069738052172499}},
+            {11, 39.971349711096195, {0.697116924575129, 0.2512001745112477, 0.061825729364888296, 0.011637258272231795}},
+            {12, 48.103034086091114, {0.6934782702667007, 0.24821297657962618, 0.06063029524193812, 0.011319773643416138}},
+            {13, 56.94260501367748, {0.690719382900994, 0.24594536384366733, 0.05972315477560496, 0.011079285244186835}},
+            {14, 66.48992089322049, {0.6885747678047728, 0.24418089737390472, 0.05901744669344415, 0.010892450310147055}},
+            {15, 76.74488284002082, {0.6868728513965955, 0.24277949306803032, 0.05845702045268807, 0.01074423331536882}},
+            {16, 87.70741744458982, {0.6854984972692487, 0.2416470178439541, 0.05800417541581656, 0.01062456723743486}},
+            {17, 99.37747039900674, {0.6843719825760454, 0.24071821090041157, 0.05763278885017581, 0.010526491932556734}},
+            {18, 111.75499067569326, {0.683436580558851, 0.23994658995808987, 0.057324263137095134, 0.01044506120725362}},
+            {19, 124.83997000114496, {0.6826511083604304, 0.23929835886780573, 0.05706507580227654, 0.010376683015346444}},
+            {20, 138.63240072722772, {0.6819849679787058, 0.23874839017750507, 0.05684517573948769, 0.01031869076461462}},
+            {22, 168.33943140917768, {0.6809231964237198, 0.23787140020647343, 0.056494522230189054, 0.010226257751833934}},
+            {25, 218.20537138630198, {0.6797941435932839, 0.23693826860152953, 0.05612141327986674, 0.010127959718034502}},
+            {28, 274.43760860457337, {0.6790151782097869, 0.23629412265868507, 0.05586384651694164, 0.010060134315583363}},
+            {31, 337.03602488138466, {0.6784547883523973, 0.2358305410913721, 0.05567847499912228, 0.0100113363715473}},
+            {35, 430.403389131812, {0.6779226153091702, 0.2353901633588671, 0.05550237853375214, 0.009964992664372977}},
+            {39, 535.0881959956205, {0.6775472563333363, 0.23507946651467043, 0.05537813558051626, 0.009932302650719716}},
+            {43, 651.090529264946, {0.677272620140149, 0.234852083343553, 0.05528720379897592, 0.009908380508123045}},
+            {48, 812.0083696830746, {0.6770216941226467, 0.2346443090497392, 0.05520411513463926, 0.009886524989077033}},
+            {53, 990.6096067520803, {0.6768387712443716, 0.23449282082853543, 0.05514353382732659, 0.009870591348423831}},
+            {59, 1228.2731914679625, {0.6766779538495507, 0.23435962056864096, 0.055090264343562685, 0.00985658178036659}},
+            {65, 1491.400687991018, {0.6765597163909304, 0.23426168374638165, 0.05505109805310317, 0.009846282140772322}},
+            {72, 1830.5664244060295, {0.6764574892556008, 0.23417700223505414, 0.05501723241569086, 0.009837376884219278}},
+            {80, 2260.6243277441517, {0.6763719893265154, 0.23410617412880128, 0.05498890712318725, 0.00982992889914348}},
+            {88, 2735.951777344821, {0.6763088094137555, 0.23405382700380578, 0.05496797104134576, 0.00982442379447973}},
+            {97, 3324.8055751614934, {0.6762555428816377, 0.23400970275066998, 0.05495032614657104, 0.009819784683323176}},
+            {107, 4046.284619214148, {0.6762114638932984, 0.23397317984560959, 0.054935718987314815, 0.00981594398690119}},
+            {118, 4921.608057453339, {0.6761753107195134, 0.23394322898418196, 0.05492374157461486, 0.009812795031965152}},
+            {130, 5974.119088893798, {0.6761459234000826, 0.23391887275428216, 0.05491399909635334, 0.009810233282059546}},
+            {143, 7229.2804066430435, {0.6761220403169624, 0.2338990830560779, 0.054906084374698946, 0.009808152367098347}},
+            {158, 8826.082549483323, {0.6761014465893235, 0.23388202417776038, 0.05489926309596228, 0.009806359184312238}},
+            {174, 10704.757242239568, {0.6760851084584166, 0.23386848584112907, 0.05489384851506659, 0.009804935622733643}},
+            {192, 13034.709458271695, {0.6760713747277748, 0.23385710812293664, 0.054889298674104046, 0.009803739530517414}},
+            {212, 15892.333363758718, {0.6760600711488869, 0.2338477357382928, 0.054885548898517725, 0.009802753443037451}},
+            {234, 19362.503947365043, {0.6760507685319181, 0.233840034138558, 0.05488247033523297, 0.009801944358740902}},
+            {250, 22101.296165041407, {0.6760455353968181, 0.2338356929895148, 0.05488073301465819, 0.009801487410363028}}
+        };
+        return order == 2 ? rock2 : rock4;
+    }
+
+    /**
+     * Computes the three term recurrence of P for a degree with the discretized Stieltjes procedure: the orthonormal
+     * polynomials are evaluated at the Chebyshev points, whose Gauss quadrature is exact for all products needed.
+     *
+     * @param degree the degree of the stability polynomial
+     * @param order 2 or 4
+     * @param method receives stages, length, mu, nu and kappa
+     */
+    inline void recurrence(const Degree &degree, unsigned int order, Method &method){
+
+        const unsigned int m = degree.stages - order;
+        const double w0 = 1 + damping/(degree.stages*degree.stages);
+        const double scale = (w0 + 1)/degree.length;
+
+        method.stages = degree.stages;
+        method.length = degree.length;
+        method.mu.assign(m, 1);
+        method.nu.assign(m, 0);
+        method.kappa.assign(m, 0);
+
+        const unsigned int n = m + order + 3;
+        Eigen::ArrayXd x(n), weight(n), q(n), qPrevious = Eigen::ArrayXd::Zero(n), next(n);
+        for(unsigned int k = 0; k < n; k++){
+            x(k) = std::cos((2*k + 1)*M_PI/(2*n));
+            const double z = (x(k) - w0)/scale;
+            double w = 0;
+            for(int i = order; i >= 1; i--){
+                w = (w + degree.w[i - 1])*z;
+            }
+            weight(k) = (1 + w)*(1 + w);
+        }
+        q = Eigen::ArrayXd::Constant(n, 1/std::sqrt(weight.sum()));
+
+        // the monic recurrence p_(j+1) = (x - alpha_j) p_j - beta_j p_(j-1), normalized to P_j(z) = p_j(x)/p_j(w0)
+        double beta = 0;
+        // p_j(w0)/p_(j-1)(w0)
+        double ratio = 1;
+        for(unsigned int j = 0; j < m; j++){
+            const double alpha = (weight*x*q*q).sum();
+            next = (x - alpha)*q - std::sqrt(beta)*qPrevious;
+            const double nextRatio = (w0 - alpha) - (j == 0 ? 0 : beta/ratio);
+            method.mu[j] = (w0 - alpha)/nextRatio;
+            method.nu[j] = j == 0 ? 0 : -beta/(ratio*nextRatio);
+            method.kappa[j] = scale/nextRatio;
+
+            beta = (weight*next*next).sum();
+            qPrevious = q;
+            q = next/std::sqrt(beta);
+            ratio = nextRatio;
+        }
+    }
+
+    /**
+     * @return the coefficients 1, w_1, .., w_order of w for which R = w P agrees with exp(z) up to z^order, computed from
+     * the recurrence of P in method
+     */
+    inline Eigen::Matrix<double, 5, 1> weightPolynomial(const Method &method, unsigned int order){
+        // the Taylor coefficients of the stages P_j(z) up to z^order
+        Eigen::Matrix<double, 5, 1> p = Eigen::Matrix<double, 5, 1>::Zero(), pPrevious = p, next;
+        p(0) = 1;
+        for(std::size_t j = 0; j < method.mu.size(); j++){
+            next = method.mu[j]*p + method.nu[j]*pPrevious;
+            for(unsigned int k = 1; k <= order; k++){
+                next(k) += method.kappa[j]*p(k - 1);
+            }
+            pPrevious = p;
+            p = next;
+        }
+
+        Eigen::Matrix<double, 5, 1> w = Eigen::Matrix<double, 5, 1>::Zero();
+        double factorial = 1;
+        w(0) = 1;
+        for(unsigned int k = 1; k <= order; k++){
+            factorial *= k;
+            w(k) = 1/factorial;
+            for(unsigned int i = 0; i < k; i++){
+                w(k) -= w(i)*p(k - i);
+            }
+        }
+        return w;
+    }
+
+    /**
+     * @return the elementary weights of the stages of P at g_(s-4), i.e. sum_j b_j phi(t)_j over the stages of P for the
+     * trees up to order 4 as used in finishingConditions
+     */
+    inline Eigen::Matrix<double, 8, 1> elementaryWeights(const Method &method){
+        // for every tree the weights of g_j, they follow the same recurrence as the stages
+        Eigen::Matrix<double, 8, 1> current = Eigen::Matrix<double, 8, 1>::Zero(), previous = current, next, stage;
+        for(std::size_t j = 0; j < method.mu.size(); j++){
+            const double c = current(0), Ac = current(1), Ac2 = current(2), AAc = current(3);
+            stage << 1, c, c*c, Ac, c*c*c, c*Ac, Ac2, AAc;
+            next = method.mu[j]*current + method.nu[j]*previous + method.kappa[j]*stage;
+            previous = current;
+            current = next;
+        }
+        return current;
+    }
+
+    /**
+     * @return the residuals of the 8 order conditions of order 4 of the whole step: the stages of P, whose elementary
+     * weights are P, followed by the finishing procedure with the coefficients x = (a21, a31, a32, a41, a42, a43, b)
+     */
+    inline Eigen::Matrix<double, 8, 1> finishingConditions(const Eigen::Matrix<double, 10, 1> &x, const Eigen::Matrix<double, 8, 1> &P){
+        Eigen::Matrix4d a = Eigen::Matrix4d::Zero();
+        a(1,0) = x(0);
+        a(2,0) = x(1);
+        a(2,1) = x(2);
+        a(3,0) = x(3);
+        a(3,1) = x(4);
+        a(3,2) = x(5);
+        const Eigen::Vector4d b = x.tail<4>();
+
+        const Eigen::Vector4d c = (P(0) + (a*Eigen::Vector4d::Ones()).array()).matrix();
+        const Eigen::Vector4d Ac = (P(1) + (a*c).array()).matrix();
+        const Eigen::Vector4d Ac2 = (P(2) + (a*c.cwiseAbs2()).array()).matrix();
+        const Eigen::Vector4d AAc = (P(3) + (a*Ac).array()).matrix();
+
+        Eigen::Matrix<double, 8, 1> residuals;
+        residuals << P(0) + b.sum() - 1,
+                     P(1) + b.dot(c) - 1.0/2,
+                     P(2) + b.dot(c.cwiseAbs2()) - 1.0/3,
+                     P(3) + b.dot(Ac) - 1.0/6,
+                     P(4) + b.dot(c.cwiseAbs2().cwiseProduct(c)) - 1.0/4,
+                     P(5) + b.dot(c.cwiseProduct(Ac)) - 1.0/8,
+                     P(6) + b.dot(Ac2) - 1.0/12,
+                     P(7) + b.dot(AAc) - 1.0/24;
+        return residuals;
+    }
+
+    /**
+     * Computes the finishing procedure of ROCK4 for a degree: the 8 order conditions of order 4 of the whole step are
+     * solved for the 10 coefficients of an explicit 4 stage method with the Gauss-Newton method (minimal corrections),
+     * starting at guess. The third order error estimator uses f(y1) and has a leading coefficient of -z^4/24 for y' = z y.
+     *
+     * @param guess the starting point of the iteration, overwritten with the solution
+     *
+     * @exception if the iteration does not converge an error will be thrown
+     */
+    inline void finishing(Method &method, Eigen::Matrix<double, 10, 1> &guess){
+
+        const Eigen::Matrix<double, 8, 1> P = elementaryWeights(method);
+        Eigen::Matrix<double, 10, 1> &x = guess;
+        Eigen::Matrix<double, 8, 10> jacobian;
+        unsigned int iteration = 0;
+        for(Eigen::Matrix<double, 8, 1> residuals = finishingConditions(x, P); residuals.cwiseAbs().maxCoeff() > 1e-14; residuals = finishingConditions(x, P)){
+            if(++iteration > 50){
+                throw "No finishing procedure of ROCK4 found";
+            }
+            for(unsigned int i = 0; i < 10; i++){
+                Eigen::Matrix<double, 10, 1> dx = Eigen::Matrix<double, 10, 1>::Zero();
+                dx(i) = 1e-6;
+                jacobian.col(i) = (finishingConditions(x + dx, P) - finishingConditions(x - dx, P))/2e-6;
+            }
+            x -= jacobian.completeOrthogonalDecomposition().solve(residuals);
+        }
+
+        method.A.setZero();
+        method.A(1,0) = x(0);
+        method.A(2,0) = x(1);
+        method.A(2,1) = x(2);
+        method.A(3,0) = x(3);
+        method.A(3,1) = x(4);
+        method.A(3,2) = x(5);
+        method.b = x.tail<4>();
+
+        // the embedded method b + d with d_5 = gamma for f(y1) (c = 1, A c = 1/2) satisfies the conditions of order 3
+        const Eigen::Vector4d c = (P(0) + (method.A*Eigen::Vector4d::Ones()).array()).matrix();
+        const Eigen::Vector4d Ac = (P(1) + (method.A*c).array()).matrix();
+        const Eigen::Vector4d AAc = (P(3) + (method.A*Ac).array()).matrix();
+        Eigen::Matrix4d conditions;
+        conditions.row(0).setOnes();
+        conditions.row(1) = c;
+        conditions.row(2) = c.cwiseAbs2();
+        conditions.row(3) = Ac;
+        const Eigen::Vector4d d = conditions.partialPivLu().solve(-Eigen::Vector4d(1, 1, 1, 0.5));
+        const double gamma = -1/(24*(d.dot(AAc) + 1.0/6));
+        method.e << gamma*d, gamma;
+    }
+
+    /**
+     * Computes the coefficients of all degrees of ROCK2 or ROCK4 up to the given number of stages
+     *
+     * @param order 2 or 4
+     * @param maxStages the largest number of stages, at least the smallest degree is returned
+     */
+    inline std::vector<Method> methods(unsigned int order, unsigned int maxStages){
+        std::vector<Method> result;
+        // the finishing procedure of ROCK4 for many stages, the start of the continuation over the degrees
+        Eigen::Matrix<double, 10, 1> guess;
+        guess << 0.2775, -0.05, 0.3667, -0.0233, -0.131, 0.8535, 0.0444, 0.2388, 0.2799, 0.1129;
+
+        for(const Degree &degree : degrees(order)){
+            if(!result.empty() && degree.stages > maxStages){
+                break;
+            }
+            Method method;
+            recurrence(degree, order, method);
+            if(order == 2){
+                const Eigen::Matrix<double, 5, 1> w = weightPolynomial(method, 2);
+                method.sigma = w(1)/2;
+                method.tau = w(2);
+            }else{
+                finishing(method, guess);
+            }
+            result.push_back(method);
+        }
+        return result;
+    }
+
+}
+
+
+
+
+/**
+ *
+ * Implementation of the orthogonal Runge Kutta Chebyshev methods ROCK2 and ROCK4 (Abdulle, Medovikov, 2001 and Abdulle,
+ * 2002) for mildly stiff problems whose Jacobian has eigenvalues close to the negative real axis. Compared to RKC their
+ * stability polynomial R_s = w P_(s-order) has a larger stability interval (about 0.82 s^2 for ROCK2 and 0.35 s^2 for
+ * ROCK4) and order 4 is possible: the stages of P follow a three term recurrence, then a finishing procedure of 2 or 4
+ * stages realizes w and the order conditions (for ROCK4 also the nonlinear ones). The coefficients of all degrees are
+ * computed on construction, see OrthogonalChebyshev.
+ *
+ * The error of ROCK2 is estimated by the difference to the first order method inside the finishing procedure, the one of
+ * ROCK4 by an embedded method of order 3 using f(y1). Like RungeKuttaChebyshevIntegrator the spectral radius of the
+ * Jacobian is estimated with SpectralRadius::powerIteration, neither the Jacobian nor any linear system is needed. A step
+ * does not allocate memory apart from what f allocates for its result.
+ *
+ * The Instrumentation policy decides whether statistics are collected, see ExplicitRungeKuttaIntegrator.
+ *
+ */
+template <class Step, class Instrumentation = NoInstrumentation> class ROCKIntegrator {
+
+    public:
+        /**
+         * Constructor for the ROCKIntegrator
+         *
+         * @param order 2 for ROCK2 or 4 for ROCK4
+         * @param rtol the relative tolerance of a step
+         * @param atol the absolute tolerance of a step
+         * @param maxStages the largest number of stages of a step, the step size is reduced if more would be needed
+         * @param maxStep the largest step size the integrator may use
+         *
+         * @exception if the order is neither 2 nor 4 an error will be thrown
+         */
+        ROCKIntegrator(unsigned int order = 2, double rtol = 1e-6, double atol = 1e-9, unsigned int maxStages = 250, double maxStep = std::numeric_limits<double>::infinity())
+            : order(order), rtol(rtol), atol(atol), maxStep(maxStep){
+            if(order != 2 && order != 4){
+                throw "The order of the ROCK method must be 2 or 4";
+            }
+            methods = OrthogonalChebyshev::methods(order, maxStages);
+        }
+
+        /**
+         * Integrates over [0, time] with adaptive step size and hands the state after every accepted step to the output
+         *
+         * @param f the function we are integrating over
+         * @param time the time interval we want to integrate over
+         * @param y0 the initial state of the system
+         * @param output receives y0 and the state after every accepted step, see rk_trajectory.hpp for the interface of an output
+         *
+         * @exception if the step size becomes too small an error will be thrown
+         */
+        template<typename Function, typename Output>
+        void solve(Function &&f, double time, const Step &y0, Output &output){
+
+            instrumentation.reset();
+            prepare(y0);
+            y = y0;
+            largestStages = 0;
+
+            output.initialize(y0.size(), 0);
+            output.push(0.0, y0);
+
+            if(time > 0){
+                integrate(f, time, output);
+            }
+
+            output.finalize();
+
+        }
+
+        /**
+         * @return the largest number of stages of a step in the last solve
+         */
+        unsigned int maximalStages() const {
+            return largestStages;
+        }
+
+        /**
+         * @return the statistics of the last solve (all zero unless the integrator uses StatisticsInstrumentation)
+         */
+        SolverStatistics statistics() const {
+            return instrumentation.statistics();
+        }
+
+        /**
+         * @return the instrumentation policy, for the data of a policy which goes beyond SolverStatistics
+         */
+        const Instrumentation &instrumentationPolicy() const {
+            return instrumentation;
+        }
+
+    private:
+        template<typename Function, typename Output>
+        void integrate(Function &&f, double time, Output &output){
+
+            auto evaluate = [&] (const Step &argument, Step &result) {
+                auto timer = instrumentation.time(Phase::Rhs);
+                result = f(argument);
+                instrumentation.count(Event::RhsEvaluation);
+            };
+
+            // the error estimate of ROCK2 is of first order, the one of ROCK4 of third order
+            const unsigned int estimatorOrder = order - 1;
+
+            double t = 0;
+            double h;
+            double spectralRadius;
+            {
+                auto timer = instrumentation.time(Phase::Step);
+                evaluate(y, fy);
+                spectralRadius = SpectralRadius::powerIteration(evaluate, y, fy, direction, stage, previous);
+                h = StepSizeControl::initialStep(evaluate, y, fy, time, order, rtol, atol, maxStep, stage, previous);
+            }
+
+            bool rejected = false;
+            unsigned int stepsSinceEstimate = 0;
+
+            while(t < time){
+                // the last step ends exactly at time
+                bool last = t + h >= time;
+                if(last){
+                    h = time - t;
+                }
+
+                // the smallest degree whose stability interval contains h times the spectral radius
+                std::size_t degree = 0;
+                while(degree + 1 < methods.size() && methods[degree].length < h*spectralRadius){
+                    degree++;
+                }
+                if(methods[degree].length < h*spectralRadius){
+                    h = methods[degree].length/spectralRadius;
+                    last = false;
+                }
+                const OrthogonalChebyshev::Method &method = methods[degree];
+                largestStages = std::max(largestStages, method.stages);
+
+                double error;
+                {
+                    auto timer = instrumentation.time(Phase::Step);
+                    chebyshevStages(evaluate, method, h);
+                    error = order == 2 ? finishing2(evaluate, method, h) : finishing4(evaluate, method, h);
+                }
+
+                if(error <= 1){
+                    instrumentation.count(Event::AcceptedStep);
+                    t = last ? time : t + h;
+                    std::swap(y, y1);
+                    {
+                        auto timer = instrumentation.time(Phase::Step);
+                        if(order == 2){
+                            evaluate(y, fy);
+                        }else{
+                            // ROCK4 already evaluated f(y1) for the error estimate
+                            std::swap(fy, fy1);
+                        }
+                    }
+                    {
+                        auto timer = instrumentation.time(Phase::Output);
+                        output.push(t, y);
+                    }
+
+                    h = std::min(h*StepSizeControl::factor(error, estimatorOrder, rejected), maxStep);
+                    rejected = false;
+                    stepsSinceEstimate++;
+                }else{
+                    instrumentation.count(Event::RejectedStep);
+                    h *= StepSizeControl::factor(error, estimatorOrder);
+                    rejected = true;
+                    // the rejection might be caused by an instability
+                    stepsSinceEstimate = estimateInterval;
+                }
+
+                if(t < time && stepsSinceEstimate >= estimateInterval){
+                    auto timer = instrumentation.time(Phase::Step);
+                    spectralRadius = SpectralRadius::powerIteration(evaluate, y, fy, direction, stage, previous);
+                    stepsSinceEstimate = 0;
+                }
+
+                if(t < time && StepSizeControl::tooSmall(h, t)){
+                    throw "Step size too small";
+                }
+            }
+
+        }
+
+        /**
+         * Sizes the workspace for states like y0, this is the only place where the integrator itself allocates memory
+         */
+        void prepare(const Step &y0){
+            fy = y0;
+            y1 = y0;
+            fy1 = y0;
+            stage = y0;
+            previous = y0;
+            k.fill(y0);
+            direction = Step::Zero(y0.size());
+        }
+
+        /**
+         * Computes the stages of P from y, afterwards y1 holds g_(s-order) and k[0] = f(g_(s-order)), f(y) = fy is known
+         */
+        template<typename Evaluate>
+        void chebyshevStages(Evaluate &&evaluate, const OrthogonalChebyshev::Method &method, const double h){
+
+            // previous holds stage j-1 and y1 stage j
+            {
+                auto timer = instrumentation.time(Phase::Stages);
+                y1 = y;
+            }
+            for(std::size_t j = 0; j < method.mu.size(); j++){
+                if(j == 0){
+                    k[0] = fy;
+                }else{
+                    evaluate(y1, k[0]);
+                }
+                auto timer = instrumentation.time(Phase::Stages);
+                // stage j+1 overwrites stage j-1
+                if(j == 0){
+                    previous = y1 + (h*method.kappa[0])*k[0];
+                }else{
+                    previous = method.mu[j]*y1 + method.nu[j]*previous + (h*method.kappa[j])*k[0];
+                }
+                std::swap(previous, y1);
+            }
+            if(method.mu.empty()){
+                k[0] = fy;
+            }else{
+                evaluate(y1, k[0]);
+            }
+
+        }
+
+        /**
+         * The finishing procedure of ROCK2: g_(s-1) = g_(s-2) + h sigma f(g_(s-2)), g* = g_(s-1) + h sigma f(g_(s-1)) and
+         * y1 = g* - h sigma (1 - tau/sigma^2) (f(g_(s-1)) - f(g_(s-2))), where the last term estimates the error of g*.
+         *
+         * @return the scaled RMS norm of the error estimate
+         */
+        template<typename Evaluate>
+        double finishing2(Evaluate &&evaluate, const OrthogonalChebyshev::Method &method, const double h){
+
+            {
+                auto timer = instrumentation.time(Phase::Stages);
+                previous = y1 + (h*method.sigma)*k[0];
+            }
+            evaluate(previous, k[1]);
+
+            auto timer = instrumentation.time(Phase::Stages);
+            const double correction = h*method.sigma*(1 - method.tau/(method.sigma*method.sigma));
+            stage = correction*(k[1] - k[0]);
+            y1 = previous + (h*method.sigma)*k[1] - stage;
+            return StepSizeControl::errorNorm(stage, y, y1, rtol, atol);
+        }
+
+        /**
+         * The finishing procedure of ROCK4, an explicit method of 4 stages from g_(s-4) whose first stage k[0] is known.
+         * f(y1) is stored in fy1.
+         *
+         * @return the scaled RMS norm of the error estimate
+         */
+        template<typename Evaluate>
+        double finishing4(Evaluate &&evaluate, const OrthogonalChebyshev::Method &method, const double h){
+
+            for(unsigned int i = 1; i < 4; i++){
+                {
+                    auto timer = instrumentation.time(Phase::Stages);
+                    stage = y1;
+                    for(unsigned int j = 0; j < i; j++){
+                        stage += (h*method.A(i,j))*k[j];
+                    }
+                }
+                evaluate(stage, k[i]);
+            }
+
+            {
+                auto timer = instrumentation.time(Phase::Stages);
+                for(unsigned int i = 0; i < 4; i++){
+                    y1 += (h*method.b(i))*k[i];
+                }
+            }
+            evaluate(y1, fy1);
+
+            auto timer = instrumentation.time(Phase::Stages);
+            stage = (h*method.e(4))*fy1;
+            for(unsigned int i = 0; i < 4; i++){
+                stage += (h*method.e(i))*k[i];
+            }
+            return StepSizeControl::errorNorm(stage, y, y1, rtol, atol);
+        }
+
+
+        unsigned int order;
+        double rtol;
+        double atol;
+        double maxStep;
+        unsigned int largestStages = 0;
+        std::vector<OrthogonalChebyshev::Method> methods;
+        Instrumentation instrumentation;
+        // the number of accepted steps after which the spectral radius is estimated again
+        static constexpr unsigned int estimateInterval = 25;
+
+        // workspace: the state and f before and after the step, the stages, the stages of the finishing procedure and the
+        // direction of the power iteration
+        Step y;
+        Step fy;
+        Step y1;
+        Step fy1;
+        Step stage;
+        Step previous;
+        std::array<Step, 4> k;
+        Step direction;
+};
+
+
+
+
+
+#endif
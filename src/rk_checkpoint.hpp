@@ -0,0 +1,183 @@
+#ifndef RKCHECKPOINT
+
+#define RKCHECKPOINT
+
+#include <Eigen/Dense>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include <unistd.h>
+
+
+
+
+/**
+ *
+ * Everything needed to continue an integration exactly where it stopped. Checkpoints are written to a compact binary file,
+ * the state is stored bit by bit, hence a resumed integration computes exactly the same states as an uninterrupted one.
+ *
+ */
+struct Checkpoint {
+
+    // the number of steps which have been completed
+    std::uint64_t step;
+    // the time of the state
+    double t;
+    // the (current) step size
+    double h;
+    // identifies the method (e.g. the butcher tableau), resuming with a different method is refused
+    std::uint64_t method;
+    // the state after step steps
+    Eigen::VectorXd state;
+    // additional integrator specific data (e.g. step size controller state, FSAL stage or Jacobian), empty if not needed
+    Eigen::VectorXd extra;
+
+    /**
+     * Writes the checkpoint to a file. The checkpoint is first written to a temporary file and synced to the disk, then it
+     * replaces the old file, hence an interrupted write never destroys the previous checkpoint (POSIX only).
+     *
+     * @param filename the checkpoint file
+     *
+     * @exception if the file can not be written an error will be thrown
+     */
+    void save(const std::string &filename) const {
+        std::string temporary = filename + ".tmp";
+        std::FILE *file = std::fopen(temporary.c_str(), "wb");
+        if(file == nullptr){
+            throw "Could not write checkpoint";
+        }
+
+        std::uint64_t header[4] = {magic, step, method, static_cast<std::uint64_t>(state.size())};
+        std::uint64_t extraSize = extra.size();
+        bool written = std::fwrite(header, sizeof(header), 1, file) == 1
+                       && std::fwrite(&t, sizeof(double), 1, file) == 1
+                       && std::fwrite(&h, sizeof(double), 1, file) == 1
+                       && std::fwrite(state.data(), sizeof(double), state.size(), file) == static_cast<std::size_t>(state.size())
+                       && std::fwrite(&extraSize, sizeof(extraSize), 1, file) == 1
+                       && std::fwrite(extra.data(), sizeof(double), extra.size(), file) == static_cast<std::size_t>(extra.size());
+        // the new checkpoint has to be on the disk before it replaces the old one, else a crash could leave neither
+        written = written && std::fflush(file) == 0 && ::fsync(::fileno(file)) == 0;
+        written = std::fclose(file) == 0 && written;
+
+        if(!written || std::rename(temporary.c_str(), filename.c_str()) != 0){
+            std::remove(temporary.c_str());
+            throw "Could not write checkpoint";
+        }
+    }
+
+    /**
+     * Reads a checkpoint written by save
+     *
+     * @param filename the checkpoint file
+     *
+     * @exception if the file can not be read, is not a checkpoint or its sizes do not match its length an error will be thrown
+     */
+    static Checkpoint load(const std::string &filename){
+        std::ifstream file(filename, std::ios::binary | std::ios::ate);
+        if(!file){
+            throw "Could not read checkpoint";
+        }
+        const std::uint64_t bytes = file.tellg();
+        file.seekg(0);
+
+        Checkpoint checkpoint;
+        std::uint64_t header[4];
+        std::uint64_t extraSize;
+        file.read(reinterpret_cast<char*>(header), sizeof(header));
+        if(!file || header[0] != magic){
+            throw "Not a checkpoint file";
+        }
+
+        // the sizes in the file are checked against its length before anything is allocated
+        const std::uint64_t fixed = sizeof(header) + 2*sizeof(double) + sizeof(extraSize);
+        const std::uint64_t values = bytes >= fixed ? (bytes - fixed)/sizeof(double) : 0;
+        if(bytes < fixed || (bytes - fixed) % sizeof(double) != 0 || header[3] > values){
+            throw "Could not read checkpoint";
+        }
+
+        checkpoint.step = header[1];
+        checkpoint.method = header[2];
+        checkpoint.state.resize(header[3]);
+        file.read(reinterpret_cast<char*>(&checkpoint.t), sizeof(double));
+        file.read(reinterpret_cast<char*>(&checkpoint.h), sizeof(double));
+        file.read(reinterpret_cast<char*>(checkpoint.state.data()), checkpoint.state.size()*sizeof(double));
+        file.read(reinterpret_cast<char*>(&extraSize), sizeof(extraSize));
+        if(!file || extraSize != values - header[3]){
+            throw "Could not read checkpoint";
+        }
+        checkpoint.extra.resize(extraSize);
+        file.read(reinterpret_cast<char*>(checkpoint.extra.data()), checkpoint.extra.size()*sizeof(double));
+        if(!file){
+            throw "Could not read checkpoint";
+        }
+        return checkpoint;
+    }
+
+    /**
+     * Computes a fingerprint of a method (FNV-1a hash of its coefficients) to detect resuming with another method
+     *
+     * @param coefficients all coefficients defining the method, e.g. A and b of a butcher tableau
+     */
+    template<typename... Coefficients>
+    static std::uint64_t fingerprint(const Coefficients &... coefficients){
+        std::uint64_t hash = 14695981039346656037ull;
+        auto add = [&hash] (const auto &matrix) {
+            const unsigned char *bytes = reinterpret_cast<const unsigned char*>(matrix.data());
+            for(std::size_t i = 0; i < matrix.size()*sizeof(double); i++){
+                hash = (hash ^ bytes[i]) * 1099511628211ull;
+            }
+        };
+        (add(coefficients), ...);
+        return hash;
+    }
+
+    static constexpr std::uint64_t magic = 0x544e494f504b4352ull; // "RKCPOINT"
+};
+
+
+
+
+/**
+ *
+ * Tells an integrator where and how often to write checkpoints. Pass it to solve to write checkpoints periodically
+ * and to resume to continue from the last written checkpoint.
+ *
+ */
+class Checkpointer {
+
+    public:
+        /**
+         * Constructor for the Checkpointer
+         *
+         * @param filename the checkpoint file, it is overwritten by every new checkpoint
+         * @param interval a checkpoint is written every interval steps (0 disables writing checkpoints)
+         */
+        Checkpointer(const std::string &filename, unsigned int interval) : filename(filename), interval(interval){
+        }
+
+        /**
+         * @return true if a checkpoint has to be written after the given number of completed steps
+         */
+        bool due(std::uint64_t step) const {
+            return interval > 0 && step % interval == 0;
+        }
+
+        void save(const Checkpoint &checkpoint) const {
+            checkpoint.save(filename);
+        }
+
+        Checkpoint load() const {
+            return Checkpoint::load(filename);
+        }
+
+    private:
+        std::string filename;
+        unsigned int interval;
+};
+
+
+
+
+#endif
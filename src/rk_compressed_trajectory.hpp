@@ -0,0 +1,503 @@
+#ifndef RKCOMPRESSEDTRAJECTORY
+
+#define RKCOMPRESSEDTRAJECTORY
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+
+
+/**
+ *
+ * The codecs a CompressedTrajectory can use for the states. Times are always stored lossless.
+ *
+ */
+enum class Codec {
+    // lossless, every value is XORed with its prediction from the previous states and only the differing bits are stored
+    Xor,
+    // lossy, values are rounded to a multiple of 2*tolerance (absolute error at most tolerance), the differences of the rounded values to their prediction are stored
+    Quantized,
+    // lossy, values are stored as 16 bit floats with 2 bytes per value and a relative error of at most 2^-11 (about 4.9e-4). This only
+    // holds inside the normal range of half floats, 2^-14 (about 6.1e-5) <= |y| <= 65504, other values (apart from 0, inf and NaN) would
+    // overflow or lose precision and are stored lossless as doubles instead (10 bytes)
+    Float16
+};
+
+
+
+
+// helpers to write and read single bits, used by the codecs of the CompressedTrajectory
+namespace BitStream{
+
+    class Writer {
+        public:
+            Writer(std::vector<std::uint8_t> &bytes) : bytes(bytes), bitCount(0){
+            }
+
+            /**
+             * Appends the lowest bits of value, most significant bit first
+             */
+            void write(std::uint64_t value, unsigned int bits){
+                while(bits > 0){
+                    unsigned int used = bitCount % 8;
+                    if(used == 0){
+                        bytes.push_back(0);
+                    }
+                    unsigned int space = 8 - used;
+                    unsigned int n = std::min(space, bits);
+                    std::uint8_t chunk = (value >> (bits - n)) & ((1u << n) - 1);
+                    bytes.back() |= chunk << (space - n);
+                    bits -= n;
+                    bitCount += n;
+                }
+            }
+
+        private:
+            std::vector<std::uint8_t> &bytes;
+            std::size_t bitCount;
+    };
+
+    class Reader {
+        public:
+            Reader(const std::vector<std::uint8_t> &bytes) : bytes(bytes), position(0){
+            }
+
+            std::uint64_t read(unsigned int bits){
+                std::uint64_t value = 0;
+                while(bits > 0){
+                    unsigned int space = 8 - position % 8;
+                    unsigned int n = std::min(space, bits);
+                    std::uint8_t chunk = (bytes[position / 8] >> (space - n)) & ((1u << n) - 1);
+                    value = (value << n) | chunk;
+                    bits -= n;
+                    position += n;
+                }
+                return value;
+            }
+
+        private:
+            const std::vector<std::uint8_t> &bytes;
+            std::size_t position;
+    };
+}
+
+
+
+
+/**
+ *
+ * An output which compresses the states while the integration runs. The states are split into blocks of blockSize consecutive
+ * states, every block is compressed on its own. Accessing a state only decompresses its block, the last decompressed block is cached.
+ *
+ * All codecs except Float16 compress the difference of every value to its linear extrapolation from the two previous states, hence they
+ * work best for smooth trajectories with small steps. The lossy codecs trade accuracy for compression:
+ * Quantized guarantees an absolute error bound, Float16 a relative one and needs 2 instead of 8 bytes per value (inside its range).
+ *
+ */
+class CompressedTrajectory {
+
+    public:
+        /**
+         * Constructor for the CompressedTrajectory
+         *
+         * @param codec the codec used for the states
+         * @param tolerance the maximal absolute error of a value, only used by the Quantized codec
+         * @param blockSize the number of states compressed together, larger blocks compress better but make random access slower
+         *
+         * @exception if the Quantized codec has no positive tolerance or blockSize is 0 an error will be thrown
+         */
+        CompressedTrajectory(Codec codec = Codec::Xor, double tolerance = 0.0, unsigned int blockSize = 256) :
+            codec(codec),tolerance(tolerance),blockSize(blockSize),dimension(0),count(0),cachedBlock(-1){
+            if(codec == Codec::Quantized && !(tolerance > 0)){
+                throw "The Quantized codec needs a positive tolerance";
+            }
+            if(blockSize == 0){
+                throw "The block size must be positive";
+            }
+        }
+
+        void initialize(unsigned int dimension, unsigned int){
+            this->dimension = dimension;
+            this->count = 0;
+            blocks.clear();
+            cachedBlock = -1;
+        }
+
+        template<typename State>
+        void push(double t, const State &y){
+
+            // the first state of a block is compressed relative to zero
+            if(count % blockSize == 0){
+                blocks.emplace_back();
+                writer.reset(new BitStream::Writer(blocks.back()));
+                encoder = Channels(dimension + 1);
+            }
+
+            encodeTime(*writer, encoder, t);
+            for(unsigned int i = 0; i < dimension; i++){
+                encodeValue(*writer, encoder, i + 1, y.data()[i]);
+            }
+            encoder.seen++;
+            count++;
+
+            if(count % blockSize == 0){
+                blocks.back().shrink_to_fit();
+            }
+        }
+
+        void finalize(){
+            if(!blocks.empty()){
+                blocks.back().shrink_to_fit();
+            }
+        }
+
+        /**
+         * @return the number of states stored in the trajectory
+         */
+        std::size_t size() const {
+            return count;
+        }
+
+        /**
+         * @return the number of components of a single state
+         */
+        unsigned int dimensions() const {
+            return dimension;
+        }
+
+        /**
+         * @return the number of bytes used by the compressed states and times
+         */
+        std::size_t compressedBytes() const {
+            std::size_t result = 0;
+            for(const std::vector<std::uint8_t> &block : blocks){
+                result += block.size();
+            }
+            return result;
+        }
+
+        /**
+         * @return the i-th state, its block is decompressed if it is not the cached one
+         */
+        Eigen::VectorXd operator[](std::size_t i) {
+            decompress(i / blockSize);
+            return cachedStates.col(i % blockSize);
+        }
+
+        /**
+         * @return the time of the i-th state, its block is decompressed if it is not the cached one
+         */
+        double time(std::size_t i) {
+            decompress(i / blockSize);
+            return cachedTimes(i % blockSize);
+        }
+
+        /**
+         * Decompresses a whole block of states
+         *
+         * @param block the index of the block, state i lies in block i / blockSize
+         * @param states will hold the states of the block, one per column
+         * @param times will hold the times of the states of the block
+         */
+        void decompressBlock(std::size_t block, Eigen::MatrixXd &states, Eigen::VectorXd &times) const {
+
+            std::size_t blockCount = std::min<std::size_t>(blockSize, count - block*blockSize);
+            states.resize(dimension, blockCount);
+            times.resize(blockCount);
+
+            BitStream::Reader reader(blocks[block]);
+            Channels decoder(dimension + 1);
+            for(std::size_t k = 0; k < blockCount; k++){
+                times(k) = decodeTime(reader, decoder);
+                for(unsigned int i = 0; i < dimension; i++){
+                    states(i, k) = decodeValue(reader, decoder, i + 1);
+                }
+                decoder.seen++;
+            }
+        }
+
+        /**
+         * Writes the compressed trajectory to a file
+         *
+         * @exception if the file can not be written an error will be thrown
+         */
+        void save(const std::string &filename) const {
+            std::ofstream file(filename, std::ios::binary);
+            std::uint64_t header[5] = {static_cast<std::uint64_t>(codec), blockSize, dimension, count, blocks.size()};
+            file.write(reinterpret_cast<const char*>(header), sizeof(header));
+            file.write(reinterpret_cast<const char*>(&tolerance), sizeof(double));
+            for(const std::vector<std::uint8_t> &block : blocks){
+                std::uint64_t bytes = block.size();
+                file.write(reinterpret_cast<const char*>(&bytes), sizeof(bytes));
+                file.write(reinterpret_cast<const char*>(block.data()), bytes);
+            }
+            if(!file){
+                throw "Could not write file";
+            }
+        }
+
+        /**
+         * Reads a compressed trajectory written by save
+         *
+         * @exception if the file can not be read an error will be thrown
+         */
+        static CompressedTrajectory load(const std::string &filename){
+            std::ifstream file(filename, std::ios::binary);
+            std::uint64_t header[5];
+            double tolerance;
+            file.read(reinterpret_cast<char*>(header), sizeof(header));
+            file.read(reinterpret_cast<char*>(&tolerance), sizeof(double));
+            if(!file){
+                throw "Could not read file";
+            }
+
+            CompressedTrajectory result(static_cast<Codec>(header[0]), tolerance, header[1]);
+            result.dimension = header[2];
+            result.count = header[3];
+            result.blocks.resize(header[4]);
+            for(std::vector<std::uint8_t> &block : result.blocks){
+                std::uint64_t bytes;
+                file.read(reinterpret_cast<char*>(&bytes), sizeof(bytes));
+                block.resize(bytes);
+                file.read(reinterpret_cast<char*>(block.data()), bytes);
+            }
+            if(!file){
+                throw "Could not read file";
+            }
+            return result;
+        }
+
+    private:
+        // what the codecs remember about the previous values of every component (the time being component 0)
+        struct Channels {
+            Channels(unsigned int size = 0) : seen(0), previous(size, 0), older(size, 0), leading(size, 0), trailing(size, 0){
+            }
+            std::size_t seen;
+            std::vector<std::uint64_t> previous;
+            std::vector<std::uint64_t> older;
+            std::vector<unsigned int> leading;
+            std::vector<unsigned int> trailing;
+        };
+
+        // the normal range of half floats, and the bit pattern (a NaN) which marks a value stored as double by the Float16 codec
+        static constexpr double halfMax = 65504;
+        static constexpr double halfMin = 6.103515625e-05;
+        static constexpr std::uint16_t halfEscape = 0xffff;
+
+        /**
+         * Every codec (except Float16) compresses the difference between a value and its prediction, the linear extrapolation of the
+         * two previous values of the same component. For smooth trajectories the prediction is very close to the value. The
+         * prediction wraps around (unsigned arithmetic), the differences to it are interpreted as signed values.
+         */
+        static std::uint64_t predict(const Channels &channels, unsigned int i){
+            std::uint64_t previous = channels.previous[i], older = channels.older[i];
+            return channels.seen == 0 ? 0 : channels.seen == 1 ? previous : 2*previous - older;
+        }
+
+        static double predictDouble(const Channels &channels, unsigned int i){
+            double previous, older;
+            std::memcpy(&previous, &channels.previous[i], sizeof(double));
+            std::memcpy(&older, &channels.older[i], sizeof(double));
+            return channels.seen == 0 ? 0.0 : channels.seen == 1 ? previous : 2*previous - older;
+        }
+
+        static void remember(Channels &channels, unsigned int i, std::uint64_t value){
+            channels.older[i] = channels.previous[i];
+            channels.previous[i] = value;
+        }
+
+        // zig-zag and variable length encoding, small numbers only need a single byte
+        static void writeVarint(BitStream::Writer &out, std::int64_t value){
+            std::uint64_t zigzag = (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+            while(zigzag >= 0x80){
+                out.write((zigzag & 0x7f) | 0x80, 8);
+                zigzag >>= 7;
+            }
+            out.write(zigzag, 8);
+        }
+
+        static std::int64_t readVarint(BitStream::Reader &in){
+            std::uint64_t zigzag = 0;
+            std::uint64_t byte;
+            unsigned int shift = 0;
+            do {
+                byte = in.read(8);
+                zigzag |= (byte & 0x7f) << shift;
+                shift += 7;
+            } while(byte & 0x80);
+            return static_cast<std::int64_t>(zigzag >> 1) ^ -static_cast<std::int64_t>(zigzag & 1);
+        }
+
+        /**
+         * Times are predicted on their bit patterns, for equidistant steps the difference to the prediction is (almost always) tiny
+         */
+        static void encodeTime(BitStream::Writer &out, Channels &channels, double t){
+            std::uint64_t bits;
+            std::memcpy(&bits, &t, sizeof(double));
+            writeVarint(out, static_cast<std::int64_t>(bits - predict(channels, 0)));
+            remember(channels, 0, bits);
+        }
+
+        static double decodeTime(BitStream::Reader &in, Channels &channels){
+            std::uint64_t bits = predict(channels, 0) + static_cast<std::uint64_t>(readVarint(in));
+            remember(channels, 0, bits);
+            double t;
+            std::memcpy(&t, &bits, sizeof(double));
+            return t;
+        }
+
+        void encodeValue(BitStream::Writer &out, Channels &channels, unsigned int i, double value){
+            switch(codec){
+                case Codec::Xor: {
+                    std::uint64_t bits;
+                    std::memcpy(&bits, &value, sizeof(double));
+                    double prediction = predictDouble(channels, i);
+                    std::uint64_t predictionBits;
+                    std::memcpy(&predictionBits, &prediction, sizeof(double));
+                    encodeXor(out, channels, i, bits ^ predictionBits);
+                    remember(channels, i, bits);
+                    break;
+                }
+
+                case Codec::Quantized: {
+                    double scaled = std::round(value / (2*tolerance));
+                    if(!(std::abs(scaled) < 1e18)){
+                        throw "Value can not be quantized";
+                    }
+                    std::int64_t quantized = static_cast<std::int64_t>(scaled);
+                    writeVarint(out, static_cast<std::int64_t>(static_cast<std::uint64_t>(quantized) - predict(channels, i)));
+                    remember(channels, i, quantized);
+                    break;
+                }
+
+                case Codec::Float16: {
+                    const double magnitude = std::abs(value);
+                    std::uint16_t half = Eigen::half(static_cast<float>(value)).x;
+                    // values outside of the normal range of half floats are escaped and written as doubles
+                    if((magnitude > halfMax && !std::isinf(value)) || (magnitude > 0 && magnitude < halfMin) || half == halfEscape){
+                        std::uint64_t bits;
+                        std::memcpy(&bits, &value, sizeof(double));
+                        out.write(halfEscape, 16);
+                        out.write(bits, 64);
+                    }else{
+                        out.write(half, 16);
+                    }
+                    break;
+                }
+            }
+        }
+
+        double decodeValue(BitStream::Reader &in, Channels &channels, unsigned int i) const {
+            switch(codec){
+                case Codec::Xor: {
+                    double prediction = predictDouble(channels, i);
+                    std::uint64_t bits;
+                    std::memcpy(&bits, &prediction, sizeof(double));
+                    bits ^= decodeXor(in, channels, i);
+                    remember(channels, i, bits);
+                    double value;
+                    std::memcpy(&value, &bits, sizeof(double));
+                    return value;
+                }
+
+                case Codec::Quantized: {
+                    std::int64_t quantized = static_cast<std::int64_t>(predict(channels, i) + static_cast<std::uint64_t>(readVarint(in)));
+                    remember(channels, i, quantized);
+                    return quantized*2*tolerance;
+                }
+
+                case Codec::Float16: {
+                    Eigen::half value;
+                    value.x = in.read(16);
+                    if(value.x == halfEscape){
+                        std::uint64_t bits = in.read(64);
+                        double raw;
+                        std::memcpy(&raw, &bits, sizeof(double));
+                        return raw;
+                    }
+                    return static_cast<float>(value);
+                }
+            }
+            return 0;
+        }
+
+        /**
+         * Stores the XOR of a value and its prediction as in the Gorilla time series database, only the window of meaningful bits
+         * is written. See http://www.vldb.org/pvldb/vol8/p1816-teller.pdf
+         */
+        static void encodeXor(BitStream::Writer &out, Channels &channels, unsigned int i, std::uint64_t difference){
+
+            if(difference == 0){
+                out.write(0, 1);
+                return;
+            }
+            out.write(1, 1);
+
+            unsigned int leading = __builtin_clzll(difference);
+            unsigned int trailing = __builtin_ctzll(difference);
+
+            // reuse the window of meaningful bits of the previous value if the new bits fit in
+            if(channels.leading[i] + channels.trailing[i] > 0 && leading >= channels.leading[i] && trailing >= channels.trailing[i]){
+                out.write(0, 1);
+                out.write(difference >> channels.trailing[i], 64 - channels.leading[i] - channels.trailing[i]);
+            } else {
+                unsigned int length = 64 - leading - trailing;
+                out.write(1, 1);
+                out.write(leading, 6);
+                out.write(length - 1, 6);
+                out.write(difference >> trailing, length);
+                channels.leading[i] = leading;
+                channels.trailing[i] = trailing;
+            }
+        }
+
+        static std::uint64_t decodeXor(BitStream::Reader &in, Channels &channels, unsigned int i){
+
+            if(in.read(1) == 0){
+                return 0;
+            }
+            if(in.read(1) == 0){
+                return in.read(64 - channels.leading[i] - channels.trailing[i]) << channels.trailing[i];
+            }
+            unsigned int leading = in.read(6);
+            unsigned int length = in.read(6) + 1;
+            channels.leading[i] = leading;
+            channels.trailing[i] = 64 - leading - length;
+            return in.read(length) << channels.trailing[i];
+        }
+
+        void decompress(std::size_t block){
+            if(cachedBlock != static_cast<long>(block)){
+                decompressBlock(block, cachedStates, cachedTimes);
+                cachedBlock = block;
+            }
+        }
+
+        Codec codec;
+        double tolerance;
+        unsigned int blockSize;
+        unsigned int dimension;
+        std::size_t count;
+        std::vector<std::vector<std::uint8_t>> blocks;
+
+        // state of the encoder of the block currently being written
+        std::unique_ptr<BitStream::Writer> writer;
+        Channels encoder;
+
+        long cachedBlock;
+        Eigen::MatrixXd cachedStates;
+        Eigen::VectorXd cachedTimes;
+};
+
+
+
+
+#endif
@@ -0,0 +1,648 @@
+#ifndef RKEXPONENTIAL
+
+#define RKEXPONENTIAL
+
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include <unsupported/Eigen/MatrixFunctions>
+#include <array>
+#include <cmath>
+#include <vector>
+
+#include "rk_statistics.hpp"
+
+
+
+
+/**
+ *
+ * The phi functions of exponential integrators, phi_0(z) = e^z and phi_(k+1)(z) = (phi_k(z) - 1/k!) / z, evaluated with a
+ * single matrix exponential of an augmented matrix (Sidje, Expokit, 1998): the exponential of
+ *
+ *      | A  B  0 |
+ *      | 0  0  I |
+ *      | 0  0  0 |
+ *
+ * contains phi_1(A) B, phi_2(A) B, ... in its first block row.
+ *
+ */
+namespace PhiFunctions{
+
+    // the highest phi function used by the built-in methods
+    const unsigned int maxIndex = 3;
+
+    /**
+     * @return phi_0(A) to phi_p(A)
+     */
+    inline std::vector<Eigen::MatrixXd> dense(const Eigen::MatrixXd &A, unsigned int p){
+        const unsigned int n = A.rows();
+        Eigen::MatrixXd augmented = Eigen::MatrixXd::Zero((p + 1)*n, (p + 1)*n);
+        augmented.topLeftCorner(n, n) = A;
+        for(unsigned int k = 1; k <= p; k++){
+            augmented.block((k - 1)*n, k*n, n, n).setIdentity();
+        }
+        Eigen::MatrixXd exponential = augmented.exp();
+
+        std::vector<Eigen::MatrixXd> phi(p + 1);
+        for(unsigned int k = 0; k <= p; k++){
+            phi[k] = exponential.block(0, k*n, n, n);
+        }
+        return phi;
+    }
+
+    /**
+     * @return the columns phi_0(A) e_1 to phi_p(A) e_1 as one matrix, for the small matrices of a Krylov method
+     */
+    inline Eigen::MatrixXd firstColumns(const Eigen::MatrixXd &A, unsigned int p){
+        const unsigned int n = A.rows();
+        Eigen::MatrixXd augmented = Eigen::MatrixXd::Zero(n + p, n + p);
+        augmented.topLeftCorner(n, n) = A;
+        if(p > 0){
+            augmented(0, n) = 1;
+        }
+        for(unsigned int k = 1; k < p; k++){
+            augmented(n + k - 1, n + k) = 1;
+        }
+        Eigen::MatrixXd exponential = augmented.exp();
+
+        Eigen::MatrixXd columns(n, p + 1);
+        columns.col(0) = exponential.block(0, 0, n, 1);
+        for(unsigned int k = 1; k <= p; k++){
+            columns.col(k) = exponential.block(0, n + k - 1, n, 1);
+        }
+        return columns;
+    }
+
+}
+
+
+
+
+/**
+ *
+ * Products with phi functions of a small dense operator M: the matrices phi_k(c h M) are computed once per step size and
+ * node c and then only multiplied with vectors. For a fixed step size and operator, as in ExponentialRungeKuttaIntegrator,
+ * they are computed once per solve.
+ *
+ */
+class DensePhi {
+
+    public:
+        using Operator = Eigen::MatrixXd;
+
+        void setOperator(const Operator &M){
+            op = M;
+            cache.clear();
+        }
+
+        void setStepSize(double stepSize){
+            if(stepSize != h){
+                h = stepSize;
+                cache.clear();
+            }
+        }
+
+        /**
+         * Computes result = phi_k(c h M) v
+         */
+        template<typename Vector, typename Result>
+        void apply(unsigned int k, double c, const Vector &v, Result &result){
+            result.noalias() = matrices(c)[k] * v;
+        }
+
+    private:
+        const std::vector<Eigen::MatrixXd> &matrices(double c){
+            for(const Entry &entry : cache){
+                if(entry.c == c){
+                    return entry.phi;
+                }
+            }
+            cache.push_back({c, PhiFunctions::dense(c*h*op, PhiFunctions::maxIndex)});
+            return cache.back().phi;
+        }
+
+        struct Entry {
+            double c;
+            std::vector<Eigen::MatrixXd> phi;
+        };
+
+        Operator op;
+        double h = 0;
+        std::vector<Entry> cache;
+};
+
+
+
+
+/**
+ *
+ * Products with phi functions of a large sparse operator M, computed in a Krylov subspace: with the Arnoldi decomposition
+ * M V_m = V_m H_m + h_(m+1,m) v_(m+1) e_m^T of the subspace spanned by v, M v, M^2 v, ... the product is approximated by
+ * |v| V_m phi_k(c h H_m) e_1. The subspace is enlarged until the estimate |v| c h h_(m+1,m) |e_m^T phi_(k+1)(c h H_m) e_1|
+ * of the error is below the tolerance (relative to |v|) or maxDimension is reached. Only products of M with vectors are needed.
+ *
+ */
+class KrylovPhi {
+
+    public:
+        using Operator = Eigen::SparseMatrix<double>;
+
+        /**
+         * @param maxDimension the largest dimension of the Krylov subspace
+         * @param tolerance the tolerance of a product relative to the norm of the vector
+         */
+        KrylovPhi(unsigned int maxDimension = 40, double tolerance = 1e-12) : maxDimension(maxDimension), tolerance(tolerance){
+        }
+
+        void setOperator(const Operator &M){
+            op = M;
+            basis.resize(M.rows(), maxDimension + 1);
+            hessenberg.resize(maxDimension + 1, maxDimension);
+            w.resize(M.rows());
+        }
+
+        void setStepSize(double stepSize){
+            h = stepSize;
+        }
+
+        /**
+         * Computes result = phi_k(c h M) v
+         */
+        template<typename Vector, typename Result>
+        void apply(unsigned int k, double c, const Vector &v, Result &result){
+            const double beta = v.norm();
+            if(beta == 0){
+                result.setZero(v.size());
+                return;
+            }
+            const double tau = c*h;
+
+            basis.col(0) = v / beta;
+            hessenberg.setZero();
+            Eigen::MatrixXd columns;
+            unsigned int dimension = 0;
+            for(unsigned int j = 0; j < maxDimension; j++){
+                // Arnoldi with modified Gram-Schmidt
+                w.noalias() = op * basis.col(j);
+                for(unsigned int i = 0; i <= j; i++){
+                    hessenberg(i,j) = basis.col(i).dot(w);
+                    w -= hessenberg(i,j) * basis.col(i);
+                }
+                hessenberg(j + 1, j) = w.norm();
+                dimension = j + 1;
+
+                columns = PhiFunctions::firstColumns(tau*hessenberg.topLeftCorner(dimension, dimension), k + 1);
+                double error = tau*hessenberg(j + 1, j)*std::abs(columns(dimension - 1, k + 1));
+                // a happy breakdown: the subspace is invariant and the product exact
+                if(hessenberg(j + 1, j) <= 1e-14*hessenberg.topLeftCorner(dimension, dimension).norm() || error <= tolerance){
+                    break;
+                }
+                basis.col(j + 1) = w / hessenberg(j + 1, j);
+            }
+
+            result.noalias() = beta * basis.leftCols(dimension) * columns.col(k);
+        }
+
+    private:
+        unsigned int maxDimension;
+        double tolerance;
+        Operator op;
+        double h = 0;
+
+        // workspace of the Arnoldi iteration
+        Eigen::MatrixXd basis;
+        Eigen::MatrixXd hessenberg;
+        Eigen::VectorXd w;
+};
+
+
+
+
+// the exponential Runge Kutta methods of ExponentialRungeKuttaIntegrator
+enum class ExponentialMethod {
+    // Cox and Matthews' exponential time differencing method of order 4
+    ETDRK4,
+    // the classical 4th order method applied to the system transformed with e^(-tL) (Lawson, 1967)
+    LawsonRK4
+};
+
+
+
+
+/**
+ *
+ * Implementation of exponential Runge Kutta methods for semilinear problems y' = L y + N(y) with a stiff linear part L. The
+ * linear part is integrated exactly with phi functions of h L, hence the step size is only limited by N.
+ *
+ * The Phi policy computes the products with the phi functions: DensePhi for small L (the phi functions are computed once per
+ * solve), KrylovPhi for large sparse L.
+ *
+ * The Instrumentation policy decides whether statistics are collected, see ExplicitRungeKuttaIntegrator. The products with
+ * phi functions are measured as Phase::LinearAlgebra.
+ *
+ */
+template <class Step = Eigen::VectorXd, class Phi = DensePhi, class Instrumentation = NoInstrumentation> class ExponentialRungeKuttaIntegrator {
+
+    public:
+        /**
+         * Constructor for the ExponentialRungeKuttaIntegrator
+         *
+         * @param method the exponential Runge Kutta method
+         * @param L the linear part of the problem, a dense matrix for DensePhi and a sparse one for KrylovPhi
+         * @param phi the policy computing the products with the phi functions, e.g. a KrylovPhi with a different tolerance
+         */
+        ExponentialRungeKuttaIntegrator(ExponentialMethod method, const typename Phi::Operator &L, Phi phi = Phi()) : method(method), L(L), phi(phi){
+            this->phi.setOperator(L);
+        }
+
+        /**
+         * The solve methods applies the exponential Runge Kutta method
+         *
+         * @param N the nonlinear part of the problem
+         * @param time the time interval we want to integrate over
+         * @param y0 the initial state of the system
+         * @param steps the number of integration steps we would like to make
+         *
+         * @return a std::vector of states, one for every integration step performed. The first step will be the supplied y0.
+         */
+        template<typename Function>
+        std::vector<Step> solve(Function &&N, double time, const Step &y0, unsigned int steps){
+
+            std::vector<Step> stepsVector;
+            stepsVector.reserve(steps + 1);
+
+            integrate(N, time, y0, steps, [&stepsVector] (double, const Step &y) {
+                stepsVector.push_back(y);
+            });
+
+            return stepsVector;
+
+        }
+
+        /**
+         * The solve methods applies the exponential Runge Kutta method and hands every state to an output instead of returning them
+         *
+         * @param output receives all steps+1 states, starting with y0, see rk_trajectory.hpp for the interface of an output
+         */
+        template<typename Function, typename Output>
+        void solve(Function &&N, double time, const Step &y0, unsigned int steps, Output &output){
+
+            output.initialize(y0.size(), steps + 1);
+            integrate(N, time, y0, steps, [&output] (double t, const Step &y) {
+                output.push(t, y);
+            });
+            output.finalize();
+
+        }
+
+        /**
+         * @return the statistics of the last solve (all zero unless the integrator uses StatisticsInstrumentation)
+         */
+        SolverStatistics statistics() const {
+            return instrumentation.statistics();
+        }
+
+        /**
+         * @return the instrumentation policy, for the data of a policy which goes beyond SolverStatistics
+         */
+        const Instrumentation &instrumentationPolicy() const {
+            return instrumentation;
+        }
+
+    private:
+        template<typename Function, typename Push>
+        void integrate(Function &&N, double time, const Step &y0, unsigned int steps, Push &&push){
+
+            instrumentation.reset();
+
+            const double h = time / steps;
+            phi.setStepSize(h);
+            nonlinear.assign(4, y0);
+            stages.assign(3, y0);
+            product = y0;
+
+            Step y = y0;
+            push(0.0, y);
+
+            for(unsigned int i = 0; i < steps; i++){
+                {
+                    auto timer = instrumentation.time(Phase::Step);
+                    if(method == ExponentialMethod::ETDRK4){
+                        etdrk4(N, y, h);
+                    }else{
+                        lawsonRK4(N, y, h);
+                    }
+                    instrumentation.count(Event::AcceptedStep);
+                }
+                auto timer = instrumentation.time(Phase::Output);
+                push((i + 1)*h, y);
+            }
+
+        }
+
+        template<typename Function>
+        void evaluate(Function &&N, const Step &argument, Step &result){
+            auto timer = instrumentation.time(Phase::Rhs);
+            result = N(argument);
+            instrumentation.count(Event::RhsEvaluation);
+        }
+
+        // result = phi_k(c h L) v
+        void apply(unsigned int k, double c, const Step &v, Step &result){
+            auto timer = instrumentation.time(Phase::LinearAlgebra);
+            phi.apply(k, c, v, result);
+        }
+
+        // accumulates y += weight * phi_k(c h L) v
+        void accumulate(Step &y, double weight, unsigned int k, double c, const Step &v){
+            apply(k, c, v, product);
+            auto timer = instrumentation.time(Phase::Stages);
+            y += weight * product;
+        }
+
+        /**
+         * One step of ETDRK4 (Cox, Matthews, 2002) in place
+         */
+        template<typename Function>
+        void etdrk4(Function &&N, Step &y, const double h){
+
+            evaluate(N, y, nonlinear[0]);
+
+            // a = e^(hL/2) y + h/2 phi_1(hL/2) N(y)
+            apply(0, 0.5, y, stages[2]);
+            stages[0] = stages[2];
+            accumulate(stages[0], h/2, 1, 0.5, nonlinear[0]);
+            evaluate(N, stages[0], nonlinear[1]);
+
+            // b = e^(hL/2) y + h/2 phi_1(hL/2) N(a)
+            stages[1] = stages[2];
+            accumulate(stages[1], h/2, 1, 0.5, nonlinear[1]);
+            evaluate(N, stages[1], nonlinear[2]);
+
+            // c = e^(hL/2) a + h/2 phi_1(hL/2) (2 N(b) - N(y))
+            apply(0, 0.5, stages[0], stages[2]);
+            product = 2*nonlinear[2] - nonlinear[0];
+            stages[0] = product;
+            accumulate(stages[2], h/2, 1, 0.5, stages[0]);
+            evaluate(N, stages[2], nonlinear[3]);
+
+            // y1 = e^(hL) y + h (phi_1 - 3 phi_2 + 4 phi_3) N(y) + h (2 phi_2 - 4 phi_3) (N(a) + N(b)) + h (4 phi_3 - phi_2) N(c)
+            apply(0, 1, y, stages[1]);
+            y = stages[1];
+            {
+                auto timer = instrumentation.time(Phase::Stages);
+                stages[0] = nonlinear[1] + nonlinear[2];
+            }
+            accumulate(y, h, 1, 1, nonlinear[0]);
+            {
+                auto timer = instrumentation.time(Phase::Stages);
+                stages[1] = -3*nonlinear[0] + 2*stages[0] - nonlinear[3];
+                stages[2] = 4*nonlinear[0] - 4*stages[0] + 4*nonlinear[3];
+            }
+            accumulate(y, h, 2, 1, stages[1]);
+            accumulate(y, h, 3, 1, stages[2]);
+
+        }
+
+        /**
+         * One step of the Lawson method based on the classical 4th order method in place
+         */
+        template<typename Function>
+        void lawsonRK4(Function &&N, Step &y, const double h){
+
+            evaluate(N, y, nonlinear[0]);
+
+            // y2 = e^(hL/2) (y + h/2 k1)
+            {
+                auto timer = instrumentation.time(Phase::Stages);
+                stages[0] = y + h/2*nonlinear[0];
+            }
+            apply(0, 0.5, stages[0], stages[1]);
+            evaluate(N, stages[1], nonlinear[1]);
+
+            // y3 = e^(hL/2) y + h/2 k2
+            apply(0, 0.5, y, stages[2]);
+            {
+                auto timer = instrumentation.time(Phase::Stages);
+                stages[0] = stages[2] + h/2*nonlinear[1];
+            }
+            evaluate(N, stages[0], nonlinear[2]);
+
+            // y4 = e^(hL) y + h e^(hL/2) k3
+            apply(0, 1, y, stages[1]);
+            stages[0] = stages[1];
+            accumulate(stages[0], h, 0, 0.5, nonlinear[2]);
+            evaluate(N, stages[0], nonlinear[3]);
+
+            // y1 = e^(hL) (y + h/6 k1) + h/3 e^(hL/2) (k2 + k3) + h/6 k4
+            {
+                auto timer = instrumentation.time(Phase::Stages);
+                stages[0] = y + h/6*nonlinear[0];
+                stages[2] = nonlinear[1] + nonlinear[2];
+            }
+            apply(0, 1, stages[0], y);
+            accumulate(y, h/3, 0, 0.5, stages[2]);
+            {
+                auto timer = instrumentation.time(Phase::Stages);
+                y += h/6*nonlinear[3];
+            }
+
+        }
+
+
+        ExponentialMethod method;
+        const typename Phi::Operator L;
+        Phi phi;
+        Instrumentation instrumentation;
+
+        // workspace: the evaluations of N, the stages and a product with a phi function
+        std::vector<Step> nonlinear;
+        std::vector<Step> stages;
+        Step product;
+};
+
+
+
+
+// the exponential Rosenbrock methods of ExponentialRosenbrockIntegrator
+enum class ExponentialRosenbrockMethod {
+    // the exponential Rosenbrock-Euler method of order 2
+    RosenbrockEuler,
+    // exprb32 of order 3 (Hochbruck, Ostermann, Schweitzer, 2009)
+    EXPRB32
+};
+
+
+
+
+/**
+ *
+ * Implementation of exponential Rosenbrock methods for stiff problems y' = F(y). Every step linearizes F at the current state,
+ * J_n = F'(y_n), and integrates the linearization exactly with phi functions of h J_n, hence no nonlinear equations have to be
+ * solved. Unlike ExponentialRungeKuttaIntegrator no splitting into a linear and a nonlinear part is needed.
+ *
+ * Since the Jacobian changes in every step DensePhi computes the phi functions in every step, for large problems KrylovPhi
+ * with a sparse Jacobian is much cheaper.
+ *
+ * The Instrumentation policy decides whether statistics are collected, see ExplicitRungeKuttaIntegrator.
+ *
+ */
+template <class Step = Eigen::VectorXd, class Phi = DensePhi, class Instrumentation = NoInstrumentation> class ExponentialRosenbrockIntegrator {
+
+    public:
+        /**
+         * Constructor for the ExponentialRosenbrockIntegrator
+         *
+         * @param method the exponential Rosenbrock method
+         * @param phi the policy computing the products with the phi functions
+         */
+        ExponentialRosenbrockIntegrator(ExponentialRosenbrockMethod method, Phi phi = Phi()) : method(method), phi(phi){
+        }
+
+        /**
+         * The solve methods applies the exponential Rosenbrock method
+         *
+         * @param F the function we are integrating over
+         * @param J the Jacobian of F, a dense matrix for DensePhi and a sparse one for KrylovPhi
+         * @param time the time interval we want to integrate over
+         * @param y0 the initial state of the system
+         * @param steps the number of integration steps we would like to make
+         *
+         * @return a std::vector of states, one for every integration step performed. The first step will be the supplied y0.
+         */
+        template<typename Function, typename Jacobian>
+        std::vector<Step> solve(Function &&F, Jacobian &&J, double time, const Step &y0, unsigned int steps){
+
+            std::vector<Step> stepsVector;
+            stepsVector.reserve(steps + 1);
+
+            integrate(F, J, time, y0, steps, [&stepsVector] (double, const Step &y) {
+                stepsVector.push_back(y);
+            });
+
+            return stepsVector;
+
+        }
+
+        /**
+         * The solve methods applies the exponential Rosenbrock method and hands every state to an output instead of returning them
+         *
+         * @param output receives all steps+1 states, starting with y0, see rk_trajectory.hpp for the interface of an output
+         */
+        template<typename Function, typename Jacobian, typename Output>
+        void solve(Function &&F, Jacobian &&J, double time, const Step &y0, unsigned int steps, Output &output){
+
+            output.initialize(y0.size(), steps + 1);
+            integrate(F, J, time, y0, steps, [&output] (double t, const Step &y) {
+                output.push(t, y);
+            });
+            output.finalize();
+
+        }
+
+        /**
+         * @return the statistics of the last solve (all zero unless the integrator uses StatisticsInstrumentation)
+         */
+        SolverStatistics statistics() const {
+            return instrumentation.statistics();
+        }
+
+        /**
+         * @return the instrumentation policy, for the data of a policy which goes beyond SolverStatistics
+         */
+        const Instrumentation &instrumentationPolicy() const {
+            return instrumentation;
+        }
+
+    private:
+        template<typename Function, typename Jacobian, typename Push>
+        void integrate(Function &&F, Jacobian &&J, double time, const Step &y0, unsigned int steps, Push &&push){
+
+            instrumentation.reset();
+
+            const double h = time / steps;
+            phi.setStepSize(h);
+            derivative = y0;
+            stage = y0;
+            product = y0;
+            difference = y0;
+
+            Step y = y0;
+            push(0.0, y);
+
+            for(unsigned int i = 0; i < steps; i++){
+                {
+                    auto timer = instrumentation.time(Phase::Step);
+                    iteration(F, J, y, h);
+                    instrumentation.count(Event::AcceptedStep);
+                }
+                auto timer = instrumentation.time(Phase::Output);
+                push((i + 1)*h, y);
+            }
+
+        }
+
+        /**
+         * One step in place
+         */
+        template<typename Function, typename Jacobian>
+        void iteration(Function &&F, Jacobian &&J, Step &y, const double h){
+
+            {
+                auto timer = instrumentation.time(Phase::Rhs);
+                derivative = F(y);
+                jacobian = J(y);
+                instrumentation.count(Event::RhsEvaluation);
+                instrumentation.count(Event::JacobianEvaluation);
+            }
+            {
+                auto timer = instrumentation.time(Phase::LinearAlgebra);
+                phi.setOperator(jacobian);
+                phi.apply(1, 1, derivative, product);
+            }
+
+            // the exponential Rosenbrock-Euler step U = y + h phi_1(h J) F(y)
+            {
+                auto timer = instrumentation.time(Phase::Stages);
+                stage = y + h*product;
+            }
+            if(method == ExponentialRosenbrockMethod::RosenbrockEuler){
+                std::swap(y, stage);
+                return;
+            }
+
+            // exprb32: y1 = U + 2h phi_3(h J) D with the defect D = g(U) - g(y) of the nonlinearity g(u) = F(u) - J u
+            {
+                auto timer = instrumentation.time(Phase::Rhs);
+                difference = F(stage);
+                instrumentation.count(Event::RhsEvaluation);
+            }
+            {
+                auto timer = instrumentation.time(Phase::LinearAlgebra);
+                product = stage - y;
+                difference -= derivative;
+                difference -= jacobian*product;
+                phi.apply(3, 1, difference, product);
+            }
+            auto timer = instrumentation.time(Phase::Stages);
+            y = stage + 2*h*product;
+
+        }
+
+
+        ExponentialRosenbrockMethod method;
+        Phi phi;
+        Instrumentation instrumentation;
+
+        // workspace: F(y), its Jacobian, the Rosenbrock-Euler stage, a product with a phi function and the defect
+        Step derivative;
+        typename Phi::Operator jacobian;
+        Step stage;
+        Step product;
+        Step difference;
+};
+
+
+
+
+#endif
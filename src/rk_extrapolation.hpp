@@ -0,0 +1,430 @@
+#ifndef RKEXTRAPOLATION
+
+#define RKEXTRAPOLATION
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "rk_adaptive.hpp"
+#include "rk_statistics.hpp"
+
+
+
+
+/**
+ *
+ * Implementation of the Gragg-Bulirsch-Stoer extrapolation method with adaptive order and step size (like ODEX of Hairer,
+ * Norsett, Wanner, Sec. II.9). Column j of the extrapolation tableau integrates a step of size H with n_j = 2j steps of the
+ * modified midpoint rule (the explicit midpoint rule of ExplicitRKTableaus with the leapfrog scheme in between), its error
+ * has an expansion in even powers of H/n_j. Extrapolating k columns with the Aitken-Neville scheme gives a method of order 2k,
+ * the difference of the last two extrapolated values estimates the error of the lower one.
+ *
+ * The columns of a step are independent of each other, hence they are computed in parallel. Column j needs 2j - 1 evaluations
+ * of f (f(y0) is shared), the columns are distributed over the threads with the longest processing time first rule, which
+ * balances the load (with enough threads columns j and k + 1 - j end up together). The order is chosen such that the
+ * evaluations on the busiest thread per unit step are minimal, so more threads lead to higher orders.
+ *
+ * f is called from several threads at the same time and must not modify shared state. The threads are started once per
+ * solve and wait for the columns of the next step in between, the workspace of every column is allocated once per solve as
+ * well. The evaluations on the worker threads are counted, but their time is measured as Phase::Stages instead of Phase::Rhs.
+ * Needs to be linked with -pthread.
+ *
+ * The Instrumentation policy decides whether statistics are collected, see ExplicitRungeKuttaIntegrator.
+ *
+ */
+template <class Step, class Instrumentation = NoInstrumentation> class ExtrapolationIntegrator {
+
+    public:
+        /**
+         * Constructor for the ExtrapolationIntegrator
+         *
+         * @param rtol the relative tolerance of a step
+         * @param atol the absolute tolerance of a step
+         * @param threads the number of threads computing the columns, including the calling one (0 for the number of cores)
+         * @param maxColumns the largest number of columns of the extrapolation tableau, between 2 and 16
+         * @param maxStep the largest step size the integrator may use
+         */
+        ExtrapolationIntegrator(double rtol = 1e-6, double atol = 1e-9, unsigned int threads = 0, unsigned int maxColumns = 9, double maxStep = std::numeric_limits<double>::infinity())
+            : rtol(rtol), atol(atol), threads(threads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : threads), maxColumns(maxColumns), maxStep(maxStep){
+            if(maxColumns < 2 || maxColumns > 16){
+                throw "The number of columns of the extrapolation tableau must be between 2 and 16";
+            }
+            balanceLoad();
+        }
+
+        /**
+         * Integrates over [0, time] with adaptive order and step size and hands the state after every accepted step to the output
+         *
+         * @param f the function we are integrating over, called from several threads at the same time
+         * @param time the time interval we want to integrate over
+         * @param y0 the initial state of the system
+         * @param output receives y0 and the state after every accepted step, see rk_trajectory.hpp for the interface of an output
+         *
+         * @exception if the step size becomes too small an error will be thrown, as well as everything f throws
+         */
+        template<typename Function, typename Output>
+        void solve(Function &&f, double time, const Step &y0, Output &output){
+
+            instrumentation.reset();
+            prepare(y0);
+            y = y0;
+
+            output.initialize(y0.size(), 0);
+            output.push(0.0, y0);
+
+            if(time > 0){
+                // the worker threads live as long as the integration, they are stopped even if f throws
+                struct Workers {
+                    ExtrapolationIntegrator &integrator;
+                    std::vector<std::thread> threads;
+                    ~Workers(){
+                        {
+                            std::lock_guard<std::mutex> lock(integrator.mutex);
+                            integrator.stopping = true;
+                        }
+                        integrator.started.notify_all();
+                        for(std::thread &thread : threads){
+                            thread.join();
+                        }
+                    }
+                } workers{*this, {}};
+
+                stopping = false;
+                generation = 0;
+                for(unsigned int worker = 1; worker < threads; worker++){
+                    workers.threads.emplace_back([this, &f, worker] () { work(f, worker); });
+                }
+
+                integrate(f, time, output);
+            }
+
+            output.finalize();
+
+        }
+
+        /**
+         * @return the number of threads computing the columns
+         */
+        unsigned int threadCount() const {
+            return threads;
+        }
+
+        /**
+         * @return the statistics of the last solve (all zero unless the integrator uses StatisticsInstrumentation)
+         */
+        SolverStatistics statistics() const {
+            return instrumentation.statistics();
+        }
+
+        /**
+         * @return the instrumentation policy, for the data of a policy which goes beyond SolverStatistics
+         */
+        const Instrumentation &instrumentationPolicy() const {
+            return instrumentation;
+        }
+
+    private:
+        template<typename Function, typename Output>
+        void integrate(Function &&f, double time, Output &output){
+
+            double t = 0;
+            double h;
+            // the number of columns of the next step, chosen from the tolerance like in ODEX
+            unsigned int columns = std::max(2, std::min(static_cast<int>(maxColumns) - 1, static_cast<int>(-std::log10(rtol + atol)*0.6 + 1.5)));
+            {
+                auto timer = instrumentation.time(Phase::Step);
+                evaluate(f, y, fy);
+                h = StepSizeControl::initialStep([&] (const Step &argument, Step &result) { evaluate(f, argument, result); },
+                                                 y, fy, time, 2*columns - 2, rtol, atol, maxStep, table[0], table[1]);
+            }
+
+            bool rejected = false;
+
+            while(t < time){
+                // the last step ends exactly at time
+                bool last = t + h >= time;
+                if(last){
+                    h = time - t;
+                }
+
+                {
+                    auto timer = instrumentation.time(Phase::Step);
+                    computeColumns(f, h, columns);
+                    extrapolate(h, columns);
+                }
+
+                // the column with the least work per unit step among the last three
+                unsigned int best = columns;
+                for(unsigned int j = std::max(2u, columns - 2); j <= columns; j++){
+                    if(columnWork[j]/stepSizes[j] < columnWork[best]/stepSizes[best]){
+                        best = j;
+                    }
+                }
+
+                if(errors[columns] <= 1){
+                    instrumentation.count(Event::AcceptedStep);
+                    t = last ? time : t + h;
+                    std::swap(y, table[columns - 1]);
+                    {
+                        auto timer = instrumentation.time(Phase::Output);
+                        output.push(t, y);
+                    }
+                    if(t < time){
+                        auto timer = instrumentation.time(Phase::Step);
+                        evaluate(f, y, fy);
+                    }
+
+                    double hNew = stepSizes[best];
+                    // a higher order if the highest one is the most efficient, its step size follows from the work
+                    if(best == columns && columns < maxColumns && !rejected){
+                        hNew = stepSizes[columns]*columnWork[columns + 1]/columnWork[columns];
+                        best = columns + 1;
+                    }
+                    // no increase directly after a rejected step
+                    if(rejected){
+                        hNew = std::min(hNew, h);
+                    }
+                    h = std::min(hNew, maxStep);
+                    columns = best;
+                    rejected = false;
+                }else{
+                    instrumentation.count(Event::RejectedStep);
+                    h = std::min(stepSizes[best], h);
+                    columns = best;
+                    rejected = true;
+                }
+
+                if(t < time && StepSizeControl::tooSmall(h, t)){
+                    throw "Step size too small";
+                }
+            }
+
+        }
+
+        /**
+         * Distributes the columns over the threads for every number of columns: the longest processing time first rule puts
+         * the next column (the one with the most evaluations) on the thread with the least evaluations so far. columnWork[k] is the
+         * number of evaluations of the busiest thread for k columns, plus the shared one of f(y0).
+         */
+        void balanceLoad(){
+            groups.assign(maxColumns + 1, {});
+            columnWork.assign(maxColumns + 1, 0);
+            for(unsigned int k = 1; k <= maxColumns; k++){
+                groups[k].assign(std::min(threads, k), {});
+                std::vector<unsigned int> load(groups[k].size(), 0);
+                for(unsigned int j = k; j >= 1; j--){
+                    unsigned int thread = std::min_element(load.begin(), load.end()) - load.begin();
+                    groups[k][thread].push_back(j);
+                    load[thread] += 2*j - 1;
+                }
+                columnWork[k] = 1.0 + *std::max_element(load.begin(), load.end());
+            }
+        }
+
+        /**
+         * Sizes the workspace for states like y0, this is the only place where the integrator itself allocates memory
+         */
+        void prepare(const Step &y0){
+            fy = y0;
+            midpoints.assign(maxColumns + 1, y0);
+            previous.assign(maxColumns + 1, y0);
+            derivatives.assign(maxColumns + 1, y0);
+            table.assign(maxColumns, y0);
+            current = y0;
+            next = y0;
+            errors.assign(maxColumns + 1, 0);
+            stepSizes.assign(maxColumns + 1, 0);
+            failures.assign(threads, nullptr);
+        }
+
+        template<typename Function>
+        void evaluate(Function &&f, const Step &argument, Step &result){
+            auto timer = instrumentation.time(Phase::Rhs);
+            result = f(argument);
+            instrumentation.count(Event::RhsEvaluation);
+        }
+
+        /**
+         * The modified midpoint rule with 2j steps over h from y in midpoints[j], f(y) = fy is known. Called on the thread of
+         * the column, hence nothing is counted.
+         */
+        template<typename Function>
+        void column(Function &&f, const double h, const unsigned int j){
+            const unsigned int n = 2*j;
+            const double hs = h/n;
+            Step &z = midpoints[j];
+            Step &zPrevious = previous[j];
+            Step &fz = derivatives[j];
+            // one explicit euler step, then leapfrog steps
+            zPrevious = y;
+            z = y + hs*fy;
+            for(unsigned int i = 1; i < n; i++){
+                fz = f(z);
+                zPrevious += (2*hs)*fz;
+                std::swap(zPrevious, z);
+            }
+        }
+
+        /**
+         * Computes the given columns of the extrapolation tableau for a step of size h, those of groups[columns][0] on the
+         * calling thread and the others on the worker threads. Rethrows what f threw on any thread.
+         */
+        template<typename Function>
+        void computeColumns(Function &&f, const double h, const unsigned int columns){
+
+            auto timer = instrumentation.time(Phase::Stages);
+
+            const std::vector<std::vector<unsigned int>> &assignment = groups[columns];
+            if(assignment.size() > 1){
+                std::lock_guard<std::mutex> lock(mutex);
+                stepSize = h;
+                columnCount = columns;
+                pending = threads - 1;
+                generation++;
+            }
+            started.notify_all();
+
+            try{
+                for(unsigned int j : assignment[0]){
+                    column(f, h, j);
+                }
+            }catch(...){
+                failures[0] = std::current_exception();
+            }
+
+            if(assignment.size() > 1){
+                std::unique_lock<std::mutex> lock(mutex);
+                done.wait(lock, [this] () { return pending == 0; });
+            }
+
+            unsigned long evaluations = 0;
+            for(unsigned int j = 1; j <= columns; j++){
+                evaluations += 2*j - 1;
+            }
+            instrumentation.count(Event::RhsEvaluation, evaluations);
+
+            for(std::exception_ptr &failure : failures){
+                if(failure){
+                    std::exception_ptr rethrown = failure;
+                    failure = nullptr;
+                    std::rethrow_exception(rethrown);
+                }
+            }
+        }
+
+        /**
+         * The loop of a worker thread: waits for the next step and computes the columns of its group
+         */
+        template<typename Function>
+        void work(Function &f, const unsigned int worker){
+            unsigned int seen = 0;
+            while(true){
+                double h;
+                unsigned int columns;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    started.wait(lock, [&] () { return stopping || generation != seen; });
+                    if(stopping){
+                        return;
+                    }
+                    seen = generation;
+                    h = stepSize;
+                    columns = columnCount;
+                }
+
+                if(worker < groups[columns].size()){
+                    try{
+                        for(unsigned int j : groups[columns][worker]){
+                            column(f, h, j);
+                        }
+                    }catch(...){
+                        failures[worker] = std::current_exception();
+                    }
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    pending--;
+                }
+                done.notify_one();
+            }
+        }
+
+        /**
+         * Extrapolates the columns with the Aitken-Neville scheme, afterwards table[k - 1] holds the diagonal element of row k,
+         * errors[k] the scaled error of row k - 1 and stepSizes[k] the step size which would give an error of about 0.65 with
+         * k columns
+         */
+        void extrapolate(const double h, const unsigned int columns){
+
+            auto timer = instrumentation.time(Phase::Stages);
+
+            table[0] = midpoints[1];
+            for(unsigned int k = 2; k <= columns; k++){
+                // table[l] holds T_{k-1,l+1}, it is overwritten with T_{k,l+1}
+                current = midpoints[k];
+                for(unsigned int l = 1; l < k; l++){
+                    const double ratio = static_cast<double>(k)/(k - l);
+                    next = current + (current - table[l - 1])/(ratio*ratio - 1);
+                    table[l - 1] = current;
+                    std::swap(current, next);
+                }
+                table[k - 1] = current;
+
+                errors[k] = StepSizeControl::errorNorm(table[k - 1] - table[k - 2], y, table[k - 1], rtol, atol);
+
+                // the step size control of ODEX
+                const double exponent = 1.0/(2*k - 1);
+                const double minimum = std::pow(0.02, exponent);
+                const double factor = std::min(4/minimum, std::max(minimum, std::pow(errors[k]/0.65, exponent)/0.94));
+                stepSizes[k] = h/factor;
+            }
+        }
+
+
+        double rtol;
+        double atol;
+        unsigned int threads;
+        unsigned int maxColumns;
+        double maxStep;
+        Instrumentation instrumentation;
+
+        // groups[k][thread] are the columns of the thread if k columns are computed, columnWork[k] the evaluations on the busiest thread
+        std::vector<std::vector<std::vector<unsigned int>>> groups;
+        std::vector<double> columnWork;
+
+        // the synchronization of the worker threads: a new step increments generation, every worker decrements pending
+        std::mutex mutex;
+        std::condition_variable started;
+        std::condition_variable done;
+        bool stopping = false;
+        unsigned long generation = 0;
+        unsigned int pending = 0;
+        double stepSize = 0;
+        unsigned int columnCount = 0;
+        std::vector<std::exception_ptr> failures;
+
+        // workspace: the result and the last two midpoint values of every column, the extrapolation tableau and the controller
+        Step y;
+        Step fy;
+        std::vector<Step> midpoints;
+        std::vector<Step> previous;
+        std::vector<Step> derivatives;
+        std::vector<Step> table;
+        Step current;
+        Step next;
+        std::vector<double> errors;
+        std::vector<double> stepSizes;
+};
+
+
+
+
+#endif
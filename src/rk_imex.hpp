@@ -0,0 +1,354 @@
+#ifndef RKIMEX
+
+#define RKIMEX
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "rk_adaptive.hpp"
+#include "rk_implementer.hpp"
+#include "rk_statistics.hpp"
+
+
+
+
+/**
+ *
+ * An additive Runge Kutta (IMEX) method for problems y' = fE(y) + fI(y) with a non-stiff part fE and a stiff part fI: an
+ * explicit tableau AE for fE and a diagonally implicit one AI (an ESDIRK, its first stage is explicit) for fI, which share
+ * the weights b and the nodes. The stage values are
+ *
+ *      Y_i = y0 + h sum_(j<i) AE(i,j) fE(Y_j) + h sum_(j<=i) AI(i,j) fI(Y_j)
+ *
+ * hence every stage only solves a nonlinear system of the size of y with the stiff part.
+ *
+ */
+struct AdditiveButcherTableau {
+    std::string name;
+    // the explicit s x s coefficients matrix, strictly lower triangular
+    Eigen::MatrixXd AE;
+    // the implicit s x s coefficients matrix, lower triangular
+    Eigen::MatrixXd AI;
+    // the weights of both parts
+    Eigen::VectorXd b;
+    // the error estimate of a step is h * sum_i e(i) (fE(Y_i) + fI(Y_i)), empty for methods without error estimate
+    Eigen::VectorXd e;
+    // the order of the propagated solution, including the coupling conditions of both tableaus
+    unsigned int order;
+    // the error estimate behaves like h^(estimatorOrder + 1), it determines how the step size is adapted
+    unsigned int estimatorOrder;
+};
+
+
+
+
+/**
+ *
+ * Implementation of additive Runge Kutta (IMEX) methods: the non-stiff part of the problem is treated explicitly, for the
+ * stiff part every implicit stage solves Y - h AI(i,i) fI(Y) = R with OptimizationMethods::dampedNewton, which only needs
+ * the Jacobian of the stiff part. Either with a fixed number of steps (solve) or, for tableaus with an error estimate, with
+ * an adaptive step size controlled like in AdaptiveRungeKuttaIntegrator (solveAdaptive).
+ *
+ * Like for the implicit Runge-Kutta methods y must be of type Eigen::VectorXd.
+ *
+ * The Instrumentation policy decides whether statistics are collected, see ExplicitRungeKuttaIntegrator.
+ *
+ */
+template <class Step = Eigen::VectorXd, class Instrumentation = NoInstrumentation> class AdditiveRungeKuttaIntegrator {
+
+    public:
+        /**
+         * Constructor for the AdditiveRungeKuttaIntegrator
+         *
+         * @param tableau the additive butcher scheme, e.g. one of IMEXTableaus
+         * @param rtol the relative tolerance of a step, only used by the adaptive solve
+         * @param atol the absolute tolerance of a step, only used by the adaptive solve
+         * @param maxStep the largest step size of the adaptive solve
+         */
+        AdditiveRungeKuttaIntegrator(const AdditiveButcherTableau &tableau, double rtol = 1e-6, double atol = 1e-9, double maxStep = std::numeric_limits<double>::infinity())
+            : tableau(tableau), size(tableau.b.size()), rtol(rtol), atol(atol), maxStep(maxStep){
+        }
+
+        /**
+         * The solve methods applies the additive Runge Kutta method with a fixed step size
+         *
+         * @param fE the non-stiff part of the right hand side, it is treated explicitly
+         * @param fI the stiff part of the right hand side, it is treated implicitly
+         * @param JI the Jacobian of fI
+         * @param time the time interval we want to integrate over
+         * @param y0 the initial state of the system
+         * @param steps the number of integration steps we would like to make
+         *
+         * @return a std::vector of states, one for every integration step performed. The first step will be the supplied y0.
+         */
+        template<typename Explicit, typename Implicit, typename Jacobian>
+        std::vector<Step> solve(Explicit &&fE, Implicit &&fI, Jacobian &&JI, double time, const Step &y0, unsigned int steps){
+
+            std::vector<Step> stepsVector;
+            stepsVector.reserve(steps + 1);
+
+            integrate(fE, fI, JI, time, y0, steps, [&stepsVector] (double, const Step &y) {
+                stepsVector.push_back(y);
+            });
+
+            return stepsVector;
+
+        }
+
+        /**
+         * The solve methods applies the additive Runge Kutta method with a fixed step size and hands every state to an output
+         * instead of returning them
+         *
+         * @param output receives all steps+1 states, starting with y0, see rk_trajectory.hpp for the interface of an output
+         */
+        template<typename Explicit, typename Implicit, typename Jacobian, typename Output>
+        void solve(Explicit &&fE, Implicit &&fI, Jacobian &&JI, double time, const Step &y0, unsigned int steps, Output &output){
+
+            output.initialize(y0.size(), steps + 1);
+            integrate(fE, fI, JI, time, y0, steps, [&output] (double t, const Step &y) {
+                output.push(t, y);
+            });
+            output.finalize();
+
+        }
+
+        /**
+         * Integrates over [0, time] with adaptive step size and hands the state after every accepted step to the output
+         *
+         * @param fE the non-stiff part of the right hand side, it is treated explicitly
+         * @param fI the stiff part of the right hand side, it is treated implicitly
+         * @param JI the Jacobian of fI
+         * @param time the time interval we want to integrate over
+         * @param y0 the initial state of the system
+         * @param output receives y0 and the state after every accepted step
+         *
+         * @exception if the tableau has no error estimate or the step size becomes too small an error will be thrown
+         */
+        template<typename Explicit, typename Implicit, typename Jacobian, typename Output>
+        void solveAdaptive(Explicit &&fE, Implicit &&fI, Jacobian &&JI, double time, const Step &y0, Output &output){
+
+            if(tableau.e.size() == 0){
+                throw "The tableau has no error estimate";
+            }
+
+            instrumentation.reset();
+            prepare(y0);
+
+            output.initialize(y0.size(), 0);
+            output.push(0.0, y0);
+
+            if(time > 0){
+                integrateAdaptive(fE, fI, JI, time, y0, output);
+            }
+
+            output.finalize();
+
+        }
+
+        /**
+         * @return the statistics of the last solve (all zero unless the integrator uses StatisticsInstrumentation)
+         */
+        SolverStatistics statistics() const {
+            return instrumentation.statistics();
+        }
+
+        /**
+         * @return the instrumentation policy, for the data of a policy which goes beyond SolverStatistics
+         */
+        const Instrumentation &instrumentationPolicy() const {
+            return instrumentation;
+        }
+
+    private:
+        template<typename Explicit, typename Implicit, typename Jacobian, typename Push>
+        void integrate(Explicit &&fE, Implicit &&fI, Jacobian &&JI, double time, const Step &y0, unsigned int steps, Push &&push){
+
+            instrumentation.reset();
+            prepare(y0);
+
+            const double h = time / steps;
+            y = y0;
+            push(0.0, y);
+
+            for(unsigned int i = 0; i < steps; i++){
+                // the stages have to be considerably more accurate than the method itself
+                iteration(fE, fI, JI, h, 1e-12, 1e-14);
+                std::swap(y, y1);
+                instrumentation.count(Event::AcceptedStep);
+
+                auto timer = instrumentation.time(Phase::Output);
+                push((i + 1)*h, y);
+            }
+
+        }
+
+        template<typename Explicit, typename Implicit, typename Jacobian, typename Output>
+        void integrateAdaptive(Explicit &&fE, Implicit &&fI, Jacobian &&JI, double time, const Step &y0, Output &output){
+
+            y = y0;
+            double t = 0;
+            double h;
+            {
+                auto timer = instrumentation.time(Phase::Step);
+                auto f = [&] (const Step &argument, Step &result) {
+                    evaluate(fE, argument, result);
+                    evaluate(fI, argument, stage);
+                    result += stage;
+                };
+                f(y, explicitStages[0]);
+                h = StepSizeControl::initialStep(f, y, explicitStages[0], time, std::min(tableau.order, tableau.estimatorOrder), rtol, atol, maxStep, y1, implicitStages[0]);
+            }
+            bool rejected = false;
+
+            while(t < time){
+                // the last step ends exactly at time
+                bool last = t + h >= time;
+                if(last){
+                    h = time - t;
+                }
+
+                double error;
+                bool converged = true;
+                try{
+                    iteration(fE, fI, JI, h, 1e-2*rtol, 1e-2*atol);
+                    error = errorNorm(h);
+                }catch(const char *){
+                    converged = false;
+                    error = std::numeric_limits<double>::infinity();
+                }
+
+                if(error <= 1){
+                    instrumentation.count(Event::AcceptedStep);
+                    t = last ? time : t + h;
+                    std::swap(y, y1);
+                    {
+                        auto timer = instrumentation.time(Phase::Output);
+                        output.push(t, y);
+                    }
+
+                    h = std::min(h*StepSizeControl::factor(error, tableau.estimatorOrder, rejected), maxStep);
+                    rejected = false;
+                }else{
+                    instrumentation.count(Event::RejectedStep);
+                    // if Newton's method fails the step size is reduced considerably
+                    h *= converged ? StepSizeControl::factor(error, tableau.estimatorOrder) : 0.25;
+                    rejected = true;
+                }
+
+                if(t < time && StepSizeControl::tooSmall(h, t)){
+                    throw "Step size too small";
+                }
+            }
+
+        }
+
+        /**
+         * Sizes the workspace for states like y0
+         */
+        void prepare(const Step &y0){
+            explicitStages.assign(size, y0);
+            implicitStages.assign(size, y0);
+            stage = y0;
+            y1 = y0;
+        }
+
+        template<typename Function>
+        void evaluate(Function &&f, const Step &argument, Step &result){
+            auto timer = instrumentation.time(Phase::Rhs);
+            result = f(argument);
+            instrumentation.count(Event::RhsEvaluation);
+        }
+
+        /**
+         * Computes a step of size h from y in y1, the implicit stages are solved with the given tolerances
+         */
+        template<typename Explicit, typename Implicit, typename Jacobian>
+        void iteration(Explicit &&fE, Implicit &&fI, Jacobian &&JI, const double h, double reltol, double abstol){
+
+            auto stepTimer = instrumentation.time(Phase::Step);
+
+            for(unsigned int i = 0; i < size; i++){
+                // the known part R of the stage
+                {
+                    auto timer = instrumentation.time(Phase::Stages);
+                    stage = y;
+                    for(unsigned int j = 0; j < i; j++){
+                        if(tableau.AE(i,j) != 0){
+                            stage += h*tableau.AE(i,j) * explicitStages[j];
+                        }
+                        if(tableau.AI(i,j) != 0){
+                            stage += h*tableau.AI(i,j) * implicitStages[j];
+                        }
+                    }
+                }
+
+                // the stage solves Y - h AI(i,i) fI(Y) = R, starting from R
+                const double diagonal = h*tableau.AI(i,i);
+                if(diagonal != 0){
+                    auto G = [&] (const Eigen::VectorXd &argument) -> Eigen::VectorXd {
+                        auto timer = instrumentation.time(Phase::Rhs);
+                        instrumentation.count(Event::RhsEvaluation);
+                        return argument - diagonal*fI(argument) - stage;
+                    };
+                    auto DG = [&] (const Eigen::VectorXd &argument) -> Eigen::MatrixXd {
+                        auto timer = instrumentation.time(Phase::Rhs);
+                        return Eigen::MatrixXd::Identity(argument.size(), argument.size()) - diagonal*JI(argument);
+                    };
+                    stage = OptimizationMethods::dampedNewton(G, DG, stage, reltol, abstol, instrumentation);
+                }
+
+                evaluate(fE, stage, explicitStages[i]);
+                evaluate(fI, stage, implicitStages[i]);
+            }
+
+            auto timer = instrumentation.time(Phase::Stages);
+            y1 = y;
+            for(unsigned int i = 0; i < size; i++){
+                if(tableau.b(i) != 0){
+                    y1 += h*tableau.b(i) * explicitStages[i];
+                    y1 += h*tableau.b(i) * implicitStages[i];
+                }
+            }
+
+        }
+
+        /**
+         * @return the scaled RMS norm of the error estimate of the last step
+         */
+        double errorNorm(const double h){
+            auto timer = instrumentation.time(Phase::Stages);
+            // stage is free at this point and holds the error estimate
+            stage.setZero();
+            for(unsigned int i = 0; i < size; i++){
+                if(tableau.e(i) != 0){
+                    stage += h*tableau.e(i) * explicitStages[i];
+                    stage += h*tableau.e(i) * implicitStages[i];
+                }
+            }
+            return StepSizeControl::errorNorm(stage, y, y1, rtol, atol);
+        }
+
+
+        const AdditiveButcherTableau tableau;
+        unsigned int size;
+        double rtol;
+        double atol;
+        double maxStep;
+        Instrumentation instrumentation;
+
+        // workspace: the evaluations of both parts at the stages, the current stage and the state before and after the step
+        std::vector<Step> explicitStages;
+        std::vector<Step> implicitStages;
+        Step stage;
+        Step y;
+        Step y1;
+};
+
+
+
+
+#endif
@@ -3,8 +3,27 @@
 #define RKIMPLEMENTER
 
 #include <Eigen/Dense>
+#include <string>
 #include <vector>
 
+#include "rk_checkpoint.hpp"
+#include "rk_statistics.hpp"
+
+
+
+
+/**
+ * 
+ * A butcher tableau together with the name and the order of convergence of its method.
+ * 
+ */
+struct ButcherTableau {
+    std::string name;
+    Eigen::MatrixXd A;
+    Eigen::VectorXd b;
+    unsigned int order;
+};
+
 
 
 
@@ -12,8 +31,14 @@
  * 
  * Implementation of an explicit Runge Kutta Solver. See the documentation for more information.
  * 
+ * The Instrumentation policy decides whether statistics are collected (StatisticsInstrumentation, see rk_statistics.hpp),
+ * the default NoInstrumentation has no overhead.
+ * 
+ * The stages are kept in a workspace which is allocated once per solve, hence a step does not allocate any memory apart from
+ * what f allocates for its result (nothing for fixed size Steps). Therefore an integrator must not be used by several threads at once.
+ * 
  */
-template <class Step> class ExplicitRungeKuttaIntegrator {
+template <class Step, class Instrumentation = NoInstrumentation> class ExplicitRungeKuttaIntegrator {
 
     public:
         /**
@@ -25,6 +50,14 @@ template <class Step> class ExplicitRungeKuttaIntegrator {
         ExplicitRungeKuttaIntegrator(const Eigen::MatrixXd &A, const Eigen::VectorXd &b):A(A),b(b),size(A.cols()){
         }
 
+        /**
+         * Constructor for the ExplicitRungeKuttaIntegrator
+         * 
+         * @param tableau the butcher scheme, e.g. one of ExplicitRKTableaus
+         */
+        ExplicitRungeKuttaIntegrator(const ButcherTableau &tableau):ExplicitRungeKuttaIntegrator(tableau.A, tableau.b){
+        }
+
         /**
          * The solve methods applies an explicit Runge Kutta method to a given ODE
          * 
@@ -38,7 +71,11 @@ template <class Step> class ExplicitRungeKuttaIntegrator {
         template<typename Function>
         std::vector<Step> solve(Function &&f, double time, const Step &y0, unsigned int steps){
 
+            instrumentation.reset();
+            prepare(y0);
+
             std::vector<Step> stepsVector;
+            stepsVector.reserve(steps + 1);
             
             // as advertised the first position will be our initial state
             stepsVector.push_back(y0);
@@ -47,9 +84,12 @@ template <class Step> class ExplicitRungeKuttaIntegrator {
             double h = time / steps;
 
             // now we call the solver "steps" times to do the actual integration
+            Step y = y0;
             for(unsigned int i = 0; i < steps; i++){
                 // integrate and directly add to our list
-                stepsVector.push_back(iteration(f,stepsVector.back(),h));
+                iteration(f, y, h);
+                auto timer = instrumentation.time(Phase::Output);
+                stepsVector.push_back(y);
             }
             
             return stepsVector;
@@ -57,130 +97,199 @@ template <class Step> class ExplicitRungeKuttaIntegrator {
 
         }
 
-    private:
         /**
-         * This function computes on single runge kutta step and returns its result.
+         * The solve methods applies an explicit Runge Kutta method to a given ODE and hands every state to an output instead of returning them
          * 
          * @param f the function we are integrating over
-         * @param y0 the starting value (the initial value or the previous step's result)
-         * @param h the step size
-         * 
-         * @return the computation of one runge kutta step
+         * @param time the time interval we want to integrate over
+         * @param y0 the initial state of the system
+         * @param steps the number of integration steps we would like to make (number of steps equals number of runge kutta method evaluations)
+         * @param output receives all steps+1 states, starting with y0, e.g. a Trajectory (see rk_trajectory.hpp for the interface of an output)
          */
-        template<typename Function>
-        Step iteration(Function &&f, Step &y0, const double h){
-            
-            // initialize current step as previous step
-            Step y1 = y0;
-
-            // temporary vector to store the increments
-            std::vector<Step> increments;
-            
-            // calculate an increment per loop iteration
-            for(unsigned int i = 0; i < size; i++){
-
-                Step increment = y0;
-                // second loop to account for dependency of current increments on previous increments
-                for(unsigned int k = 0; k < i; k++){
-                    increment += h*A(i,k) * increments[k];
-                }
+        template<typename Function, typename Output>
+        void solve(Function &&f, double time, const Step &y0, unsigned int steps, Output &output){
 
-                // store the increment                
-                increments.push_back(f(increment));
-            }
+            instrumentation.reset();
 
-            // now we add the increments with correct weights to y0 which we already copied over to y1
-            for(unsigned int i = 0; i < size; i++){
-                y1 += h*b(i) *increments[i];
-            }
+            output.initialize(y0.size(), steps + 1);
+            output.push(0.0, y0);
 
-            return y1;
+            integrate(f, y0, time / steps, 0, steps, output, nullptr);
 
         }
 
+        /**
+         * Same as solve above, but additionally writes a checkpoint every few steps from which the integration can be resumed
+         * 
+         * @param checkpointer the file and interval for the checkpoints
+         */
+        template<typename Function, typename Output>
+        void solve(Function &&f, double time, const Step &y0, unsigned int steps, Output &output, const Checkpointer &checkpointer){
 
-        const Eigen::MatrixXd A;
-        const Eigen::VectorXd b;
-        unsigned int size;
-};
-
-
-
+            instrumentation.reset();
 
+            output.initialize(y0.size(), steps + 1);
+            output.push(0.0, y0);
 
+            integrate(f, y0, time / steps, 0, steps, output, &checkpointer);
 
+        }
 
+        /**
+         * Continues an integration started with solve from its last checkpoint. The integration has to be resumed with the same
+         * method, time and number of steps, the computed states are then exactly the same as without interruption.
+         * 
+         * @param f the function we are integrating over
+         * @param time the time interval of the interrupted integration
+         * @param steps the number of integration steps of the interrupted integration
+         * @param output receives the states after the checkpoint (not the state of the checkpoint itself)
+         * @param checkpointer the file to resume from, new checkpoints are written to it as in solve
+         * 
+         * @exception if the checkpoint does not belong to this integration an error will be thrown
+         */
+        template<typename Function, typename Output>
+        void resume(Function &&f, double time, unsigned int steps, Output &output, const Checkpointer &checkpointer){
 
+            Checkpoint checkpoint = checkpointer.load();
+            double h = time / steps;
+            if(checkpoint.method != fingerprint() || checkpoint.h != h || checkpoint.step > steps){
+                throw "Checkpoint does not belong to this integration";
+            }
 
+            instrumentation.reset();
 
+            Step y = checkpoint.state;
+            output.initialize(y.size(), steps - checkpoint.step);
 
+            integrate(f, y, h, checkpoint.step, steps, output, &checkpointer);
 
-template <typename Step> class ImplicitRungeKuttaIntegrator {
+        }
 
-    public:
-        ImplicitRungeKuttaIntegrator(const Eigen::MatrixXd &A, const Eigen::VectorXd &b) : A(A),b(b),size(A.cols()){
+        /**
+         * @return the statistics of the last solve (all zero unless the integrator uses StatisticsInstrumentation)
+         */
+        SolverStatistics statistics() const {
+            return instrumentation.statistics();
         }
 
+        /**
+         * @return the instrumentation policy, for the data of a policy which goes beyond SolverStatistics
+         */
+        const Instrumentation &instrumentationPolicy() const {
+            return instrumentation;
+        }
 
+    private:
         /**
-         * The solve methods applies an implicit Runge Kutta method to a given ODE
-         * 
-         * @param f the function we are integrating over
-         * @param the Jacobian of f, needed for finding 0 (newton method) to solve for stages.
-         * @param time the time interval we want to integrate over
-         * @param y0 the initial state of the system
-         * @param steps the number of integration steps we would like to make (number of steps equals number of runge kutta method evaluations)
+         * Performs the steps first+1 to last, starting at state y (the state after first steps)
          * 
-         * @return a std::vector of states, one for every integration step performed. The first step will be the supplied y0.
+         * @param checkpointer writes checkpoints if not nullptr
          */
-        template<typename Function, typename Jacobian>
-        std::vector<Step> solve(Function &&f, Jacobian && J, double time, const Step &y0, unsigned int steps){
+        template<typename Function, typename Output>
+        void integrate(Function &&f, Step y, const double h, unsigned int first, unsigned int last, Output &output, const Checkpointer *checkpointer){
 
-            std::vector<Step> stepsVector;
-            
-            // as advertised the first position will be our initial state
-            stepsVector.push_back(y0);
+            prepare(y);
 
-            // knowing the total time and number of steps allows us to calculate the time we integrate over every step
-            double h = time / steps;
+            // only the current state is kept, everything else is up to the output
+            for(unsigned int i = first; i < last; i++){
+                iteration(f, y, h);
+                {
+                    auto timer = instrumentation.time(Phase::Output);
+                    output.push((i + 1)*h, y);
+                }
 
-            // now we call the solver "steps" times to do the actual integration
-            for(unsigned int i = 0; i < steps; i++){
-                // integrate and directly add to our list
-                stepsVector.push_back(iteration(f,stepsVector.back(),h));
+                if(checkpointer != nullptr && checkpointer->due(i + 1)){
+                    Checkpoint checkpoint;
+                    checkpoint.step = i + 1;
+                    checkpoint.t = (i + 1)*h;
+                    checkpoint.h = h;
+                    checkpoint.method = fingerprint();
+                    checkpoint.state = Eigen::Map<const Eigen::VectorXd>(y.data(), y.size());
+                    checkpointer->save(checkpoint);
+                }
             }
-            
-            return stepsVector;
 
+            output.finalize();
 
         }
 
-    private:
+        std::uint64_t fingerprint() const {
+            return Checkpoint::fingerprint(A, b);
+        }
+
+        /**
+         * Sizes the workspace for states like y0, this is the only place where the integrator itself allocates memory
+         */
+        void prepare(const Step &y0){
+            increments.assign(size, y0);
+            stage = y0;
+        }
+
         /**
-         * This function computes on single runge kutta step and returns its result. This method uses 
+         * This function computes on single runge kutta step in place.
          * 
          * @param f the function we are integrating over
-         * @param y0 the starting value (the initial value or the previous step's result)
+         * @param y the starting value (the initial value or the previous step's result), it is overwritten with the result of the step
          * @param h the step size
-         * 
-         * @return the computation of one runge kutta step
          */
-        template<typename Function, typename Jacobian>
-        Step iteration(Function &&f, Jacobian && J, Step &y0, const double h){
+        template<typename Function>
+        void iteration(Function &&f, Step &y, const double h){
+
+            auto stepTimer = instrumentation.time(Phase::Step);
             
-            throw "not yet implemented";
-            // TODO 
+            // calculate an increment per loop iteration
+            for(unsigned int i = 0; i < size; i++){
+
+                {
+                    auto timer = instrumentation.time(Phase::Stages);
+                    stage = y;
+                    // second loop to account for dependency of current increments on previous increments, most tableaus are sparse
+                    for(unsigned int k = 0; k < i; k++){
+                        if(A(i,k) != 0){
+                            stage += h*A(i,k) * increments[k];
+                        }
+                    }
+                }
+
+                // store the increment                
+                auto timer = instrumentation.time(Phase::Rhs);
+                increments[i] = f(stage);
+                instrumentation.count(Event::RhsEvaluation);
+            }
+
+            // now we add the increments with correct weights to y
+            auto timer = instrumentation.time(Phase::Stages);
+            for(unsigned int i = 0; i < size; i++){
+                if(b(i) != 0){
+                    y += h*b(i) * increments[i];
+                }
+            }
+            instrumentation.count(Event::AcceptedStep);
 
         }
 
 
-    private:
         const Eigen::MatrixXd A;
         const Eigen::VectorXd b;
         unsigned int size;
+        Instrumentation instrumentation;
+
+        // workspace of iteration: the increments and the argument of f for the current one
+        std::vector<Step> increments;
+        Step stage;
 };
 
 
+
+
+
+
+
+
+
+
+
+
 // a collection of optimization methods needed for implicit runge-kutta methods
 namespace OptimizationMethods{
 
@@ -189,10 +298,11 @@ namespace OptimizationMethods{
      * Source: Adapted from 'C++ code 8.4.4.5' of the book https://www.sam.math.ethz.ch/~grsam/NCSE19/NumCSE_Lecture_Document.pdf
      * 
      * @param f the function whose root we want to find
-     * @param J the jacobian of f
+     * @param J the jacobian of f, a matrix or any type whose lu() can solve for a Step (e.g. MultipleShootingJacobian)
      * @param x0 the starting value for the newton iteration
      * @param reltol if the difference between two iterations is smaller than rtol*x', with x' a likely root, we stop the iteration
      * @param abstol if the difference between two iterations is smaller than abstol we stop the iteration 
+     * @param instrumentation counts Newton iterations, Jacobian evaluations, LU factorizations and linear solves and times the linear algebra
      * 
      * @exception if the function does not converge an error will be thrown
      * 
@@ -200,13 +310,13 @@ namespace OptimizationMethods{
      * @return the root of f (the value x where f(x) = 0)
      * 
      */
-    template<typename Step, typename Function, typename Jacobian>
-    Step dampedNewton(Function &&f, Jacobian &&J, Step x0, double reltol = 1e-7, double abstol=1e-8){
+    template<typename Step, typename Function, typename Jacobian, typename Instrumentation>
+    Step dampedNewton(Function &&f, Jacobian &&J, Step x0, double reltol, double abstol, Instrumentation &instrumentation){
 
         // first we check the dimensionality of the function
         uint32_t n = x0.size();
         Step correction(n), tentativeCorrection(n);
-        Step x(n);
+        Step x = x0;
         Step xTemp(n);
         double correctionNorm, tentativeCorrectionNorm;
         
@@ -216,10 +326,24 @@ namespace OptimizationMethods{
 
         do {
             // calculate the difference to the next iterate
-            auto jacobianLUFactorized = J(x).lu();
-            correction = jacobianLUFactorized.solve(f(x));
+            auto jacobian = J(x);
+            auto jacobianLUFactorized = [&] () {
+                auto timer = instrumentation.time(Phase::LinearAlgebra);
+                return jacobian.lu();
+            }();
+            Step residual = f(x);
+            {
+                auto timer = instrumentation.time(Phase::LinearAlgebra);
+                correction = jacobianLUFactorized.solve(residual);
+            }
             correctionNorm = correction.norm();
+            instrumentation.count(Event::NewtonIteration);
+            instrumentation.count(Event::JacobianEvaluation);
+            instrumentation.count(Event::LuFactorization);
+            instrumentation.count(Event::LinearSolve);
 
+            // the first tentative step uses the current damping factor
+            lambda *= 2;
             do {
                 // reduction of damping factor
                 lambda /= 2;
@@ -229,20 +353,225 @@ namespace OptimizationMethods{
                 }
                 // tentative next iterate
                 xTemp = x-lambda*correction;
-                tentativeCorrection = jacobianLUFactorized.solve(f(xTemp));
+                residual = f(xTemp);
+                {
+                    auto timer = instrumentation.time(Phase::LinearAlgebra);
+                    tentativeCorrection = jacobianLUFactorized.solve(residual);
+                }
                 tentativeCorrectionNorm = tentativeCorrection.norm();
+                instrumentation.count(Event::LinearSolve);
             } while(tentativeCorrectionNorm > (1-lambda/2)*correctionNorm);
             // we accept the new step
             x = xTemp;
             // we somewhat reduce the damping
             lambda = std::min(2*lambda,1.0);
         } while((tentativeCorrectionNorm > reltol*x.norm()) && tentativeCorrectionNorm > abstol);
+
+        return x;
+    }
+
+    /**
+     * The damped newton method as above, without instrumentation
+     */
+    template<typename Step, typename Function, typename Jacobian>
+    Step dampedNewton(Function &&f, Jacobian &&J, Step x0, double reltol = 1e-7, double abstol=1e-8){
+        NoInstrumentation instrumentation;
+        return dampedNewton(f, J, x0, reltol, abstol, instrumentation);
     }
 }
 
 
 
 
+/**
+ * 
+ * Implementation of an implicit Runge Kutta Solver. The stage equations of every step are solved with OptimizationMethods::dampedNewton.
+ * 
+ * The Instrumentation policy decides whether statistics are collected, see ExplicitRungeKuttaIntegrator.
+ * 
+ */
+template <typename Step, typename Instrumentation = NoInstrumentation> class ImplicitRungeKuttaIntegrator {
+
+    public:
+        ImplicitRungeKuttaIntegrator(const Eigen::MatrixXd &A, const Eigen::VectorXd &b) : A(A),b(b),size(A.cols()){
+        }
+
+        ImplicitRungeKuttaIntegrator(const ButcherTableau &tableau) : ImplicitRungeKuttaIntegrator(tableau.A, tableau.b){
+        }
+
+
+        /**
+         * The solve methods applies an implicit Runge Kutta method to a given ODE
+         * 
+         * @param f the function we are integrating over
+         * @param the Jacobian of f, needed for finding 0 (newton method) to solve for stages.
+         * @param time the time interval we want to integrate over
+         * @param y0 the initial state of the system
+         * @param steps the number of integration steps we would like to make (number of steps equals number of runge kutta method evaluations)
+         * 
+         * @return a std::vector of states, one for every integration step performed. The first step will be the supplied y0.
+         */
+        template<typename Function, typename Jacobian>
+        std::vector<Step> solve(Function &&f, Jacobian && J, double time, const Step &y0, unsigned int steps){
+
+            instrumentation.reset();
+
+            std::vector<Step> stepsVector;
+            
+            // as advertised the first position will be our initial state
+            stepsVector.push_back(y0);
+
+            // knowing the total time and number of steps allows us to calculate the time we integrate over every step
+            double h = time / steps;
+
+            // now we call the solver "steps" times to do the actual integration
+            for(unsigned int i = 0; i < steps; i++){
+                // integrate and directly add to our list
+                Step y1 = iteration(f,J,stepsVector.back(),h);
+                auto timer = instrumentation.time(Phase::Output);
+                stepsVector.push_back(y1);
+            }
+            
+            return stepsVector;
+
+
+        }
+
+        /**
+         * The solve methods applies an implicit Runge Kutta method to a given ODE and hands every state to an output instead of returning them
+         * 
+         * @param f the function we are integrating over
+         * @param the Jacobian of f, needed for finding 0 (newton method) to solve for stages.
+         * @param time the time interval we want to integrate over
+         * @param y0 the initial state of the system
+         * @param steps the number of integration steps we would like to make (number of steps equals number of runge kutta method evaluations)
+         * @param output receives all steps+1 states, starting with y0, e.g. a Trajectory (see rk_trajectory.hpp for the interface of an output)
+         */
+        template<typename Function, typename Jacobian, typename Output>
+        void solve(Function &&f, Jacobian && J, double time, const Step &y0, unsigned int steps, Output &output){
+
+            instrumentation.reset();
+
+            output.initialize(y0.size(), steps + 1);
+            output.push(0.0, y0);
+
+            double h = time / steps;
+
+            Step y = y0;
+            for(unsigned int i = 0; i < steps; i++){
+                y = iteration(f, J, y, h);
+                auto timer = instrumentation.time(Phase::Output);
+                output.push((i + 1)*h, y);
+            }
+
+            output.finalize();
+
+        }
+
+        /**
+         * @return the statistics of the last solve (all zero unless the integrator uses StatisticsInstrumentation)
+         */
+        SolverStatistics statistics() const {
+            return instrumentation.statistics();
+        }
+
+        /**
+         * @return the instrumentation policy, for the data of a policy which goes beyond SolverStatistics
+         */
+        const Instrumentation &instrumentationPolicy() const {
+            return instrumentation;
+        }
+
+    private:
+        /**
+         * This function computes on single runge kutta step and returns its result. This method uses the damped newton
+         * method to solve the nonlinear system of equations for all increments k_i = f(y0 + h * sum_j A(i,j) k_j) at once.
+         * 
+         * @param f the function we are integrating over
+         * @param J the Jacobian of f
+         * @param y0 the starting value (the initial value or the previous step's result)
+         * @param h the step size
+         * 
+         * @return the computation of one runge kutta step
+         */
+        template<typename Function, typename Jacobian>
+        Step iteration(Function &&f, Jacobian && J, const Step &y0, const double h){
+
+            auto stepTimer = instrumentation.time(Phase::Step);
+            
+            const unsigned int n = y0.size();
+
+            // the argument of f for the i-th increment, given all (stacked) increments
+            auto stage = [&] (const Eigen::VectorXd &increments, unsigned int i) {
+                auto timer = instrumentation.time(Phase::Stages);
+                Step y = y0;
+                for(unsigned int j = 0; j < size; j++){
+                    y += h*A(i,j) * increments.segment(j*n, n);
+                }
+                return y;
+            };
+
+            // the increments are the root of this function
+            auto F = [&] (const Eigen::VectorXd &increments) {
+                Eigen::VectorXd result(size*n);
+                for(unsigned int i = 0; i < size; i++){
+                    Step y = stage(increments, i);
+                    auto timer = instrumentation.time(Phase::Rhs);
+                    result.segment(i*n, n) = increments.segment(i*n, n) - f(y);
+                    instrumentation.count(Event::RhsEvaluation);
+                }
+                return result;
+            };
+
+            auto DF = [&] (const Eigen::VectorXd &increments) {
+                Eigen::MatrixXd result = Eigen::MatrixXd::Identity(size*n, size*n);
+                for(unsigned int i = 0; i < size; i++){
+                    Step y = stage(increments, i);
+                    auto timer = instrumentation.time(Phase::Rhs);
+                    Eigen::MatrixXd jacobian = J(y);
+                    for(unsigned int j = 0; j < size; j++){
+                        result.block(i*n, j*n, n, n) -= h*A(i,j) * jacobian;
+                    }
+                }
+                return result;
+            };
+
+            // all increments start as f(y0), the increment of the explicit euler method
+            Eigen::VectorXd increments(size*n);
+            {
+                auto timer = instrumentation.time(Phase::Rhs);
+                increments.segment(0, n) = f(y0);
+                instrumentation.count(Event::RhsEvaluation);
+            }
+            for(unsigned int i = 1; i < size; i++){
+                increments.segment(i*n, n) = increments.segment(0, n);
+            }
+
+            // the stages have to be considerably more accurate than the method itself
+            increments = OptimizationMethods::dampedNewton(F, DF, increments, 1e-12, 1e-14, instrumentation);
+
+            auto timer = instrumentation.time(Phase::Stages);
+            Step y1 = y0;
+            for(unsigned int i = 0; i < size; i++){
+                y1 += h*b(i) * increments.segment(i*n, n);
+            }
+            instrumentation.count(Event::AcceptedStep);
+
+            return y1;
+
+        }
+
+
+    private:
+        const Eigen::MatrixXd A;
+        const Eigen::VectorXd b;
+        unsigned int size;
+        Instrumentation instrumentation;
+};
+
+
+
+
 
 
 
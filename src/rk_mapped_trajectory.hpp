@@ -0,0 +1,247 @@
+#ifndef RKMAPPEDTRAJECTORY
+
+#define RKMAPPEDTRAJECTORY
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "rk_npy_writer.hpp"
+
+
+
+
+/**
+ *
+ * A trajectory which lives in a memory-mapped file instead of main memory (POSIX only). It can hold more states than fit into RAM,
+ * the operating system pages parts of the trajectory which are not in use out to the file.
+ *
+ * The file grows in chunks of states while the integration runs. Every state is stored as one row consisting of its time
+ * followed by its components, the file is a valid NumPy .npy file once finalize has been called.
+ *
+ * States can be accessed by index or by time. The returned views point into the mapping, they become invalid as soon as
+ * another state is pushed or finalize is called (the file might have to be resized and mapped again).
+ *
+ */
+class MappedTrajectory {
+
+    public:
+        /**
+         * Constructor for the MappedTrajectory
+         *
+         * @param filename the backing file, an existing file is overwritten
+         * @param chunkSize the number of states the file grows by whenever it is full
+         *
+         * @exception if chunkSize is 0 or the file can not be opened an error will be thrown
+         */
+        MappedTrajectory(const std::string &filename, std::size_t chunkSize = 1 << 16) :
+            chunkSize(chunkSize),mapping(nullptr),mappedBytes(0),dimension(0),capacity(0),count(0){
+            // the file could never grow
+            if(chunkSize == 0){
+                throw "The chunk size must be positive";
+            }
+            file = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+            if(file < 0){
+                throw "Could not open file";
+            }
+        }
+
+        MappedTrajectory(const MappedTrajectory &) = delete;
+        MappedTrajectory &operator=(const MappedTrajectory &) = delete;
+
+        ~MappedTrajectory(){
+            if(mapping != nullptr){
+                ::munmap(mapping, mappedBytes);
+            }
+            ::close(file);
+        }
+
+        /**
+         * Maps the file, large enough for count states (or one chunk if count is not known)
+         *
+         * @param dimension the number of components of a single state
+         * @param count the number of states which will be pushed, the file grows if more states are pushed
+         */
+        void initialize(unsigned int dimension, unsigned int count){
+            this->dimension = dimension;
+            this->count = 0;
+            remap(count > 0 ? count : chunkSize);
+        }
+
+        /**
+         * Appends a state to the trajectory, growing the file by a chunk if it is full
+         *
+         * @param t the time of the state
+         * @param y the state, must have as many components as given in initialize
+         *
+         * @exception if initialize has not been called or the file can not grow an error will be thrown
+         */
+        template<typename State>
+        void push(double t, const State &y){
+            if(count == capacity){
+                requireMapping();
+                remap(capacity + chunkSize);
+            }
+            double *row = rowPointer(count);
+            row[0] = t;
+            std::memcpy(row + 1, y.data(), dimension*sizeof(double));
+            count++;
+        }
+
+        /**
+         * Writes the .npy header for the final number of states and shrinks the file (and the mapping) to its actual size. If states
+         * are pushed afterwards the file grows again and finalize has to be called once more.
+         *
+         * @exception if initialize has not been called or the file can not be written an error will be thrown
+         */
+        void finalize(){
+            requireMapping();
+            std::string header = Npy::header(count, dimension + 1);
+            std::memcpy(mapping, header.data(), header.size());
+            if(::msync(mapping, mappedBytes, MS_SYNC) != 0){
+                throw "Could not write file";
+            }
+            // the mapping must not reach beyond the end of the file, else a later push would write past it (SIGBUS)
+            remap(count);
+        }
+
+        /**
+         * @return the number of states stored in the trajectory
+         */
+        std::size_t size() const {
+            return count;
+        }
+
+        /**
+         * @return the number of components of a single state
+         */
+        unsigned int dimensions() const {
+            return dimension;
+        }
+
+        /**
+         * @return a view of the i-th state
+         */
+        Eigen::Map<const Eigen::VectorXd> operator[](std::size_t i) const {
+            return Eigen::Map<const Eigen::VectorXd>(rowPointer(i) + 1, dimension);
+        }
+
+        /**
+         * @return the time of the i-th state
+         */
+        double time(std::size_t i) const {
+            return rowPointer(i)[0];
+        }
+
+        /**
+         * @return a view of the times of all states
+         *
+         * @exception if initialize has not been called an error will be thrown
+         */
+        Eigen::Map<const Eigen::VectorXd, 0, Eigen::InnerStride<>> times() const {
+            requireMapping();
+            return Eigen::Map<const Eigen::VectorXd, 0, Eigen::InnerStride<>>(rowPointer(0), count, Eigen::InnerStride<>(dimension + 1));
+        }
+
+        /**
+         * @return a view of the evolution of the i-th component over all states
+         *
+         * @exception if initialize has not been called an error will be thrown
+         */
+        Eigen::Map<const Eigen::RowVectorXd, 0, Eigen::InnerStride<>> row(unsigned int i) const {
+            requireMapping();
+            return Eigen::Map<const Eigen::RowVectorXd, 0, Eigen::InnerStride<>>(rowPointer(0) + 1 + i, count, Eigen::InnerStride<>(dimension + 1));
+        }
+
+        /**
+         * Finds a state by its time using binary search, the states must have been pushed with increasing times
+         *
+         * @param t the time we are looking for
+         *
+         * @return the index of the last state with a time smaller or equal to t (0 if t lies before the first state)
+         *
+         * @exception if the trajectory is empty an error will be thrown
+         */
+        std::size_t indexAt(double t) const {
+            if(count == 0){
+                throw "The trajectory is empty";
+            }
+            std::size_t low = 0, high = count;
+            while(high - low > 1){
+                std::size_t middle = low + (high - low)/2;
+                if(time(middle) <= t){
+                    low = middle;
+                } else {
+                    high = middle;
+                }
+            }
+            return low;
+        }
+
+        /**
+         * @return a view of the last state with a time smaller or equal to t
+         *
+         * @exception if the trajectory is empty an error will be thrown
+         */
+        Eigen::Map<const Eigen::VectorXd> at(double t) const {
+            return (*this)[indexAt(t)];
+        }
+
+        /**
+         * @return the last state pushed to the trajectory
+         */
+        Eigen::Map<const Eigen::VectorXd> back() const {
+            return (*this)[count - 1];
+        }
+
+    private:
+        std::size_t bytes(std::size_t states) const {
+            return Npy::headerSize + states*(dimension + 1)*sizeof(double);
+        }
+
+        void requireMapping() const {
+            if(mapping == nullptr){
+                throw "The trajectory has not been initialized";
+            }
+        }
+
+        double *rowPointer(std::size_t i) const {
+            return reinterpret_cast<double*>(static_cast<char*>(mapping) + Npy::headerSize) + i*(dimension + 1);
+        }
+
+        // resizes the file to hold the given number of states and maps all of it
+        void remap(std::size_t states){
+            if(mapping != nullptr){
+                ::munmap(mapping, mappedBytes);
+                mapping = nullptr;
+            }
+            mappedBytes = bytes(states);
+            if(::ftruncate(file, mappedBytes) != 0){
+                throw "Could not resize file";
+            }
+            void *result = ::mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+            if(result == MAP_FAILED){
+                throw "Could not map file";
+            }
+            mapping = result;
+            capacity = states;
+        }
+
+        int file;
+        std::size_t chunkSize;
+        void *mapping;
+        std::size_t mappedBytes;
+        unsigned int dimension;
+        std::size_t capacity;
+        std::size_t count;
+};
+
+
+
+
+#endif
@@ -0,0 +1,827 @@
+#ifndef RKMULTISTEP
+
+#define RKMULTISTEP
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "rk_adaptive.hpp"
+#include "rk_implementer.hpp"
+#include "rk_solvers.hpp"
+#include "rk_statistics.hpp"
+
+
+
+
+/**
+ *
+ * Coefficients of multistep methods with variable step sizes. They are computed for the actual time points of the past
+ * steps in every step, from the Lagrange polynomials through these points. All times are relative to the current time and
+ * divided by the step size, i.e. the current time is 0 and the time after the step is 1.
+ *
+ */
+namespace MultistepCoefficients{
+
+    // the largest number of time points, enough for Adams methods of order 12
+    const unsigned int maximalNodes = 14;
+
+    using Nodes = std::array<double, maximalNodes>;
+
+    // the Gauss-Legendre rule with 8 points on [0, 1], exact for polynomials up to degree 15
+    struct GaussLegendre {
+        std::array<double, 8> nodes;
+        std::array<double, 8> weights;
+    };
+
+    inline const GaussLegendre &gaussLegendre(){
+        static const GaussLegendre rule = [] () {
+            GaussLegendre rule;
+            const int n = 8;
+            for(int i = 0; i < n; i++){
+                // Newton's method for the i-th root of the Legendre polynomial P_n
+                double x = std::cos(M_PI*(i + 0.75)/(n + 0.5));
+                double derivative = 0;
+                for(int iteration = 0; iteration < 100; iteration++){
+                    double p0 = 1, p1 = x;
+                    for(int k = 2; k <= n; k++){
+                        double p2 = ((2*k - 1)*x*p1 - (k - 1)*p0)/k;
+                        p0 = p1;
+                        p1 = p2;
+                    }
+                    derivative = n*(x*p1 - p0)/(x*x - 1);
+                    double dx = p1/derivative;
+                    x -= dx;
+                    if(std::abs(dx) < 1e-16){
+                        break;
+                    }
+                }
+                rule.nodes[i] = (1 - x)/2;
+                rule.weights[i] = 1/((1 - x*x)*derivative*derivative);
+            }
+            return rule;
+        }();
+        return rule;
+    }
+
+    /**
+     * Computes the values of the Lagrange polynomials of the given nodes at a point
+     *
+     * @param values the value of the j-th Lagrange polynomial (1 at node j, 0 at the others) is stored in values[j]
+     */
+    inline void lagrangeValues(const Nodes &nodes, unsigned int count, double at, Nodes &values){
+        for(unsigned int j = 0; j < count; j++){
+            values[j] = 1;
+            for(unsigned int i = 0; i < count; i++){
+                if(i != j){
+                    values[j] *= (at - nodes[i])/(nodes[j] - nodes[i]);
+                }
+            }
+        }
+    }
+
+    /**
+     * Computes the weights of the integral over [0, 1] of the polynomial interpolating values at the nodes, the weights of
+     * Adams methods
+     */
+    inline void integrationWeights(const Nodes &nodes, unsigned int count, Nodes &weights){
+        const GaussLegendre &rule = gaussLegendre();
+        Nodes values;
+        std::fill(weights.begin(), weights.begin() + count, 0.0);
+        for(unsigned int q = 0; q < rule.nodes.size(); q++){
+            lagrangeValues(nodes, count, rule.nodes[q], values);
+            for(unsigned int j = 0; j < count; j++){
+                weights[j] += rule.weights[q]*values[j];
+            }
+        }
+    }
+
+    /**
+     * Computes the weights of the derivative at node m of the polynomial interpolating values at the nodes, the weights of
+     * BDF methods
+     */
+    inline void differentiationWeights(const Nodes &nodes, unsigned int count, unsigned int m, Nodes &weights){
+        // barycentric weights
+        Nodes barycentric;
+        for(unsigned int j = 0; j < count; j++){
+            barycentric[j] = 1;
+            for(unsigned int i = 0; i < count; i++){
+                if(i != j){
+                    barycentric[j] /= nodes[j] - nodes[i];
+                }
+            }
+        }
+        weights[m] = 0;
+        for(unsigned int j = 0; j < count; j++){
+            if(j != m){
+                weights[j] = barycentric[j]/barycentric[m]/(nodes[m] - nodes[j]);
+                weights[m] -= weights[j];
+            }
+        }
+    }
+
+}
+
+
+
+
+/**
+ *
+ * The past states of a multistep method, index 0 is the latest one. Shifting the history swaps the states instead of
+ * copying them, hence it does not allocate memory.
+ *
+ */
+template <class Step> class MultistepHistory {
+
+    public:
+        /**
+         * Sizes the history for capacity states like y0 and clears it
+         */
+        void prepare(unsigned int capacity, const Step &y0){
+            times.assign(capacity, 0.0);
+            states.assign(capacity, y0);
+            derivatives.assign(capacity, y0);
+            count = 0;
+        }
+
+        /**
+         * Makes room for a new latest state, state(0) and derivative(0) then hold outdated values which have to be overwritten
+         */
+        void shift(double t){
+            std::rotate(times.rbegin(), times.rbegin() + 1, times.rend());
+            std::rotate(states.rbegin(), states.rbegin() + 1, states.rend());
+            std::rotate(derivatives.rbegin(), derivatives.rbegin() + 1, derivatives.rend());
+            times[0] = t;
+            count = std::min<unsigned int>(count + 1, times.size());
+        }
+
+        /**
+         * Stores the times of the first count states relative to the latest one and divided by h
+         */
+        void nodes(double h, unsigned int count, MultistepCoefficients::Nodes &nodes, unsigned int offset = 0) const {
+            for(unsigned int j = 0; j < count; j++){
+                nodes[offset + j] = (times[j] - times[0])/h;
+            }
+        }
+
+        double time(unsigned int i) const { return times[i]; }
+        Step &state(unsigned int i) { return states[i]; }
+        const Step &state(unsigned int i) const { return states[i]; }
+        Step &derivative(unsigned int i) { return derivatives[i]; }
+        const Step &derivative(unsigned int i) const { return derivatives[i]; }
+        unsigned int size() const { return count; }
+
+    private:
+        std::vector<double> times;
+        std::vector<Step> states;
+        std::vector<Step> derivatives;
+        unsigned int count = 0;
+};
+
+
+
+
+/**
+ *
+ * Implementation of a variable order, variable step size Adams method in PECE mode: the Adams-Bashforth method of order k
+ * predicts, the Adams-Moulton method of order k+1 corrects, hence a step costs two evaluations of f (one if it is rejected).
+ * The difference between the corrector and the predictor estimates the error. After every accepted step the order is
+ * lowered or raised if the predictor of the neighbouring order promises a larger step.
+ *
+ * The starting values are computed with the classical 4th order Runge-Kutta method. Like the Runge-Kutta integrators a step
+ * does not allocate memory apart from what f allocates for its result.
+ *
+ * The Instrumentation policy decides whether statistics are collected, see ExplicitRungeKuttaIntegrator.
+ *
+ */
+template <class Step, class Instrumentation = NoInstrumentation> class AdamsIntegrator {
+
+    public:
+        /**
+         * Constructor for the AdamsIntegrator
+         *
+         * @param rtol the relative tolerance of a step
+         * @param atol the absolute tolerance of a step
+         * @param maxOrder the highest order of the Adams-Bashforth predictor, at most 12
+         * @param maxStep the largest step size the integrator may use
+         */
+        AdamsIntegrator(double rtol = 1e-6, double atol = 1e-9, unsigned int maxOrder = 8, double maxStep = std::numeric_limits<double>::infinity())
+            : rtol(rtol), atol(atol), maxOrder(maxOrder), maxStep(maxStep){
+            if(maxOrder < 1 || maxOrder > 12){
+                throw "The order of the Adams method must be between 1 and 12";
+            }
+        }
+
+        /**
+         * Integrates over [0, time] with variable order and step size and hands the state after every step to the output
+         *
+         * @param f the function we are integrating over
+         * @param time the time interval we want to integrate over
+         * @param y0 the initial state of the system
+         * @param output receives y0 and the state after every step, see rk_trajectory.hpp for the interface of an output
+         *
+         * @exception if the step size becomes too small an error will be thrown
+         */
+        template<typename Function, typename Output>
+        void solve(Function &&f, double time, const Step &y0, Output &output){
+
+            instrumentation.reset();
+
+            output.initialize(y0.size(), 0);
+            output.push(0.0, y0);
+
+            if(time > 0){
+                integrate(f, time, y0, output);
+            }
+
+            output.finalize();
+
+        }
+
+        /**
+         * @return the statistics of the last solve (all zero unless the integrator uses StatisticsInstrumentation)
+         */
+        SolverStatistics statistics() const {
+            return instrumentation.statistics();
+        }
+
+        /**
+         * @return the instrumentation policy, for the data of a policy which goes beyond SolverStatistics
+         */
+        const Instrumentation &instrumentationPolicy() const {
+            return instrumentation;
+        }
+
+    private:
+        template<typename Function, typename Output>
+        void integrate(Function &&f, double time, const Step &y0, Output &output){
+
+            auto evaluate = [&] (const Step &argument, Step &result) {
+                auto timer = instrumentation.time(Phase::Rhs);
+                result = f(argument);
+                instrumentation.count(Event::RhsEvaluation);
+            };
+
+            // the order 4 predictor matches the accuracy of the starting values
+            unsigned int order = std::min(4u, maxOrder);
+
+            history.prepare(maxOrder + 1, y0);
+            predicted = y0;
+            corrected = y0;
+            derivative = y0;
+
+            history.shift(0.0);
+            history.state(0) = y0;
+            double h;
+            {
+                auto timer = instrumentation.time(Phase::Step);
+                evaluate(y0, history.derivative(0));
+                h = StepSizeControl::initialStep(evaluate, y0, history.derivative(0), time, order, rtol, atol, maxStep, predicted, corrected);
+                h = std::min(h, time/order);
+            }
+
+            // the starting values, order - 1 steps of the classical 4th order method
+            if(order > 1){
+                auto timer = instrumentation.time(Phase::Step);
+                ExplicitRungeKuttaIntegrator<Step> startup(ExplicitRKTableaus::classical4thOrder());
+                std::vector<Step> start = startup.solve([&] (const Step &y) {
+                    Step result;
+                    evaluate(y, result);
+                    return result;
+                }, (order - 1)*h, y0, order - 1);
+
+                for(unsigned int i = 1; i < order; i++){
+                    history.shift(i*h);
+                    history.state(0) = start[i];
+                    evaluate(history.state(0), history.derivative(0));
+                    instrumentation.count(Event::AcceptedStep);
+                    auto outputTimer = instrumentation.time(Phase::Output);
+                    output.push(i*h, history.state(0));
+                }
+            }
+
+            double t = (order - 1)*h;
+            unsigned int stepsAtOrder = 0;
+            unsigned int rejections = 0;
+
+            while(t < time){
+                bool last = t + h >= time;
+                if(last){
+                    h = time - t;
+                }
+
+                double error;
+                {
+                    auto timer = instrumentation.time(Phase::Step);
+                    history.nodes(h, std::min(history.size(), order + 1), nodes, 1);
+                    nodes[0] = 1;
+
+                    predict(h, order);
+                    evaluate(predicted, derivative);
+
+                    // Adams-Moulton over the new time point and the ones of the predictor
+                    {
+                        auto stageTimer = instrumentation.time(Phase::Stages);
+                        MultistepCoefficients::integrationWeights(nodes, order + 1, weights);
+                        corrected = history.state(0) + (h*weights[0])*derivative;
+                        for(unsigned int j = 0; j < order; j++){
+                            corrected += (h*weights[j + 1])*history.derivative(j);
+                        }
+                    }
+                    error = StepSizeControl::errorNorm(corrected - predicted, history.state(0), corrected, rtol, atol);
+                }
+
+                if(error <= 1){
+                    instrumentation.count(Event::AcceptedStep);
+                    stepsAtOrder++;
+                    rejections = 0;
+
+                    // the errors of the neighbouring orders, estimated with their predictors
+                    double factor = stepFactor(error, order);
+                    unsigned int nextOrder = order;
+                    {
+                        auto timer = instrumentation.time(Phase::Step);
+                        if(order > 1){
+                            predict(h, order - 1);
+                            double lower = stepFactor(StepSizeControl::errorNorm(corrected - predicted, history.state(0), corrected, rtol, atol), order - 1);
+                            if(lower > factor){
+                                factor = lower;
+                                nextOrder = order - 1;
+                            }
+                        }
+                        if(nextOrder == order && order < maxOrder && stepsAtOrder > order && history.size() > order){
+                            predict(h, order + 1);
+                            double higher = stepFactor(StepSizeControl::errorNorm(corrected - predicted, history.state(0), corrected, rtol, atol), order + 1);
+                            if(higher > factor){
+                                factor = higher;
+                                nextOrder = order + 1;
+                            }
+                        }
+
+                        t = last ? time : t + h;
+                        history.shift(t);
+                        std::swap(history.state(0), corrected);
+                        evaluate(history.state(0), history.derivative(0));
+                    }
+
+                    {
+                        auto timer = instrumentation.time(Phase::Output);
+                        output.push(t, history.state(0));
+                    }
+
+                    if(nextOrder != order){
+                        order = nextOrder;
+                        stepsAtOrder = 0;
+                    }
+                    h = std::min(h*factor, maxStep);
+                }else{
+                    instrumentation.count(Event::RejectedStep);
+                    h *= stepFactor(error, order);
+                    // repeated rejections indicate that the order is too high for the current behaviour of the solution
+                    if(++rejections >= 2 && order > 1){
+                        order--;
+                        stepsAtOrder = 0;
+                    }
+                }
+
+                if(t < time && StepSizeControl::tooSmall(h, t)){
+                    throw "Step size too small";
+                }
+            }
+
+        }
+
+        /**
+         * Computes the Adams-Bashforth predictor of the given order in predicted, nodes[1..] hold the past time points
+         */
+        void predict(const double h, unsigned int order){
+            auto timer = instrumentation.time(Phase::Stages);
+            MultistepCoefficients::Nodes past;
+            std::copy(nodes.begin() + 1, nodes.begin() + 1 + order, past.begin());
+            MultistepCoefficients::integrationWeights(past, order, weights);
+            predicted = history.state(0);
+            for(unsigned int j = 0; j < order; j++){
+                predicted += (h*weights[j])*history.derivative(j);
+            }
+        }
+
+        /**
+         * @return the factor of the step size for which a method of the given order would have an error of about 1
+         */
+        double stepFactor(double error, unsigned int order) const {
+            return StepSizeControl::factor(error, order, false, maxFactor);
+        }
+
+
+        double rtol;
+        double atol;
+        unsigned int maxOrder;
+        double maxStep;
+        Instrumentation instrumentation;
+
+        // multistep methods do not like large changes of the step size
+        static constexpr double maxFactor = 2;
+
+        // workspace
+        MultistepHistory<Step> history;
+        MultistepCoefficients::Nodes nodes;
+        MultistepCoefficients::Nodes weights;
+        Step predicted;
+        Step corrected;
+        Step derivative;
+};
+
+
+
+
+/**
+ *
+ * Implementation of the variable order, variable step size backward differentiation formulas (BDF) of orders 1 to 5 for
+ * stiff problems. The state after a step of order k solves
+ *
+ *      sum_j alpha_j y_(n+1-j) = h f(y_(n+1))
+ *
+ * with alpha the derivative weights of the polynomial through the new and the last k states. The equation is solved with a
+ * simplified Newton method starting from the extrapolation of the last k+1 states, whose difference to the solution
+ * estimates the error. As for the Adams methods the order is adapted after every step.
+ *
+ * The simplified Newton method keeps the Jacobian and the LU factorization of alpha/h I - J over its iterations and over
+ * the steps. The matrix is factorized again only if alpha/h changed by more than 30% (a new step size or order) or the
+ * iteration converged slowly, the Jacobian is evaluated again only after the iteration failed to converge.
+ *
+ * The starting values are computed with the Radau IIA method of order 5. Like for the implicit Runge-Kutta methods y must
+ * be of type Eigen::VectorXd.
+ *
+ * The Instrumentation policy decides whether statistics are collected, see ExplicitRungeKuttaIntegrator.
+ *
+ */
+template <class Step, class Instrumentation = NoInstrumentation> class BDFIntegrator {
+
+    public:
+        /**
+         * Constructor for the BDFIntegrator
+         *
+         * @param rtol the relative tolerance of a step
+         * @param atol the absolute tolerance of a step
+         * @param maxOrder the highest order, at most 5
+         * @param maxStep the largest step size the integrator may use
+         */
+        BDFIntegrator(double rtol = 1e-6, double atol = 1e-9, unsigned int maxOrder = 5, double maxStep = std::numeric_limits<double>::infinity())
+            : rtol(rtol), atol(atol), maxOrder(maxOrder), maxStep(maxStep){
+            if(maxOrder < 1 || maxOrder > 5){
+                throw "The order of the BDF method must be between 1 and 5";
+            }
+        }
+
+        /**
+         * Integrates over [0, time] with variable order and step size and hands the state after every step to the output
+         *
+         * @param f the function we are integrating over
+         * @param J the Jacobian of f
+         * @param time the time interval we want to integrate over
+         * @param y0 the initial state of the system
+         * @param output receives y0 and the state after every step, see rk_trajectory.hpp for the interface of an output
+         *
+         * @exception if the step size becomes too small an error will be thrown
+         */
+        template<typename Function, typename Jacobian, typename Output>
+        void solve(Function &&f, Jacobian &&J, double time, const Step &y0, Output &output){
+
+            instrumentation.reset();
+
+            output.initialize(y0.size(), 0);
+            output.push(0.0, y0);
+
+            if(time > 0){
+                integrate(f, J, time, y0, output);
+            }
+
+            output.finalize();
+
+        }
+
+        /**
+         * @return the statistics of the last solve (all zero unless the integrator uses StatisticsInstrumentation)
+         */
+        SolverStatistics statistics() const {
+            return instrumentation.statistics();
+        }
+
+        /**
+         * @return the instrumentation policy, for the data of a policy which goes beyond SolverStatistics
+         */
+        const Instrumentation &instrumentationPolicy() const {
+            return instrumentation;
+        }
+
+    private:
+        template<typename Function, typename Jacobian, typename Output>
+        void integrate(Function &&f, Jacobian &&J, double time, const Step &y0, Output &output){
+
+            auto evaluate = [&] (const Step &argument, Step &result) {
+                auto timer = instrumentation.time(Phase::Rhs);
+                result = f(argument);
+                instrumentation.count(Event::RhsEvaluation);
+            };
+
+            unsigned int order = std::min(2u, maxOrder);
+
+            history.prepare(maxOrder + 2, y0);
+            predicted = y0;
+
+            history.shift(0.0);
+            history.state(0) = y0;
+            double h;
+            {
+                auto timer = instrumentation.time(Phase::Step);
+                Step f0, difference;
+                evaluate(y0, f0);
+                h = StepSizeControl::initialStep(evaluate, y0, f0, time, order, rtol, atol, maxStep, predicted, difference);
+                h = std::min(h, time/(order + 1));
+            }
+
+            // the starting values (the predictor of order k needs k+1 states), order steps of the Radau IIA method of order 5
+            {
+                auto timer = instrumentation.time(Phase::Step);
+                ImplicitRungeKuttaIntegrator<Step> startup(ImplicitRKTableaus::radauRKSSM5());
+                std::vector<Step> start = startup.solve([&] (const Step &y) {
+                    Step result;
+                    evaluate(y, result);
+                    return result;
+                }, [&] (const Step &y) {
+                    auto rhsTimer = instrumentation.time(Phase::Rhs);
+                    instrumentation.count(Event::JacobianEvaluation);
+                    return J(y);
+                }, order*h, y0, order);
+
+                for(unsigned int i = 1; i <= order; i++){
+                    history.shift(i*h);
+                    history.state(0) = start[i];
+                    instrumentation.count(Event::AcceptedStep);
+                    auto outputTimer = instrumentation.time(Phase::Output);
+                    output.push(i*h, history.state(0));
+                }
+            }
+
+            double t = order*h;
+            unsigned int stepsAtOrder = 0;
+            unsigned int rejections = 0;
+
+            // the matrix of the simplified Newton method, it is factorized on the first step
+            jacobian.resize(y0.size(), y0.size());
+            updateJacobian(J, history.state(0));
+            factorizedGamma = 0;
+            correction = y0;
+            residual = y0;
+
+            while(t < time){
+                bool last = t + h >= time;
+                if(last){
+                    h = time - t;
+                }
+
+                double error;
+                bool converged = true;
+                {
+                    auto timer = instrumentation.time(Phase::Step);
+                    history.nodes(h, std::min(history.size(), order + 2), nodes, 1);
+                    nodes[0] = 1;
+
+                    // the new state is predicted by extrapolating the last order+1 states
+                    unsigned int predictorNodes = std::min(history.size(), order + 1);
+                    predict(predictorNodes);
+
+                    // the BDF formula over the new time point and the last order states
+                    MultistepCoefficients::differentiationWeights(nodes, order + 1, 0, weights);
+                    rest = weights[1]*history.state(0);
+                    for(unsigned int j = 1; j < order; j++){
+                        rest += weights[j + 1]*history.state(j);
+                    }
+                    const double alpha = weights[0];
+
+                    converged = correct(f, J, h, alpha);
+                    error = converged ? errorNorm(predictorNodes) : std::numeric_limits<double>::infinity();
+                }
+
+                if(error <= 1){
+                    instrumentation.count(Event::AcceptedStep);
+                    stepsAtOrder++;
+                    rejections = 0;
+
+                    // the errors of the neighbouring orders, estimated with their predictors
+                    double factor = stepFactor(error, order);
+                    unsigned int nextOrder = order;
+                    if(order > 1){
+                        predict(order);
+                        double lower = stepFactor(errorNorm(order), order - 1);
+                        if(lower > factor){
+                            factor = lower;
+                            nextOrder = order - 1;
+                        }
+                    }
+                    if(nextOrder == order && order < maxOrder && stepsAtOrder > order && history.size() > order + 1){
+                        predict(order + 2);
+                        double higher = stepFactor(errorNorm(order + 2), order + 1);
+                        if(higher > factor){
+                            factor = higher;
+                            nextOrder = order + 1;
+                        }
+                    }
+
+                    t = last ? time : t + h;
+                    history.shift(t);
+                    std::swap(history.state(0), corrected);
+                    jacobianCurrent = false;
+
+                    {
+                        auto timer = instrumentation.time(Phase::Output);
+                        output.push(t, history.state(0));
+                    }
+
+                    if(nextOrder != order){
+                        order = nextOrder;
+                        stepsAtOrder = 0;
+                    }
+                    h = std::min(h*factor, maxStep);
+                }else{
+                    instrumentation.count(Event::RejectedStep);
+                    h *= converged ? stepFactor(error, order) : 0.25;
+                    if(++rejections >= 2 && order > 1){
+                        order--;
+                        stepsAtOrder = 0;
+                    }
+                }
+
+                if(t < time && StepSizeControl::tooSmall(h, t)){
+                    throw "Step size too small";
+                }
+            }
+
+        }
+
+        /**
+         * Solves the BDF equation alpha y + rest = h f(y) for corrected with the simplified Newton method, starting from
+         * predicted. If the iteration does not converge with an old Jacobian, the Jacobian is evaluated again and the
+         * iteration is repeated.
+         *
+         * @return true if the iteration converged
+         */
+        template<typename Function, typename Jacobian>
+        bool correct(Function &&f, Jacobian &&J, const double h, const double alpha){
+
+            const double gamma = alpha/h;
+            while(true){
+                if(factorizedGamma == 0 || std::abs(gamma/factorizedGamma - 1) > maxGammaChange){
+                    factorize(gamma);
+                }
+                if(iterate(f, h, alpha)){
+                    return true;
+                }
+                if(jacobianCurrent){
+                    return false;
+                }
+                updateJacobian(J, predicted);
+                factorize(gamma);
+            }
+        }
+
+        /**
+         * The simplified Newton iteration with the factorization of factorizedGamma I - J. It stops once the estimated
+         * distance to the solution, rate/(1 - rate) times the last correction, is below a hundredth of the tolerance.
+         *
+         * @return true if the iteration converged
+         */
+        template<typename Function>
+        bool iterate(Function &&f, const double h, const double alpha){
+
+            corrected = predicted;
+            double previous = 0;
+            for(unsigned int i = 0; i < maxIterations; i++){
+                {
+                    auto timer = instrumentation.time(Phase::Rhs);
+                    residual = f(corrected);
+                    instrumentation.count(Event::RhsEvaluation);
+                }
+                instrumentation.count(Event::NewtonIteration);
+                {
+                    auto timer = instrumentation.time(Phase::LinearAlgebra);
+                    // (alpha I - h J) correction = h f(y) - alpha y - rest, divided by h
+                    residual -= (alpha*corrected + rest)/h;
+                    correction = lu.solve(residual);
+                    instrumentation.count(Event::LinearSolve);
+                }
+                corrected += correction;
+
+                const double norm = StepSizeControl::errorNorm(correction, history.state(0), corrected, rtol, atol);
+                if(norm == 0){
+                    return true;
+                }
+                if(i > 0){
+                    const double rate = norm/previous;
+                    if(rate >= 1){
+                        return false;
+                    }
+                    if(rate/(1 - rate)*norm <= newtonTolerance){
+                        // a slow iteration is a sign of an outdated factorization
+                        if(rate > slowRate){
+                            factorizedGamma = 0;
+                        }
+                        return true;
+                    }
+                }
+                previous = norm;
+            }
+            return false;
+        }
+
+        /**
+         * Factorizes gamma I - J with the current Jacobian
+         */
+        void factorize(const double gamma){
+            auto timer = instrumentation.time(Phase::LinearAlgebra);
+            W = -jacobian;
+            W.diagonal().array() += gamma;
+            lu.compute(W);
+            factorizedGamma = gamma;
+            instrumentation.count(Event::LuFactorization);
+        }
+
+        template<typename Jacobian>
+        void updateJacobian(Jacobian &&J, const Step &y){
+            auto timer = instrumentation.time(Phase::Rhs);
+            jacobian = J(y);
+            jacobianCurrent = true;
+            instrumentation.count(Event::JacobianEvaluation);
+        }
+
+        /**
+         * Extrapolates the last count states to the new time point in predicted, nodes[1..] hold the past time points
+         */
+        void predict(unsigned int count){
+            auto timer = instrumentation.time(Phase::Stages);
+            MultistepCoefficients::Nodes past;
+            std::copy(nodes.begin() + 1, nodes.begin() + 1 + count, past.begin());
+            MultistepCoefficients::lagrangeValues(past, count, 1.0, weights);
+            predicted = weights[0]*history.state(0);
+            for(unsigned int j = 1; j < count; j++){
+                predicted += weights[j]*history.state(j);
+            }
+        }
+
+        /**
+         * @return the error of corrected estimated with a predictor through count states: h / (t_(n+1) - t_(n+1-count)) times
+         * the difference to the predictor
+         */
+        double errorNorm(unsigned int count) const {
+            return StepSizeControl::errorNorm(corrected - predicted, history.state(0), corrected, rtol, atol) / (1 - nodes[count]);
+        }
+
+        /**
+         * @return the factor of the step size for which a method of the given order would have an error of about 1
+         */
+        double stepFactor(double error, unsigned int order) const {
+            return StepSizeControl::factor(error, order, false, maxFactor);
+        }
+
+
+        double rtol;
+        double atol;
+        unsigned int maxOrder;
+        double maxStep;
+        Instrumentation instrumentation;
+
+        // multistep methods do not like large changes of the step size
+        static constexpr double maxFactor = 2;
+        // the simplified Newton method: the largest relative change of alpha/h before the matrix is factorized again, the
+        // number of iterations, the tolerance relative to the one of a step and the rate above which the iteration is slow
+        static constexpr double maxGammaChange = 0.3;
+        static constexpr unsigned int maxIterations = 7;
+        static constexpr double newtonTolerance = 1e-2;
+        static constexpr double slowRate = 0.5;
+
+        // workspace
+        MultistepHistory<Step> history;
+        MultistepCoefficients::Nodes nodes;
+        MultistepCoefficients::Nodes weights;
+        Step predicted;
+        Step corrected;
+        Step rest;
+        Step correction;
+        Step residual;
+
+        // the simplified Newton method: the Jacobian, whether it belongs to the last state, and the LU factorization of
+        // W = factorizedGamma I - J (factorizedGamma = 0 if W has to be factorized)
+        Eigen::MatrixXd jacobian;
+        bool jacobianCurrent = false;
+        double factorizedGamma = 0;
+        Eigen::MatrixXd W;
+        Eigen::PartialPivLU<Eigen::MatrixXd> lu;
+};
+
+
+
+
+#endif
@@ -0,0 +1,168 @@
+#ifndef RKNPYWRITER
+
+#define RKNPYWRITER
+
+#include <Eigen/Dense>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+
+
+
+// helpers for the NumPy .npy file format (version 1.0), see https://numpy.org/doc/stable/reference/generated/numpy.lib.format.html
+namespace Npy{
+
+    // we always reserve this many bytes for the header such that it can be rewritten once the number of rows is known
+    const std::size_t headerSize = 128;
+
+    /**
+     * Creates the header of a .npy file holding a C-ordered (row-major) matrix of doubles
+     *
+     * @param rows the number of rows of the stored matrix
+     * @param cols the number of columns of the stored matrix
+     *
+     * @return the header, exactly headerSize bytes long
+     */
+    inline std::string header(std::uint64_t rows, std::uint64_t cols){
+
+        const std::uint16_t probe = 1;
+        const bool littleEndian = *reinterpret_cast<const unsigned char*>(&probe) == 1;
+
+        std::string dictionary = std::string("{'descr': '") + (littleEndian ? "<" : ">") + "f8', 'fortran_order': False, 'shape': ("
+            + std::to_string(rows) + ", " + std::to_string(cols) + "), }";
+
+        // magic string, version, header length, dictionary padded with spaces and terminated by a newline
+        std::uint16_t length = headerSize - 10;
+        std::string result("\x93NUMPY\x01\x00", 8);
+        result += static_cast<char>(length & 0xff);
+        result += static_cast<char>(length >> 8);
+        result += dictionary;
+        result.append(headerSize - 1 - result.size(), ' ');
+        result += '\n';
+
+        return result;
+    }
+}
+
+
+
+
+/**
+ *
+ * An output writing every state directly to a NumPy .npy file while the integration runs, memory usage is independent of the
+ * number of steps. The file holds a (states x columns) matrix of doubles, one row per state. If times are written the first
+ * column holds the time of the state.
+ *
+ * The shape in the header is only known at the end, finalize (or the destructor) writes it. The result can be loaded without
+ * copying with np.load(filename, mmap_mode='r').
+ *
+ */
+class NpyWriter {
+
+    public:
+        /**
+         * Constructor for the NpyWriter
+         *
+         * @param filename the file to write to, an existing file is overwritten
+         * @param writeTimes if true the first column of every row is the time of the state
+         *
+         * @exception if the file can not be opened an error will be thrown
+         */
+        NpyWriter(const std::string &filename, bool writeTimes = true) : filename(filename), writeTimes(writeTimes), columns(0), rows(0){
+            open();
+        }
+
+        NpyWriter(const NpyWriter &) = delete;
+        NpyWriter &operator=(const NpyWriter &) = delete;
+
+        ~NpyWriter(){
+            if(file != nullptr){
+                // destructors must not throw, call finalize yourself to be notified about write errors
+                try {
+                    finalize();
+                } catch(...) {
+                }
+            }
+        }
+
+        /**
+         * Starts a new matrix, after finalize (e.g. for a second solve) the file is opened again and overwritten
+         *
+         * @exception if the file can not be opened or written an error will be thrown
+         */
+        void initialize(unsigned int dimension, unsigned int){
+            if(file == nullptr){
+                open();
+            }
+            columns = dimension + (writeTimes ? 1 : 0);
+            rows = 0;
+            // a placeholder, the real shape is written in finalize
+            if(!writeHeader()){
+                throw "Could not write file";
+            }
+        }
+
+        /**
+         * Appends a state as a row of the matrix
+         *
+         * @exception if the writer has been finalized or the state can not be written an error will be thrown
+         */
+        template<typename State>
+        void push(double t, const State &y){
+            if(file == nullptr){
+                throw "The file has already been finalized";
+            }
+            if((writeTimes && std::fwrite(&t, sizeof(double), 1, file) != 1)
+               || std::fwrite(y.data(), sizeof(double), y.size(), file) != static_cast<std::size_t>(y.size())){
+                throw "Could not write file";
+            }
+            rows++;
+        }
+
+        /**
+         * Writes the final header and closes the file, no state can be pushed afterwards
+         *
+         * @exception if not all data could be written an error will be thrown
+         */
+        void finalize(){
+            if(file == nullptr){
+                return;
+            }
+            bool failed = !writeHeader();
+            failed |= std::ferror(file) != 0;
+            failed |= std::fclose(file) != 0;
+            file = nullptr;
+            if(failed){
+                throw "Could not write file";
+            }
+        }
+
+    private:
+        void open(){
+            file = std::fopen(filename.c_str(), "wb");
+            if(file == nullptr){
+                throw "Could not open file";
+            }
+        }
+
+        /**
+         * @return false if the header could not be written
+         */
+        bool writeHeader(){
+            std::string header = Npy::header(rows, columns);
+            return std::fseek(file, 0, SEEK_SET) == 0 && std::fwrite(header.data(), 1, header.size(), file) == header.size()
+                   && std::fseek(file, 0, SEEK_END) == 0;
+        }
+
+        std::string filename;
+        std::FILE *file;
+        bool writeTimes;
+        std::uint64_t columns;
+        std::uint64_t rows;
+};
+
+
+
+
+#endif
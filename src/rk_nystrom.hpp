@@ -0,0 +1,448 @@
+#ifndef RKNYSTROM
+
+#define RKNYSTROM
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "rk_adaptive.hpp"
+#include "rk_implementer.hpp"
+#include "rk_statistics.hpp"
+
+
+
+
+/**
+ *
+ * The tableau of a Runge Kutta Nystroem method for second order systems y'' = g(y). With the position q and the velocity v
+ * a step computes the stages g_i = g(Q_i) at the positions
+ *
+ *      Q_i = q0 + c(i) h v0 + h^2 sum_j Abar(i,j) g_j
+ *
+ * and propagates q1 = q0 + h v0 + h^2 sum_i bbar(i) g_i and v1 = v0 + h sum_i b(i) g_i. Since g does not depend on v the
+ * stages only store n instead of 2n values, and fewer stages are needed for the same order than for the first order system.
+ *
+ * An embedded pair additionally has error weights: the error estimate of a step is h^2 sum_i ebar(i) g_i for the position
+ * and h sum_i e(i) g_i for the velocity.
+ *
+ */
+struct RungeKuttaNystromTableau {
+    std::string name;
+    // the s x s coefficients matrix, strictly lower triangular
+    Eigen::MatrixXd Abar;
+    // the weights of the position
+    Eigen::VectorXd bbar;
+    // the weights of the velocity
+    Eigen::VectorXd b;
+    // the nodes
+    Eigen::VectorXd c;
+    // the order of the propagated solution
+    unsigned int order;
+    // the error weights of the position and the velocity, empty for methods without error estimate
+    Eigen::VectorXd ebar;
+    Eigen::VectorXd e;
+    // a second error estimate which is combined with the first one as in DOP853, empty for all other methods
+    Eigen::VectorXd ebar2;
+    Eigen::VectorXd e2;
+    // the error estimate behaves like h^(estimatorOrder + 1), it determines how the step size is adapted
+    unsigned int estimatorOrder;
+
+    /**
+     * Creates the Nystroem form of an explicit Runge Kutta method, which computes exactly the same steps as the method
+     * applied to the first order system (q, v)' = (v, g(q)), with n instead of 2n values per stage.
+     */
+    static RungeKuttaNystromTableau fromRungeKutta(const ButcherTableau &tableau){
+        return {tableau.name, tableau.A*tableau.A, tableau.A.transpose()*tableau.b, tableau.b, tableau.A.rowwise().sum(), tableau.order,
+                Eigen::VectorXd(), Eigen::VectorXd(), Eigen::VectorXd(), Eigen::VectorXd(), tableau.order};
+    }
+
+    /**
+     * Creates the Nystroem form of an embedded Runge Kutta pair including its error estimate. The evaluation at the end of
+     * the step becomes the last stage, it is at q1 and therefore reused as the first stage of the next step.
+     */
+    static RungeKuttaNystromTableau fromEmbedded(const EmbeddedButcherTableau &tableau){
+        const unsigned int s = tableau.A.rows();
+        Eigen::MatrixXd A = Eigen::MatrixXd::Zero(s + 1, s + 1);
+        A.topLeftCorner(s, s) = tableau.A;
+        A.row(s).head(s) = tableau.b.transpose();
+        Eigen::VectorXd b = Eigen::VectorXd::Zero(s + 1);
+        b.head(s) = tableau.b;
+
+        // the error weights sum up to 0, hence the error estimate of the position does not depend on v0
+        RungeKuttaNystromTableau nystrom = {tableau.name, A*A, A.transpose()*b, b, A.rowwise().sum(), tableau.order,
+                                            A.transpose()*tableau.e, tableau.e, Eigen::VectorXd(), Eigen::VectorXd(), tableau.estimatorOrder};
+        if(tableau.e2.size() != 0){
+            nystrom.ebar2 = A.transpose()*tableau.e2;
+            nystrom.e2 = tableau.e2;
+        }
+        return nystrom;
+    }
+};
+
+
+
+
+/**
+ *
+ * Implementation of explicit Runge Kutta Nystroem methods for second order systems y'' = g(y), which work directly on the
+ * positions q and the velocities v. Either with a fixed number of steps (solve) or, for tableaus with an error estimate, with
+ * an adaptive step size controlled like in AdaptiveRungeKuttaIntegrator (solveAdaptive).
+ *
+ * The states handed to the outputs are the positions followed by the velocities. If the first stage of a method is at q0 and
+ * the last one at q1 the last evaluation of g is reused in the next step. Like ExplicitRungeKuttaIntegrator a step does not
+ * allocate memory apart from what g allocates for its result.
+ *
+ * The Instrumentation policy decides whether statistics are collected, see ExplicitRungeKuttaIntegrator.
+ *
+ */
+template <class Step, class Instrumentation = NoInstrumentation> class RungeKuttaNystromIntegrator {
+
+    public:
+        // the positions followed by the velocities, the states handed to the outputs
+        using State = Eigen::Matrix<typename Step::Scalar, Step::RowsAtCompileTime == Eigen::Dynamic ? Eigen::Dynamic : 2*Step::RowsAtCompileTime, 1>;
+
+        /**
+         * Constructor for the RungeKuttaNystromIntegrator
+         *
+         * @param tableau the Runge Kutta Nystroem scheme, e.g. one of RKNTableaus
+         * @param rtol the relative tolerance of a step, only used by the adaptive solve
+         * @param atol the absolute tolerance of a step, only used by the adaptive solve
+         * @param maxStep the largest step size of the adaptive solve
+         */
+        RungeKuttaNystromIntegrator(const RungeKuttaNystromTableau &tableau, double rtol = 1e-6, double atol = 1e-9, double maxStep = std::numeric_limits<double>::infinity())
+            : tableau(tableau), size(tableau.Abar.cols()), rtol(rtol), atol(atol), maxStep(maxStep){
+            // up to rounding, e.g. in the tableaus created with fromEmbedded
+            firstSameAsLast = tableau.c(0) == 0 && !tableau.Abar.row(0).any() && std::abs(tableau.c(size - 1) - 1) < 1e-14
+                              && (tableau.Abar.row(size - 1) - tableau.bbar.transpose()).cwiseAbs().maxCoeff() < 1e-14;
+        }
+
+        /**
+         * The solve methods applies a Runge Kutta Nystroem method with a fixed step size
+         *
+         * @param g the acceleration as a function of the positions
+         * @param time the time interval we want to integrate over
+         * @param q0 the initial positions
+         * @param v0 the initial velocities
+         * @param steps the number of integration steps we would like to make
+         *
+         * @return a std::vector of states (positions followed by velocities), one for every integration step performed. The
+         * first step will be the supplied initial state.
+         */
+        template<typename Function>
+        std::vector<State> solve(Function &&g, double time, const Step &q0, const Step &v0, unsigned int steps){
+
+            std::vector<State> stepsVector;
+            stepsVector.reserve(steps + 1);
+
+            integrate(g, time, q0, v0, steps, [&stepsVector] (double, const State &state) {
+                stepsVector.push_back(state);
+            });
+
+            return stepsVector;
+
+        }
+
+        /**
+         * The solve methods applies a Runge Kutta Nystroem method with a fixed step size and hands every state (positions
+         * followed by velocities) to an output instead of returning them
+         *
+         * @param output receives all steps+1 states, see rk_trajectory.hpp for the interface of an output
+         */
+        template<typename Function, typename Output>
+        void solve(Function &&g, double time, const Step &q0, const Step &v0, unsigned int steps, Output &output){
+
+            output.initialize(2*q0.size(), steps + 1);
+            integrate(g, time, q0, v0, steps, [&output] (double t, const State &state) {
+                output.push(t, state);
+            });
+            output.finalize();
+
+        }
+
+        /**
+         * Integrates over [0, time] with adaptive step size and hands the state after every accepted step to the output
+         *
+         * @param g the acceleration as a function of the positions
+         * @param time the time interval we want to integrate over
+         * @param q0 the initial positions
+         * @param v0 the initial velocities
+         * @param output receives the initial state and the state after every accepted step
+         *
+         * @exception if the tableau has no error estimate or the step size becomes too small an error will be thrown
+         */
+        template<typename Function, typename Output>
+        void solveAdaptive(Function &&g, double time, const Step &q0, const Step &v0, Output &output){
+
+            if(tableau.e.size() == 0){
+                throw "The tableau has no error estimate";
+            }
+
+            instrumentation.reset();
+            prepare(q0);
+            q = q0;
+            v = v0;
+
+            output.initialize(2*q0.size(), 0);
+            push(0.0, output);
+
+            if(time > 0){
+                integrateAdaptive(g, time, output);
+            }
+
+            output.finalize();
+
+        }
+
+        /**
+         * @return the statistics of the last solve (all zero unless the integrator uses StatisticsInstrumentation)
+         */
+        SolverStatistics statistics() const {
+            return instrumentation.statistics();
+        }
+
+        /**
+         * @return the instrumentation policy, for the data of a policy which goes beyond SolverStatistics
+         */
+        const Instrumentation &instrumentationPolicy() const {
+            return instrumentation;
+        }
+
+    private:
+        template<typename Function, typename Push>
+        void integrate(Function &&g, double time, const Step &q0, const Step &v0, unsigned int steps, Push &&push){
+
+            instrumentation.reset();
+            prepare(q0);
+            q = q0;
+            v = v0;
+            double h = time / steps;
+
+            const unsigned int n = q.size();
+            state.head(n) = q;
+            state.tail(n) = v;
+            push(0.0, state);
+
+            for(unsigned int i = 0; i < steps; i++){
+                iteration(g, h);
+                std::swap(q, q1);
+                std::swap(v, v1);
+                instrumentation.count(Event::AcceptedStep);
+                if(firstSameAsLast){
+                    std::swap(stages[0], stages[size - 1]);
+                }
+
+                auto timer = instrumentation.time(Phase::Output);
+                state.head(n) = q;
+                state.tail(n) = v;
+                push((i + 1)*h, state);
+            }
+
+        }
+
+        template<typename Function, typename Output>
+        void integrateAdaptive(Function &&g, double time, Output &output){
+
+            double t = 0;
+            double h;
+            {
+                auto timer = instrumentation.time(Phase::Step);
+                h = initialStep(g, time);
+                // the first stage is g(q0)
+                if(firstSameAsLast){
+                    stages[0] = stateDerivative.tail(q.size());
+                    firstStageValid = true;
+                }
+            }
+            bool rejected = false;
+
+            while(t < time){
+                // the last step ends exactly at time
+                bool last = t + h >= time;
+                if(last){
+                    h = time - t;
+                }
+
+                iteration(g, h);
+                double error = errorNorm(h);
+
+                if(error <= 1){
+                    instrumentation.count(Event::AcceptedStep);
+                    t = last ? time : t + h;
+                    std::swap(q, q1);
+                    std::swap(v, v1);
+                    if(firstSameAsLast){
+                        std::swap(stages[0], stages[size - 1]);
+                    }
+                    push(t, output);
+
+                    h = std::min(h*StepSizeControl::factor(error, tableau.estimatorOrder, rejected), maxStep);
+                    rejected = false;
+                }else{
+                    instrumentation.count(Event::RejectedStep);
+                    h *= StepSizeControl::factor(error, tableau.estimatorOrder);
+                    rejected = true;
+                }
+
+                if(t < time && StepSizeControl::tooSmall(h, t)){
+                    throw "Step size too small";
+                }
+            }
+
+        }
+
+        /**
+         * Sizes the workspace for states like q0, this is the only place where the integrator itself allocates memory
+         */
+        void prepare(const Step &q0){
+            stages.assign(size, q0);
+            stage = q0;
+            q1 = q0;
+            v1 = q0;
+            state.resize(2*q0.size());
+            stateDerivative.resize(2*q0.size());
+            stateStage.resize(2*q0.size());
+            stateDifference.resize(2*q0.size());
+            firstStageValid = false;
+        }
+
+        template<typename Function>
+        void evaluate(Function &&g, const Step &argument, Step &result){
+            auto timer = instrumentation.time(Phase::Rhs);
+            result = g(argument);
+            instrumentation.count(Event::RhsEvaluation);
+        }
+
+        /**
+         * Computes a step of size h from q and v in q1 and v1, the first stage is reused if it is known from the previous step
+         */
+        template<typename Function>
+        void iteration(Function &&g, const double h){
+
+            auto stepTimer = instrumentation.time(Phase::Step);
+
+            for(unsigned int i = 0; i < size; i++){
+                if(i == 0 && firstSameAsLast && firstStageValid){
+                    continue;
+                }
+                {
+                    auto timer = instrumentation.time(Phase::Stages);
+                    stage = q;
+                    if(tableau.c(i) != 0){
+                        stage += h*tableau.c(i) * v;
+                    }
+                    for(unsigned int j = 0; j < i; j++){
+                        if(tableau.Abar(i,j) != 0){
+                            stage += h*h*tableau.Abar(i,j) * stages[j];
+                        }
+                    }
+                }
+                evaluate(g, stage, stages[i]);
+            }
+            firstStageValid = true;
+
+            auto timer = instrumentation.time(Phase::Stages);
+            q1 = q + h*v;
+            v1 = v;
+            for(unsigned int i = 0; i < size; i++){
+                if(tableau.bbar(i) != 0){
+                    q1 += h*h*tableau.bbar(i) * stages[i];
+                }
+                if(tableau.b(i) != 0){
+                    v1 += h*tableau.b(i) * stages[i];
+                }
+            }
+
+        }
+
+        /**
+         * @return the scaled RMS norm of the error estimate of the last step over the positions and velocities
+         */
+        double errorNorm(const double h){
+
+            auto timer = instrumentation.time(Phase::Stages);
+
+            // stage is free at this point and holds the error estimates
+            auto estimate = [&] (const Eigen::VectorXd &weights, double scale, const Step &y, const Step &y1) {
+                stage.setZero();
+                for(unsigned int i = 0; i < size; i++){
+                    if(weights(i) != 0){
+                        stage += weights(i) * stages[i];
+                    }
+                }
+                return scale*scale*(stage.array() / (atol + rtol*y.array().abs().max(y1.array().abs()))).matrix().squaredNorm();
+            };
+
+            const double n = 2*q.size();
+            double error = estimate(tableau.ebar, h*h, q, q1) + estimate(tableau.e, h, v, v1);
+            if(tableau.e2.size() == 0){
+                return std::sqrt(error/n);
+            }
+
+            // DOP853: the estimate of order 5 is corrected with the one of order 3, see AdaptiveRungeKuttaIntegrator
+            double error2 = estimate(tableau.ebar2, h*h, q, q1) + estimate(tableau.e2, h, v, v1);
+            if(error == 0 && error2 == 0){
+                return 0;
+            }
+            return error/std::sqrt((error + 0.01*error2)*n);
+        }
+
+        /**
+         * @return the first step size, chosen for the equivalent first order system
+         */
+        template<typename Function>
+        double initialStep(Function &&g, double time){
+            const unsigned int n = q.size();
+            auto evaluateFirstOrder = [&] (const State &y, State &result) {
+                stage = y.head(n);
+                result.head(n) = y.tail(n);
+                evaluate(g, stage, q1);
+                result.tail(n) = q1;
+            };
+            state.head(n) = q;
+            state.tail(n) = v;
+            evaluateFirstOrder(state, stateDerivative);
+            return StepSizeControl::initialStep(evaluateFirstOrder, state, stateDerivative, time, std::min(tableau.order, tableau.estimatorOrder),
+                                                rtol, atol, maxStep, stateStage, stateDifference);
+        }
+
+        template<typename Output>
+        void push(double t, Output &output){
+            auto timer = instrumentation.time(Phase::Output);
+            const unsigned int n = q.size();
+            state.head(n) = q;
+            state.tail(n) = v;
+            output.push(t, state);
+        }
+
+
+        const RungeKuttaNystromTableau tableau;
+        unsigned int size;
+        double rtol;
+        double atol;
+        double maxStep;
+        bool firstSameAsLast;
+        Instrumentation instrumentation;
+
+        // workspace: the stages g_i, the argument of g for the current one, the state before and after the step
+        std::vector<Step> stages;
+        Step stage;
+        Step q;
+        Step v;
+        Step q1;
+        Step v1;
+        bool firstStageValid;
+        // the state as first order system, for the output and the initial step size
+        State state;
+        State stateDerivative;
+        State stateStage;
+        State stateDifference;
+};
+
+
+
+
+#endif
@@ -0,0 +1,264 @@
+#ifndef RKPARAREAL
+
+#define RKPARAREAL
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <thread>
+#include <vector>
+
+#include "rk_adaptive.hpp"
+#include "rk_implementer.hpp"
+#include "rk_statistics.hpp"
+#include "rk_trajectory.hpp"
+
+
+
+
+/**
+ *
+ * Implementation of the Parareal algorithm (Lions, Maday, Turinici, 2001), which parallelizes an integration over time. The
+ * interval is split into slices, a cheap coarse propagator G integrates over all slices sequentially and an expensive fine
+ * propagator F integrates every slice in parallel. The states U_n at the beginning of the slices are corrected with
+ *
+ *      U_{n+1} = G(U_n) + F(U_n^old) - G(U_n^old)
+ *
+ * until they change by less than the tolerance. After k iterations the first k slices agree with the sequential fine
+ * solution, hence the iteration ends after at most as many iterations as there are slices. It only pays off if it converges
+ * in far fewer iterations than there are threads.
+ *
+ * Both propagators are ExplicitRungeKuttaIntegrators with a fixed number of steps per slice, e.g. one of ExplicitRKTableaus.
+ * The fine propagations of an iteration are distributed over the threads, every thread uses its own integrator. f is called
+ * from several threads at the same time and must not modify shared state. Needs to be linked with -pthread.
+ *
+ * The Instrumentation policy decides whether statistics are collected, see ExplicitRungeKuttaIntegrator. The evaluations of
+ * f are counted, their time is not measured.
+ *
+ */
+template <class Step, class Instrumentation = NoInstrumentation> class PararealIntegrator {
+
+    public:
+        /**
+         * Constructor for the PararealIntegrator
+         *
+         * @param coarse the butcher tableau of the coarse propagator, e.g. ExplicitRKTableaus::explicitEuler()
+         * @param coarseSteps the number of steps of the coarse propagator per slice
+         * @param fine the butcher tableau of the fine propagator, e.g. ExplicitRKTableaus::classical4thOrder()
+         * @param fineSteps the number of steps of the fine propagator per slice
+         * @param slices the number of time slices, usually a multiple of the number of threads
+         * @param rtol the iteration ends once no state at the beginning of a slice changes by more than rtol relative to its size
+         * @param atol ... or atol in absolute terms, like the tolerances of AdaptiveRungeKuttaIntegrator
+         * @param threads the number of threads computing the fine propagations (0 for the number of cores)
+         * @param maxIterations the largest number of iterations (0 for the number of slices, which gives the fine solution)
+         */
+        PararealIntegrator(const ButcherTableau &coarse, unsigned int coarseSteps, const ButcherTableau &fine, unsigned int fineSteps,
+                           unsigned int slices, double rtol = 1e-8, double atol = 1e-10, unsigned int threads = 0, unsigned int maxIterations = 0)
+            : coarseIntegrator(coarse), coarse(coarse), fine(fine), coarseSteps(coarseSteps), fineSteps(fineSteps), slices(slices), rtol(rtol), atol(atol),
+              threads(threads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : threads),
+              maxIterations(maxIterations == 0 ? slices : std::min(maxIterations, slices)){
+            if(slices == 0 || coarseSteps == 0 || fineSteps == 0){
+                throw "Parareal needs at least one slice and one coarse and fine step per slice";
+            }
+        }
+
+        /**
+         * Integrates over [0, time] and hands the states at the beginning of the slices and the final state to the output
+         *
+         * @param f the function we are integrating over, called from several threads at the same time
+         * @param time the time interval we want to integrate over
+         * @param y0 the initial state of the system
+         * @param output receives slices + 1 states, starting with y0, see rk_trajectory.hpp for the interface of an output
+         *
+         * @exception everything f throws on any of the threads
+         */
+        template<typename Function, typename Output>
+        void solve(Function &&f, double time, const Step &y0, Output &output){
+
+            auto start = std::chrono::steady_clock::now();
+            instrumentation.reset();
+            fineTime = 0;
+            finePropagations = 0;
+
+            const double slice = time/slices;
+            U.assign(slices + 1, y0);
+            G.assign(slices + 1, y0);
+            F.assign(slices + 1, y0);
+
+            // the coarse solution is the first iterate
+            for(unsigned int n = 0; n < slices; n++){
+                propagateCoarse(f, slice, U[n], G[n + 1]);
+                U[n + 1] = G[n + 1];
+            }
+
+            iterationCount = 0;
+            for(unsigned int k = 1; k <= maxIterations; k++){
+                iterationCount = k;
+
+                // slices before k - 1 have converged exactly
+                propagateFine(f, slice, k - 1);
+
+                // the sequential correction, U[k] is the fine propagation of the exact U[k - 1]
+                double change = 0;
+                U[k] = F[k];
+                for(unsigned int n = k; n < slices; n++){
+                    propagateCoarse(f, slice, U[n], coarseState);
+                    correction = coarseState + F[n + 1] - G[n + 1];
+                    change = std::max(change, StepSizeControl::errorNorm(correction - U[n + 1], U[n + 1], correction, rtol, atol));
+                    U[n + 1] = correction;
+                    G[n + 1] = coarseState;
+                }
+
+                if(change <= 1){
+                    break;
+                }
+            }
+
+            output.initialize(y0.size(), slices + 1);
+            {
+                auto timer = instrumentation.time(Phase::Output);
+                for(unsigned int n = 0; n <= slices; n++){
+                    output.push(n*slice, U[n]);
+                }
+            }
+            output.finalize();
+
+            wallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        }
+
+        /**
+         * @return the number of Parareal iterations of the last solve
+         */
+        unsigned int iterations() const {
+            return iterationCount;
+        }
+
+        /**
+         * @return the measured speedup of the last solve over the sequential fine propagation of all slices, whose time is
+         * estimated from the mean time of a fine propagation
+         */
+        double speedup() const {
+            if(finePropagations == 0 || wallTime == 0){
+                return 0;
+            }
+            return fineTime/finePropagations*slices/wallTime;
+        }
+
+        /**
+         * @return the speedup of the last solve divided by the number of threads, with as many threads as slices and a coarse
+         * propagator of negligible cost it is bounded by 1 / iterations
+         */
+        double parallelEfficiency() const {
+            return speedup()/std::min(threads, slices);
+        }
+
+        /**
+         * @return the statistics of the last solve (all zero unless the integrator uses StatisticsInstrumentation)
+         */
+        SolverStatistics statistics() const {
+            return instrumentation.statistics();
+        }
+
+        /**
+         * @return the instrumentation policy, for the data of a policy which goes beyond SolverStatistics
+         */
+        const Instrumentation &instrumentationPolicy() const {
+            return instrumentation;
+        }
+
+    private:
+        /**
+         * Integrates over one slice from y with the coarse propagator and stores the result in result
+         */
+        template<typename Function>
+        void propagateCoarse(Function &&f, const double slice, const Step &y, Step &result){
+            coarseIntegrator.solve(f, slice, y, coarseSteps, coarseFinal);
+            result = coarseFinal.value();
+            instrumentation.count(Event::RhsEvaluation, static_cast<unsigned long>(coarse.A.cols())*coarseSteps);
+        }
+
+        /**
+         * Computes F[n + 1], the fine propagation of U[n], for all slices n >= first on the threads
+         */
+        template<typename Function>
+        void propagateFine(Function &&f, const double slice, const unsigned int first){
+
+            const unsigned int count = slices - first;
+            const unsigned int workers = std::min(threads, count);
+            std::atomic<unsigned int> next(first);
+            std::vector<double> busy(workers, 0);
+            std::vector<std::exception_ptr> failures(workers);
+
+            auto work = [&] (unsigned int worker) {
+                try{
+                    ExplicitRungeKuttaIntegrator<Step> integrator(fine);
+                    FinalState final;
+                    for(unsigned int n = next++; n < slices; n = next++){
+                        auto start = std::chrono::steady_clock::now();
+                        integrator.solve(f, slice, U[n], fineSteps, final);
+                        F[n + 1] = final.value();
+                        busy[worker] += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                    }
+                }catch(...){
+                    failures[worker] = std::current_exception();
+                }
+            };
+
+            std::vector<std::thread> pool;
+            for(unsigned int worker = 1; worker < workers; worker++){
+                pool.emplace_back(work, worker);
+            }
+            work(0);
+            for(std::thread &thread : pool){
+                thread.join();
+            }
+
+            for(std::exception_ptr &failure : failures){
+                if(failure){
+                    std::rethrow_exception(failure);
+                }
+            }
+
+            for(double seconds : busy){
+                fineTime += seconds;
+            }
+            finePropagations += count;
+            instrumentation.count(Event::RhsEvaluation, static_cast<unsigned long>(fine.A.cols())*fineSteps*count);
+        }
+
+
+        ExplicitRungeKuttaIntegrator<Step> coarseIntegrator;
+        FinalState coarseFinal;
+        ButcherTableau coarse;
+        ButcherTableau fine;
+        unsigned int coarseSteps;
+        unsigned int fineSteps;
+        unsigned int slices;
+        double rtol;
+        double atol;
+        unsigned int threads;
+        unsigned int maxIterations;
+        Instrumentation instrumentation;
+
+        // the results of the last solve
+        unsigned int iterationCount = 0;
+        double wallTime = 0;
+        double fineTime = 0;
+        unsigned int finePropagations = 0;
+
+        // the states at the beginning of the slices, their last coarse and fine propagations (index n + 1 for slice n)
+        std::vector<Step> U;
+        std::vector<Step> G;
+        std::vector<Step> F;
+        Step coarseState;
+        Step correction;
+};
+
+
+
+
+#endif
@@ -0,0 +1,341 @@
+#ifndef RKPARTITIONED
+
+#define RKPARTITIONED
+
+#include <Eigen/Dense>
+#include <string>
+#include <vector>
+
+#include "rk_statistics.hpp"
+
+
+
+
+/**
+ *
+ * A partitioned Butcher tableau for separable systems q' = v(p), p' = F(q), e.g. Hamiltonian systems with H = T(p) + V(q).
+ * Every stage i has a momentum P_i and a position Q_i
+ *
+ *      P_i = p0 + h sum_j Ahat(i,j) F(Q_j)        q1 = q0 + h sum_i b(i) v(P_i)
+ *      Q_i = q0 + h sum_j A(i,j) v(P_j)           p1 = p0 + h sum_i bhat(i) F(Q_i)
+ *
+ * The method is explicit if Ahat is strictly lower triangular and A is lower triangular: then P_i only needs the forces of the
+ * previous stages and Q_i the velocities up to stage i. It is symplectic if b(i) Ahat(i,j) + bhat(j) A(j,i) = b(i) bhat(j).
+ *
+ */
+struct PartitionedButcherTableau {
+    std::string name;
+    Eigen::MatrixXd A;
+    Eigen::VectorXd b;
+    Eigen::MatrixXd Ahat;
+    Eigen::VectorXd bhat;
+    unsigned int order;
+
+    /**
+     * Creates the tableau of a splitting method which alternately moves the positions with the velocities (drift) and the
+     * momenta with the forces (kick): stage i first drifts by drift[i]*h and then kicks by kick[i]*h
+     *
+     * @param drift the drift coefficients, a leading drift of 0 starts the method with a kick
+     * @param kick the kick coefficients, a trailing kick of 0 ends the method with a drift
+     */
+    static PartitionedButcherTableau splitting(const std::string &name, const std::vector<double> &drift, const std::vector<double> &kick, unsigned int order){
+        if(drift.size() != kick.size()){
+            throw "A splitting method needs as many drift as kick coefficients";
+        }
+        unsigned int s = drift.size();
+        PartitionedButcherTableau tableau = {name, Eigen::MatrixXd::Zero(s, s), Eigen::VectorXd(s), Eigen::MatrixXd::Zero(s, s), Eigen::VectorXd(s), order};
+        for(unsigned int i = 0; i < s; i++){
+            // P_i is the momentum after the first i kicks, Q_i the position after the first i+1 drifts
+            for(unsigned int j = 0; j < i; j++){
+                tableau.Ahat(i,j) = kick[j];
+            }
+            for(unsigned int j = 0; j <= i; j++){
+                tableau.A(i,j) = drift[j];
+            }
+            tableau.b(i) = drift[i];
+            tableau.bhat(i) = kick[i];
+        }
+        return tableau;
+    }
+
+    /**
+     * Creates the tableau of the composition of velocity Verlet steps of sizes weights[0]*h, weights[1]*h, ... The kicks of
+     * neighbouring Verlet steps are merged, hence the composition costs one force evaluation per weight.
+     */
+    static PartitionedButcherTableau composition(const std::string &name, const std::vector<double> &weights, unsigned int order){
+        // velocity Verlet: kick by h/2, drift by h, kick by h/2
+        std::vector<double> drift = {0};
+        std::vector<double> kick = {weights[0]/2};
+        for(unsigned int i = 0; i < weights.size(); i++){
+            drift.push_back(weights[i]);
+            kick.push_back(i + 1 < weights.size() ? (weights[i] + weights[i + 1])/2 : weights[i]/2);
+        }
+        return splitting(name, drift, kick, order);
+    }
+};
+
+
+
+
+/**
+ *
+ * Implementation of explicit partitioned Runge Kutta methods for separable systems q' = v(p), p' = F(q) with the positions q and
+ * the momenta p as separate states. Since v and F are given as separate callbacks a stage costs at most one force evaluation,
+ * for splitting methods, where every stage differs from the previous one by a single drift and kick, the stages are computed
+ * with one vector update each. If the first stage of a method is at q0 and the last one at q1 (e.g. velocity Verlet), the force
+ * of the last stage is reused in the next step.
+ *
+ * Symplectic methods (see PartitionedButcherTableau) keep the energy of a Hamiltonian system bounded over long times, unlike
+ * the methods of ExplicitRungeKuttaIntegrator whose energy error drifts.
+ *
+ * Event::RhsEvaluation counts the evaluations of the force, the velocity (usually p divided by the mass) is assumed to be cheap.
+ * Like ExplicitRungeKuttaIntegrator a step does not allocate memory apart from what the callbacks allocate for their results.
+ *
+ * The Instrumentation policy decides whether statistics are collected, see ExplicitRungeKuttaIntegrator.
+ *
+ */
+template <class Step, class Instrumentation = NoInstrumentation> class PartitionedRungeKuttaIntegrator {
+
+    public:
+        // the positions followed by the momenta, the states handed to the outputs
+        using State = Eigen::Matrix<typename Step::Scalar, Step::RowsAtCompileTime == Eigen::Dynamic ? Eigen::Dynamic : 2*Step::RowsAtCompileTime, 1>;
+
+        /**
+         * Constructor for the PartitionedRungeKuttaIntegrator
+         *
+         * @param tableau the partitioned butcher scheme, e.g. one of SymplecticTableaus
+         *
+         * @exception if the tableau is not explicit an error will be thrown
+         */
+        PartitionedRungeKuttaIntegrator(const PartitionedButcherTableau &tableau) : A(tableau.A), b(tableau.b), Ahat(tableau.Ahat), bhat(tableau.bhat), size(tableau.A.cols()){
+            if(A.triangularView<Eigen::StrictlyUpper>().toDenseMatrix().any() || Ahat.triangularView<Eigen::Upper>().toDenseMatrix().any()){
+                throw "The partitioned tableau is not explicit";
+            }
+
+            // stage i is computed from stage i-1, the result of the step from the last stage
+            stageA = A;
+            stageAhat = Ahat;
+            for(unsigned int i = size - 1; i > 0; i--){
+                stageA.row(i) -= A.row(i - 1);
+                stageAhat.row(i) -= Ahat.row(i - 1);
+            }
+            finalB = b.transpose() - A.row(size - 1);
+            finalBhat = bhat.transpose() - Ahat.row(size - 1);
+
+            // a velocity or force which no stage and no result uses is not evaluated
+            velocityUsed.resize(size);
+            forceUsed.resize(size);
+            for(unsigned int j = 0; j < size; j++){
+                velocityUsed[j] = A.col(j).any() || b(j) != 0;
+                forceUsed[j] = Ahat.col(j).any() || bhat(j) != 0;
+            }
+
+            firstSameAsLast = !A.row(0).any() && A.row(size - 1) == b.transpose() && forceUsed[0] && forceUsed[size - 1];
+        }
+
+        /**
+         * The solve methods applies a partitioned Runge Kutta method to a separable system
+         *
+         * @param velocity the derivative of the positions as a function of the momenta
+         * @param force the derivative of the momenta as a function of the positions
+         * @param time the time interval we want to integrate over
+         * @param q0 the initial positions
+         * @param p0 the initial momenta
+         * @param steps the number of integration steps we would like to make
+         *
+         * @return a std::vector of states (positions followed by momenta), one for every integration step performed. The first
+         * step will be the supplied initial state.
+         */
+        template<typename Velocity, typename Force>
+        std::vector<State> solve(Velocity &&velocity, Force &&force, double time, const Step &q0, const Step &p0, unsigned int steps){
+
+            std::vector<State> stepsVector;
+            stepsVector.reserve(steps + 1);
+
+            auto output = [&stepsVector] (double, const State &state) {
+                stepsVector.push_back(state);
+            };
+            integrate(velocity, force, time, q0, p0, steps, output);
+
+            return stepsVector;
+
+        }
+
+        /**
+         * The solve methods applies a partitioned Runge Kutta method to a separable system and hands every state (positions
+         * followed by momenta) to an output instead of returning them
+         *
+         * @param velocity the derivative of the positions as a function of the momenta
+         * @param force the derivative of the momenta as a function of the positions
+         * @param time the time interval we want to integrate over
+         * @param q0 the initial positions
+         * @param p0 the initial momenta
+         * @param steps the number of integration steps we would like to make
+         * @param output receives all steps+1 states, see rk_trajectory.hpp for the interface of an output
+         */
+        template<typename Velocity, typename Force, typename Output>
+        void solve(Velocity &&velocity, Force &&force, double time, const Step &q0, const Step &p0, unsigned int steps, Output &output){
+
+            output.initialize(2*q0.size(), steps + 1);
+            integrate(velocity, force, time, q0, p0, steps, [&output] (double t, const State &state) {
+                output.push(t, state);
+            });
+            output.finalize();
+
+        }
+
+        /**
+         * @return the statistics of the last solve (all zero unless the integrator uses StatisticsInstrumentation)
+         */
+        SolverStatistics statistics() const {
+            return instrumentation.statistics();
+        }
+
+        /**
+         * @return the instrumentation policy, for the data of a policy which goes beyond SolverStatistics
+         */
+        const Instrumentation &instrumentationPolicy() const {
+            return instrumentation;
+        }
+
+    private:
+        template<typename Velocity, typename Force, typename Push>
+        void integrate(Velocity &&velocity, Force &&force, double time, const Step &q0, const Step &p0, unsigned int steps, Push &&push){
+
+            instrumentation.reset();
+            prepare(q0);
+
+            const unsigned int n = q0.size();
+            Step q = q0;
+            Step p = p0;
+            double h = time / steps;
+
+            state.head(n) = q;
+            state.tail(n) = p;
+            push(0.0, state);
+
+            for(unsigned int i = 0; i < steps; i++){
+                iteration(velocity, force, q, p, h);
+
+                auto timer = instrumentation.time(Phase::Output);
+                state.head(n) = q;
+                state.tail(n) = p;
+                push((i + 1)*h, state);
+            }
+
+        }
+
+        /**
+         * Sizes the workspace for states like q0, this is the only place where the integrator itself allocates memory
+         */
+        void prepare(const Step &q0){
+            velocities.assign(size, q0);
+            forces.assign(size, q0);
+            positionStage = q0;
+            momentumStage = q0;
+            state.resize(2*q0.size());
+            lastForceValid = false;
+        }
+
+        /**
+         * Computes one step in place
+         *
+         * @param q the positions, they are overwritten with the positions after the step
+         * @param p the momenta, they are overwritten with the momenta after the step
+         * @param h the step size
+         */
+        template<typename Velocity, typename Force>
+        void iteration(Velocity &&velocity, Force &&force, Step &q, Step &p, const double h){
+
+            auto stepTimer = instrumentation.time(Phase::Step);
+
+            for(unsigned int i = 0; i < size; i++){
+
+                {
+                    auto timer = instrumentation.time(Phase::Stages);
+                    if(i == 0){
+                        momentumStage = p;
+                    }
+                    for(unsigned int j = 0; j < i; j++){
+                        if(stageAhat(i,j) != 0){
+                            momentumStage += h*stageAhat(i,j) * forces[j];
+                        }
+                    }
+                }
+
+                if(velocityUsed[i]){
+                    auto timer = instrumentation.time(Phase::Rhs);
+                    velocities[i] = velocity(momentumStage);
+                }
+
+                {
+                    auto timer = instrumentation.time(Phase::Stages);
+                    if(i == 0){
+                        positionStage = q;
+                    }
+                    for(unsigned int j = 0; j <= i; j++){
+                        if(stageA(i,j) != 0){
+                            positionStage += h*stageA(i,j) * velocities[j];
+                        }
+                    }
+                }
+
+                if(forceUsed[i] && !(i == 0 && lastForceValid)){
+                    auto timer = instrumentation.time(Phase::Rhs);
+                    forces[i] = force(positionStage);
+                    instrumentation.count(Event::RhsEvaluation);
+                }
+            }
+
+            // the result of the step from the last stage
+            auto timer = instrumentation.time(Phase::Stages);
+            q = positionStage;
+            p = momentumStage;
+            for(unsigned int j = 0; j < size; j++){
+                if(finalB(j) != 0){
+                    q += h*finalB(j) * velocities[j];
+                }
+                if(finalBhat(j) != 0){
+                    p += h*finalBhat(j) * forces[j];
+                }
+            }
+
+            // the last stage is at q1, i.e. the first stage of the next step
+            if(firstSameAsLast){
+                std::swap(forces[0], forces[size - 1]);
+                lastForceValid = true;
+            }
+            instrumentation.count(Event::AcceptedStep);
+
+        }
+
+
+        const Eigen::MatrixXd A;
+        const Eigen::VectorXd b;
+        const Eigen::MatrixXd Ahat;
+        const Eigen::VectorXd bhat;
+        unsigned int size;
+        Instrumentation instrumentation;
+
+        // the tableau relative to the previous stage
+        Eigen::MatrixXd stageA;
+        Eigen::MatrixXd stageAhat;
+        Eigen::RowVectorXd finalB;
+        Eigen::RowVectorXd finalBhat;
+        std::vector<bool> velocityUsed;
+        std::vector<bool> forceUsed;
+        bool firstSameAsLast;
+
+        // workspace of iteration
+        std::vector<Step> velocities;
+        std::vector<Step> forces;
+        Step positionStage;
+        Step momentumStage;
+        State state;
+        bool lastForceValid;
+};
+
+
+
+
+#endif
@@ -0,0 +1,352 @@
+#ifndef RKSENSITIVITY
+
+#define RKSENSITIVITY
+
+#include <Eigen/Dense>
+#include <vector>
+
+#include "rk_implementer.hpp"
+#include "rk_statistics.hpp"
+
+
+
+
+/**
+ *
+ * How the sensitivities of the stages of an implicit method are computed, explicit methods compute them directly.
+ *
+ */
+enum class SensitivityMode {
+    // the stages of the state are solved first, then the (linear) equations of the sensitivities with the Jacobian at the
+    // converged stages
+    Staggered,
+    // the Newton iteration of the stages corrects the state and the sensitivities together, with the block diagonal part of
+    // the Newton matrix (the one of the state) for all of them
+    Simultaneous
+};
+
+
+
+
+/**
+ *
+ * The Newton matrix of the simultaneous corrector: the state and the sensitivity with respect to every parameter form one
+ * block each, all blocks are corrected with the Newton matrix M of the state. lu() factorizes M once.
+ *
+ */
+struct SimultaneousCorrectorJacobian {
+    Eigen::MatrixXd M;
+    // the number of blocks, one plus the number of parameters
+    unsigned int blocks;
+
+    class Factorization {
+
+        public:
+            Factorization(const SimultaneousCorrectorJacobian &jacobian) : lu(jacobian.M), blocks(jacobian.blocks){
+            }
+
+            Eigen::VectorXd solve(const Eigen::VectorXd &residual) const {
+                const unsigned int m = residual.size()/blocks;
+                Eigen::VectorXd result(residual.size());
+                Eigen::Map<Eigen::MatrixXd>(result.data(), m, blocks) = lu.solve(Eigen::Map<const Eigen::MatrixXd>(residual.data(), m, blocks));
+                return result;
+            }
+
+        private:
+            Eigen::PartialPivLU<Eigen::MatrixXd> lu;
+            unsigned int blocks;
+    };
+
+    Factorization lu() const {
+        return Factorization(*this);
+    }
+};
+
+
+
+
+/**
+ *
+ * Implementation of a Runge Kutta solver which computes the sensitivities S = dy/dp of the state with respect to parameters p
+ * together with the state (forward sensitivity analysis). The sensitivities follow S' = f_y S + f_p, S(0) = dy0/dp, and are
+ * computed with the same tableau, steps and stages as the state: the stages of S are the derivatives of the stages of y with
+ * respect to p. Hence S is the exact derivative of the computed solution (internal differentiation), all sensitivities come
+ * from one integration instead of one additional integration per parameter.
+ *
+ * For explicit methods the sensitivity of a stage follows directly from those of the previous stages. For implicit methods
+ * the stages are solved with OptimizationMethods::dampedNewton like in ImplicitRungeKuttaIntegrator, the sensitivities either
+ * afterwards or in the same iteration, see SensitivityMode.
+ *
+ * The state is an Eigen::VectorXd, the sensitivities an n x np Eigen::MatrixXd (one column per parameter).
+ *
+ * The Instrumentation policy decides whether statistics are collected, see ExplicitRungeKuttaIntegrator. The Newton matrices
+ * count as Jacobian evaluations like in ImplicitRungeKuttaIntegrator, as well as every evaluation of f_y and f_p at a stage
+ * for the sensitivities.
+ *
+ */
+template <class Instrumentation = NoInstrumentation> class ForwardSensitivityIntegrator {
+
+    public:
+        /**
+         * Constructor for the ForwardSensitivityIntegrator
+         *
+         * @param tableau the butcher tableau, explicit or implicit
+         * @param mode how the sensitivities of an implicit method are computed
+         */
+        ForwardSensitivityIntegrator(const ButcherTableau &tableau, SensitivityMode mode = SensitivityMode::Staggered)
+            : A(tableau.A), b(tableau.b), size(tableau.A.cols()), mode(mode){
+            explicitMethod = A.template triangularView<Eigen::Upper>().toDenseMatrix().isZero(0);
+        }
+
+        /**
+         * Integrates the state and its sensitivities over [0, time] with a fixed number of steps
+         *
+         * @param f the function we are integrating over, f(y) with the parameters fixed
+         * @param fy the Jacobian of f with respect to y, an n x n matrix
+         * @param fp the Jacobian of f with respect to the parameters, an n x np matrix
+         * @param time the time interval we want to integrate over
+         * @param y0 the initial state of the system
+         * @param S0 the initial sensitivities dy0/dp (zero if y0 does not depend on the parameters)
+         * @param steps the number of integration steps
+         * @param output receives all steps+1 states, see rk_trajectory.hpp for the interface of an output
+         * @param sensitivityOutput receives all steps+1 sensitivity matrices (column-major, n * np values each)
+         *
+         * @exception if the Newton iteration of an implicit method does not converge an error will be thrown
+         */
+        template<typename Function, typename Jacobian, typename ParameterJacobian, typename Output, typename SensitivityOutput>
+        void solve(Function &&f, Jacobian &&fy, ParameterJacobian &&fp, double time, const Eigen::VectorXd &y0, const Eigen::MatrixXd &S0,
+                   unsigned int steps, Output &output, SensitivityOutput &sensitivityOutput){
+
+            if(S0.rows() != y0.size()){
+                throw "The initial sensitivities must have one row per component of the state";
+            }
+
+            instrumentation.reset();
+
+            const double h = time/steps;
+            Eigen::VectorXd y = y0;
+            Eigen::MatrixXd S = S0;
+
+            output.initialize(y0.size(), steps + 1);
+            sensitivityOutput.initialize(S0.size(), steps + 1);
+            output.push(0.0, y);
+            sensitivityOutput.push(0.0, S);
+
+            for(unsigned int i = 0; i < steps; i++){
+                if(explicitMethod){
+                    explicitIteration(f, fy, fp, y, S, h);
+                }else{
+                    implicitIteration(f, fy, fp, y, S, h);
+                }
+                instrumentation.count(Event::AcceptedStep);
+
+                auto timer = instrumentation.time(Phase::Output);
+                output.push((i + 1)*h, y);
+                sensitivityOutput.push((i + 1)*h, S);
+            }
+
+            output.finalize();
+            sensitivityOutput.finalize();
+
+        }
+
+        /**
+         * @return the statistics of the last solve (all zero unless the integrator uses StatisticsInstrumentation)
+         */
+        SolverStatistics statistics() const {
+            return instrumentation.statistics();
+        }
+
+        /**
+         * @return the instrumentation policy, for the data of a policy which goes beyond SolverStatistics
+         */
+        const Instrumentation &instrumentationPolicy() const {
+            return instrumentation;
+        }
+
+    private:
+        /**
+         * A step of an explicit method, the stage sensitivities are f_y(Y_i) dY_i/dp + f_p(Y_i)
+         */
+        template<typename Function, typename Jacobian, typename ParameterJacobian>
+        void explicitIteration(Function &&f, Jacobian &&fy, ParameterJacobian &&fp, Eigen::VectorXd &y, Eigen::MatrixXd &S, const double h){
+
+            auto stepTimer = instrumentation.time(Phase::Step);
+
+            std::vector<Eigen::VectorXd> K(size);
+            std::vector<Eigen::MatrixXd> KS(size);
+            for(unsigned int i = 0; i < size; i++){
+                Eigen::VectorXd stage = y;
+                Eigen::MatrixXd stageS = S;
+                {
+                    auto timer = instrumentation.time(Phase::Stages);
+                    for(unsigned int j = 0; j < i; j++){
+                        if(A(i,j) != 0){
+                            stage += h*A(i,j) * K[j];
+                            stageS += h*A(i,j) * KS[j];
+                        }
+                    }
+                }
+                auto timer = instrumentation.time(Phase::Rhs);
+                K[i] = f(stage);
+                KS[i] = fy(stage)*stageS + fp(stage);
+                instrumentation.count(Event::RhsEvaluation);
+                instrumentation.count(Event::JacobianEvaluation);
+            }
+
+            auto timer = instrumentation.time(Phase::Stages);
+            for(unsigned int i = 0; i < size; i++){
+                if(b(i) != 0){
+                    y += h*b(i) * K[i];
+                    S += h*b(i) * KS[i];
+                }
+            }
+        }
+
+        /**
+         * A step of an implicit method, the stages K solve K_i = f(y + h sum_j A(i,j) K_j) and the stage sensitivities
+         * KS_i = f_y(Y_i) (S + h sum_j A(i,j) KS_j) + f_p(Y_i), a linear system with the Newton matrix of the stages
+         */
+        template<typename Function, typename Jacobian, typename ParameterJacobian>
+        void implicitIteration(Function &&f, Jacobian &&fy, ParameterJacobian &&fp, Eigen::VectorXd &y, Eigen::MatrixXd &S, const double h){
+
+            auto stepTimer = instrumentation.time(Phase::Step);
+
+            const unsigned int n = y.size();
+            const unsigned int np = S.cols();
+
+            // the argument of f for the i-th increment, given all (stacked) increments
+            auto stage = [&] (const Eigen::VectorXd &increments, unsigned int i) {
+                auto timer = instrumentation.time(Phase::Stages);
+                Eigen::VectorXd result = y;
+                for(unsigned int j = 0; j < size; j++){
+                    result += h*A(i,j) * increments.segment(j*n, n);
+                }
+                return result;
+            };
+
+            // the Newton matrix I - h A x f_y(Y) of the stages, fills the Jacobians of f at the stages
+            auto newtonMatrix = [&] (const Eigen::VectorXd &increments, std::vector<Eigen::MatrixXd> &jacobians, std::vector<Eigen::MatrixXd> *parameterJacobians) {
+                Eigen::MatrixXd result = Eigen::MatrixXd::Identity(size*n, size*n);
+                for(unsigned int i = 0; i < size; i++){
+                    Eigen::VectorXd Y = stage(increments, i);
+                    auto timer = instrumentation.time(Phase::Rhs);
+                    jacobians[i] = fy(Y);
+                    // the Newton matrices of OptimizationMethods::dampedNewton are counted there
+                    if(parameterJacobians != nullptr){
+                        (*parameterJacobians)[i] = fp(Y);
+                        instrumentation.count(Event::JacobianEvaluation);
+                    }
+                    for(unsigned int j = 0; j < size; j++){
+                        result.block(i*n, j*n, n, n) -= h*A(i,j) * jacobians[i];
+                    }
+                }
+                return result;
+            };
+
+            // the residual of the state stages
+            auto F = [&] (const Eigen::VectorXd &increments) {
+                Eigen::VectorXd result(size*n);
+                for(unsigned int i = 0; i < size; i++){
+                    Eigen::VectorXd Y = stage(increments, i);
+                    auto timer = instrumentation.time(Phase::Rhs);
+                    result.segment(i*n, n) = increments.segment(i*n, n) - f(Y);
+                    instrumentation.count(Event::RhsEvaluation);
+                }
+                return result;
+            };
+
+            // the residual of the sensitivity stages (stacked like the state stages, one column per parameter)
+            auto FS = [&] (const Eigen::MatrixXd &sensitivityIncrements, const std::vector<Eigen::MatrixXd> &jacobians, const std::vector<Eigen::MatrixXd> &parameterJacobians) {
+                Eigen::MatrixXd result(size*n, np);
+                for(unsigned int i = 0; i < size; i++){
+                    Eigen::MatrixXd stageS = S;
+                    for(unsigned int j = 0; j < size; j++){
+                        if(A(i,j) != 0){
+                            stageS += h*A(i,j) * sensitivityIncrements.middleRows(j*n, n);
+                        }
+                    }
+                    result.middleRows(i*n, n) = sensitivityIncrements.middleRows(i*n, n) - jacobians[i]*stageS - parameterJacobians[i];
+                }
+                return result;
+            };
+
+            std::vector<Eigen::MatrixXd> jacobians(size), parameterJacobians(size);
+
+            // all increments start as f(y0), the increment of the explicit euler method, the sensitivity increments as 0
+            Eigen::VectorXd increments(size*n);
+            {
+                auto timer = instrumentation.time(Phase::Rhs);
+                increments.segment(0, n) = f(y);
+                instrumentation.count(Event::RhsEvaluation);
+            }
+            for(unsigned int i = 1; i < size; i++){
+                increments.segment(i*n, n) = increments.segment(0, n);
+            }
+            Eigen::MatrixXd sensitivityIncrements = Eigen::MatrixXd::Zero(size*n, np);
+
+            // the stages have to be considerably more accurate than the method itself
+            if(mode == SensitivityMode::Staggered){
+                auto DF = [&] (const Eigen::VectorXd &current) {
+                    return newtonMatrix(current, jacobians, nullptr);
+                };
+                increments = OptimizationMethods::dampedNewton(F, DF, increments, 1e-12, 1e-14, instrumentation);
+
+                // the sensitivity equations are linear, one solve with the Newton matrix at the converged stages
+                Eigen::MatrixXd M = newtonMatrix(increments, jacobians, &parameterJacobians);
+                auto timer = instrumentation.time(Phase::LinearAlgebra);
+                Eigen::PartialPivLU<Eigen::MatrixXd> lu(M);
+                sensitivityIncrements = lu.solve(-FS(sensitivityIncrements, jacobians, parameterJacobians));
+                instrumentation.count(Event::LuFactorization);
+                instrumentation.count(Event::LinearSolve);
+            }else{
+                // the unknowns are the state increments followed by the sensitivity increments of every parameter
+                const unsigned int m = size*n;
+                auto G = [&] (const Eigen::VectorXd &x) {
+                    Eigen::VectorXd stateIncrements = x.head(m);
+                    Eigen::VectorXd result(x.size());
+                    result.head(m) = F(stateIncrements);
+                    for(unsigned int i = 0; i < size; i++){
+                        Eigen::VectorXd Y = stage(stateIncrements, i);
+                        auto timer = instrumentation.time(Phase::Rhs);
+                        jacobians[i] = fy(Y);
+                        parameterJacobians[i] = fp(Y);
+                        instrumentation.count(Event::JacobianEvaluation);
+                    }
+                    Eigen::Map<Eigen::MatrixXd>(result.data() + m, m, np) = FS(Eigen::Map<const Eigen::MatrixXd>(x.data() + m, m, np), jacobians, parameterJacobians);
+                    return result;
+                };
+                auto DG = [&] (const Eigen::VectorXd &x) {
+                    return SimultaneousCorrectorJacobian{newtonMatrix(x.head(m), jacobians, nullptr), np + 1};
+                };
+
+                Eigen::VectorXd x(m*(np + 1));
+                x.head(m) = increments;
+                x.tail(m*np).setZero();
+                x = OptimizationMethods::dampedNewton(G, DG, x, 1e-12, 1e-14, instrumentation);
+                increments = x.head(m);
+                sensitivityIncrements = Eigen::Map<const Eigen::MatrixXd>(x.data() + m, m, np);
+            }
+
+            auto timer = instrumentation.time(Phase::Stages);
+            for(unsigned int i = 0; i < size; i++){
+                if(b(i) != 0){
+                    y += h*b(i) * increments.segment(i*n, n);
+                    S += h*b(i) * sensitivityIncrements.middleRows(i*n, n);
+                }
+            }
+        }
+
+
+        const Eigen::MatrixXd A;
+        const Eigen::VectorXd b;
+        unsigned int size;
+        SensitivityMode mode;
+        bool explicitMethod;
+        Instrumentation instrumentation;
+};
+
+
+
+
+#endif
@@ -0,0 +1,332 @@
+#ifndef RKSHOOTING
+
+#define RKSHOOTING
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "rk_implementer.hpp"
+#include "rk_statistics.hpp"
+#include "rk_trajectory.hpp"
+
+
+
+
+/**
+ *
+ * The Jacobian of the multiple shooting equations, which is block bidiagonal apart from the boundary conditions:
+ *
+ *      | G_0  -I                |
+ *      |      G_1  -I           |
+ *      |           ...   ...    |
+ *      |           G_{m-1}  -I  |
+ *      | Ra                 Rb  |
+ *
+ * with the sensitivity matrices G_j of the segments and the Jacobians Ra, Rb of the boundary conditions. lu() condenses the
+ * system to the n x n matrix Ra + Rb G_{m-1} ... G_0 and factorizes it, the solve of the factorization recovers all blocks
+ * by forward recursion. Hence a Newton step costs O(m n^3) instead of O(m^3 n^3), and OptimizationMethods::dampedNewton can
+ * use it in place of a dense matrix.
+ *
+ */
+struct MultipleShootingJacobian {
+    // the sensitivity matrices of the m segments
+    std::vector<Eigen::MatrixXd> G;
+    // the Jacobians of the boundary conditions with respect to y(0) and y(time)
+    Eigen::MatrixXd Ra;
+    Eigen::MatrixXd Rb;
+
+    /**
+     * The condensed factorization, it refers to the Jacobian and must not outlive it
+     */
+    class Condensed {
+
+        public:
+            Condensed(const MultipleShootingJacobian &jacobian) : jacobian(jacobian){
+                const std::vector<Eigen::MatrixXd> &G = jacobian.G;
+                Eigen::MatrixXd E = Eigen::MatrixXd::Identity(jacobian.Ra.rows(), jacobian.Ra.cols());
+                for(const Eigen::MatrixXd &Gj : G){
+                    E = Gj*E;
+                }
+                lu.compute(jacobian.Ra + jacobian.Rb*E);
+            }
+
+            /**
+             * Solves the multiple shooting system for the stacked right hand side [c_0, ..., c_{m-1}, r]
+             */
+            Eigen::VectorXd solve(const Eigen::VectorXd &residual) const {
+                const std::vector<Eigen::MatrixXd> &G = jacobian.G;
+                const unsigned int n = jacobian.Ra.rows();
+                const unsigned int m = G.size();
+
+                // delta_{j+1} = G_j delta_j - c_j, hence delta_m = E delta_0 + u
+                Eigen::VectorXd u = Eigen::VectorXd::Zero(n);
+                for(unsigned int j = 0; j < m; j++){
+                    u = G[j]*u - residual.segment(j*n, n);
+                }
+
+                Eigen::VectorXd delta(residual.size());
+                delta.head(n) = lu.solve(residual.tail(n) - jacobian.Rb*u);
+                for(unsigned int j = 0; j < m; j++){
+                    delta.segment((j + 1)*n, n) = G[j]*delta.segment(j*n, n) - residual.segment(j*n, n);
+                }
+                return delta;
+            }
+
+        private:
+            const MultipleShootingJacobian &jacobian;
+            Eigen::PartialPivLU<Eigen::MatrixXd> lu;
+    };
+
+    Condensed lu() const {
+        return Condensed(*this);
+    }
+};
+
+
+
+
+/**
+ *
+ * Implementation of a multiple shooting solver for two point boundary value problems y' = f(y) on [0, time] with boundary
+ * conditions r(y(0), y(time)) = 0. The interval is split into m segments, the unknowns are the states s_0, ..., s_m at their
+ * ends. The equations y(s_j) - s_{j+1} = 0 (y(s_j) is the end of segment j started in s_j) and r(s_0, s_m) = 0 are solved with
+ * OptimizationMethods::dampedNewton. Compared to single shooting the errors of the initial guess only grow over one segment,
+ * which makes the iteration far more robust.
+ *
+ * Every segment is integrated together with its sensitivity matrix G_j (the derivative of y(s_j) with respect to s_j, from
+ * the variational equation G' = J(y) G) by an ExplicitRungeKuttaIntegrator with a fixed number of steps, hence G_j is the
+ * exact derivative of the computed y(s_j). The segments are independent and are integrated in parallel, every thread uses
+ * its own integrator, and the Newton systems are solved by condensing, see MultipleShootingJacobian. f and J are called from
+ * several threads at the same time and must not modify shared state. Needs to be linked with -pthread.
+ *
+ * The Instrumentation policy decides whether statistics are collected, see ExplicitRungeKuttaIntegrator. The evaluations of
+ * f (of the system together with the variational equation, if the sensitivities are needed) are counted, their time is not
+ * measured.
+ *
+ */
+template <class Instrumentation = NoInstrumentation> class MultipleShootingSolver {
+
+    public:
+        /**
+         * Constructor for the MultipleShootingSolver
+         *
+         * @param tableau the butcher tableau of the segment integrations, e.g. ExplicitRKTableaus::classical4thOrder()
+         * @param segments the number of shooting segments
+         * @param stepsPerSegment the number of integration steps per segment
+         * @param rtol the relative tolerance of the Newton iteration, see OptimizationMethods::dampedNewton
+         * @param atol the absolute tolerance of the Newton iteration
+         * @param threads the number of threads integrating the segments (0 for the number of cores)
+         */
+        MultipleShootingSolver(const ButcherTableau &tableau, unsigned int segments, unsigned int stepsPerSegment, double rtol = 1e-10,
+                               double atol = 1e-12, unsigned int threads = 0)
+            : tableau(tableau), segments(segments), stepsPerSegment(stepsPerSegment), rtol(rtol), atol(atol),
+              threads(threads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : threads){
+            if(segments == 0 || stepsPerSegment == 0){
+                throw "Multiple shooting needs at least one segment and one step per segment";
+            }
+        }
+
+        /**
+         * Solves the boundary value problem and hands the solution (all integration steps of all segments) to the output
+         *
+         * @param f the right hand side of the ODE
+         * @param J the jacobian of f
+         * @param r the boundary conditions r(y(0), y(time)), as many as the dimension of y
+         * @param dr the jacobians of r, dr(ya, yb) returns the pair of the derivatives with respect to ya and yb
+         * @param time the length of the interval
+         * @param guess the initial guess of the states at the segments' ends, segments + 1 states starting at 0
+         * @param output receives segments * stepsPerSegment + 1 states, see rk_trajectory.hpp for the interface of an output
+         *
+         * @exception if the guess does not fit the segments or the Newton iteration does not converge an error will be thrown
+         */
+        template<typename Function, typename Jacobian, typename Boundary, typename BoundaryJacobian, typename Output>
+        void solve(Function &&f, Jacobian &&J, Boundary &&r, BoundaryJacobian &&dr, double time, const std::vector<Eigen::VectorXd> &guess, Output &output){
+
+            if(guess.size() != segments + 1){
+                throw "The guess must contain one state per segment end";
+            }
+
+            instrumentation.reset();
+            n = guess[0].size();
+            length = time/segments;
+            ends.assign(segments, guess[0]);
+
+            Eigen::VectorXd x(n*(segments + 1));
+            for(unsigned int j = 0; j <= segments; j++){
+                x.segment(j*n, n) = guess[j];
+            }
+
+            // the residual at the argument of the last Jacobian is known from the sensitivity integration
+            Eigen::VectorXd cachedX;
+            Eigen::VectorXd cachedResidual;
+
+            auto residual = [&] (const Eigen::VectorXd &s) -> Eigen::VectorXd {
+                if(cachedX.size() == s.size() && cachedX == s){
+                    return cachedResidual;
+                }
+                integrateSegments(f, J, s, nullptr);
+                return assemble(r, s);
+            };
+
+            auto jacobian = [&] (const Eigen::VectorXd &s) -> MultipleShootingJacobian {
+                MultipleShootingJacobian result;
+                result.G.assign(segments, Eigen::MatrixXd());
+                integrateSegments(f, J, s, &result.G);
+                cachedX = s;
+                cachedResidual = assemble(r, s);
+                std::pair<Eigen::MatrixXd, Eigen::MatrixXd> boundary = dr(s.head(n), s.tail(n));
+                result.Ra = boundary.first;
+                result.Rb = boundary.second;
+                return result;
+            };
+
+            x = OptimizationMethods::dampedNewton(residual, jacobian, x, rtol, atol, instrumentation);
+
+            // the solution, segment by segment
+            output.initialize(n, segments*stepsPerSegment + 1);
+            ExplicitRungeKuttaIntegrator<Eigen::VectorXd> integrator(tableau);
+            for(unsigned int j = 0; j < segments; j++){
+                SegmentOutput<Output> segment{output, j*length, j == 0};
+                integrator.solve(f, length, Eigen::VectorXd(x.segment(j*n, n)), stepsPerSegment, segment);
+            }
+            output.finalize();
+
+        }
+
+        /**
+         * @return the statistics of the last solve (all zero unless the integrator uses StatisticsInstrumentation)
+         */
+        SolverStatistics statistics() const {
+            return instrumentation.statistics();
+        }
+
+        /**
+         * @return the instrumentation policy, for the data of a policy which goes beyond SolverStatistics
+         */
+        const Instrumentation &instrumentationPolicy() const {
+            return instrumentation;
+        }
+
+    private:
+        /**
+         * Forwards the states of one segment to the output of the whole solution, shifted by the start of the segment. The
+         * first state of a segment is the last one of the previous segment, hence it is skipped apart from the first segment.
+         */
+        template<typename Output>
+        struct SegmentOutput {
+            Output &output;
+            double start;
+            bool first;
+
+            void initialize(unsigned int, unsigned int){
+            }
+
+            template<typename State>
+            void push(double t, const State &y){
+                if(t > 0 || first){
+                    output.push(start + t, y);
+                }
+            }
+
+            void finalize(){
+            }
+        };
+
+        /**
+         * Integrates all segments from the states in s on the threads, the ends are stored in ends and, if G is not null, the
+         * sensitivity matrices in G
+         */
+        template<typename Function, typename Jacobian>
+        void integrateSegments(Function &&f, Jacobian &&J, const Eigen::VectorXd &s, std::vector<Eigen::MatrixXd> *G){
+
+            const unsigned int workers = std::min(threads, segments);
+            std::atomic<unsigned int> next(0);
+            std::vector<std::exception_ptr> failures(workers);
+
+            // the state followed by the column-major sensitivity matrix
+            auto variational = [&] (const Eigen::VectorXd &z) -> Eigen::VectorXd {
+                Eigen::VectorXd result(z.size());
+                Eigen::Map<const Eigen::MatrixXd> sensitivity(z.data() + n, n, n);
+                Eigen::VectorXd y = z.head(n);
+                result.head(n) = f(y);
+                Eigen::Map<Eigen::MatrixXd>(result.data() + n, n, n) = J(y)*sensitivity;
+                return result;
+            };
+
+            auto work = [&] (unsigned int worker) {
+                try{
+                    ExplicitRungeKuttaIntegrator<Eigen::VectorXd> integrator(tableau);
+                    FinalState final;
+                    for(unsigned int j = next++; j < segments; j = next++){
+                        if(G == nullptr){
+                            integrator.solve(f, length, Eigen::VectorXd(s.segment(j*n, n)), stepsPerSegment, final);
+                            ends[j] = final.value();
+                        }else{
+                            Eigen::VectorXd z(n + n*n);
+                            z.head(n) = s.segment(j*n, n);
+                            Eigen::Map<Eigen::MatrixXd>(z.data() + n, n, n).setIdentity();
+                            integrator.solve(variational, length, z, stepsPerSegment, final);
+                            ends[j] = final.value().head(n);
+                            (*G)[j] = Eigen::Map<const Eigen::MatrixXd>(final.value().data() + n, n, n);
+                        }
+                    }
+                }catch(...){
+                    failures[worker] = std::current_exception();
+                }
+            };
+
+            std::vector<std::thread> pool;
+            for(unsigned int worker = 1; worker < workers; worker++){
+                pool.emplace_back(work, worker);
+            }
+            work(0);
+            for(std::thread &thread : pool){
+                thread.join();
+            }
+
+            for(std::exception_ptr &failure : failures){
+                if(failure){
+                    std::rethrow_exception(failure);
+                }
+            }
+
+            instrumentation.count(Event::RhsEvaluation, static_cast<unsigned long>(tableau.A.cols())*stepsPerSegment*segments);
+        }
+
+        /**
+         * @return the residual [y(s_0) - s_1, ..., y(s_{m-1}) - s_m, r(s_0, s_m)] from the integrated ends
+         */
+        template<typename Boundary>
+        Eigen::VectorXd assemble(Boundary &&r, const Eigen::VectorXd &s){
+            Eigen::VectorXd result(n*(segments + 1));
+            for(unsigned int j = 0; j < segments; j++){
+                result.segment(j*n, n) = ends[j] - s.segment((j + 1)*n, n);
+            }
+            result.tail(n) = r(s.head(n), s.tail(n));
+            return result;
+        }
+
+
+        ButcherTableau tableau;
+        unsigned int segments;
+        unsigned int stepsPerSegment;
+        double rtol;
+        double atol;
+        unsigned int threads;
+        Instrumentation instrumentation;
+
+        // the dimension of y, the length of a segment and the ends of the segments of the last integration
+        unsigned int n = 0;
+        double length = 0;
+        std::vector<Eigen::VectorXd> ends;
+};
+
+
+
+
+#endif
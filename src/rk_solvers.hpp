@@ -9,17 +9,24 @@
 
 
 
+#ifndef RKSOLVERS
+
+#define RKSOLVERS
+
+#include "rk_adaptive.hpp"
 #include "rk_implementer.hpp"
+#include "rk_imex.hpp"
+#include "rk_nystrom.hpp"
+#include "rk_partitioned.hpp"
 #include<vector>
 
 
 
-// collection of common explicit RK methods.
-namespace ExplicitRKSolvers{
+// the butcher tableaus of the methods in ExplicitRKSolvers
+namespace ExplicitRKTableaus{
 
     // traditional explicit euler method with convergence order 1
-    template <typename Step, typename Function> 
-    std::vector<Step> explicitEulerRule(Function f, double time, const Step &y0, unsigned int steps){
+    inline ButcherTableau explicitEuler(){
 
         Eigen::MatrixXd A(1,1);
         A << 0;
@@ -27,14 +34,12 @@ namespace ExplicitRKSolvers{
         Eigen::VectorXd b(1);
         b << 1;
 
-        ExplicitRungeKuttaIntegrator<Step> eRKi(A,b);
-        return eRKi.solve(f, time, y0, steps);
+        return {"Explicit Euler", A, b, 1};
 
     }
 
     // explicit trapizoidal rule with convergece order 2
-    template <typename Step, typename Function> 
-    std::vector<Step> explicitTrapezoidalRule(Function f, double time, const Step &y0, unsigned int steps){
+    inline ButcherTableau explicitTrapezoidal(){
 
         Eigen::MatrixXd A(2,2);
         A << 0,0,
@@ -43,14 +48,12 @@ namespace ExplicitRKSolvers{
         Eigen::VectorXd b(2);
         b << 0.5,0.5;
 
-        ExplicitRungeKuttaIntegrator<Step> eRKi(A,b);
-        return eRKi.solve(f, time, y0, steps);
+        return {"Explicit trapezoidal rule", A, b, 2};
 
     }
 
     // explicit midpoint rule with convergence order 2
-    template <typename Step, typename Function>
-    std::vector<Step> explicitMidPointRule(Function f, double time, const Step &y0, unsigned int steps){
+    inline ButcherTableau explicitMidPoint(){
 
         Eigen::MatrixXd A(2,2);
         A << 0,0,
@@ -59,14 +62,12 @@ namespace ExplicitRKSolvers{
         Eigen::VectorXd b(2);
         b << 0,1;
 
-        ExplicitRungeKuttaIntegrator<Step> eRKi(A,b);
-        return eRKi.solve(f, time, y0, steps);
+        return {"Explicit midpoint rule", A, b, 2};
 
     }
 
     // classical 4-th order runge kutta single step method
-    template <typename Step, typename Function>
-    std::vector<Step> classical4thOrderRuleIntegrator(Function f, double time, const Step &y0, unsigned int steps){
+    inline ButcherTableau classical4thOrder(){
 
         Eigen::MatrixXd A(4,4);
         A << 0,0,0,0,
@@ -77,14 +78,12 @@ namespace ExplicitRKSolvers{
         Eigen::VectorXd b(4);
         b << 1.0/6,2.0/6,2.0/6,1.0/6;
 
-        ExplicitRungeKuttaIntegrator<Step> eRKi(A,b);
-        return eRKi.solve(f, time, y0, steps);
+        return {"Classical 4th order", A, b, 4};
 
     }
 
     // kutta's 3/8-rule of order 4
-    template <typename Step, typename Function>
-    std::vector<Step> kuttas38thRule(Function f, double time, const Step &y0, unsigned int steps){
+    inline ButcherTableau kuttas38th(){
 
         Eigen::MatrixXd A(4,4);
         A << 0,0,0,0,
@@ -95,7 +94,72 @@ namespace ExplicitRKSolvers{
         Eigen::VectorXd b(4);
         b << 1.0/8, 3.0/8, 3.0/8, 1.0/8;
 
-        ExplicitRungeKuttaIntegrator<Step> eRKi(A,b);
+        return {"Kutta's 3/8-rule", A, b, 4};
+
+    }
+
+    // all of the above, e.g. to compare the methods
+    inline std::vector<ButcherTableau> all(){
+        return {explicitEuler(), explicitTrapezoidal(), explicitMidPoint(), classical4thOrder(), kuttas38th()};
+    }
+
+}
+
+
+// collection of common explicit RK methods.
+namespace ExplicitRKSolvers{
+
+    // traditional explicit euler method with convergence order 1
+    template <typename Step, typename Function> 
+    std::vector<Step> explicitEulerRule(Function f, double time, const Step &y0, unsigned int steps){
+
+        ButcherTableau tableau = ExplicitRKTableaus::explicitEuler();
+
+        ExplicitRungeKuttaIntegrator<Step> eRKi(tableau);
+        return eRKi.solve(f, time, y0, steps);
+
+    }
+
+    // explicit trapizoidal rule with convergece order 2
+    template <typename Step, typename Function> 
+    std::vector<Step> explicitTrapezoidalRule(Function f, double time, const Step &y0, unsigned int steps){
+
+        ButcherTableau tableau = ExplicitRKTableaus::explicitTrapezoidal();
+
+        ExplicitRungeKuttaIntegrator<Step> eRKi(tableau);
+        return eRKi.solve(f, time, y0, steps);
+
+    }
+
+    // explicit midpoint rule with convergence order 2
+    template <typename Step, typename Function>
+    std::vector<Step> explicitMidPointRule(Function f, double time, const Step &y0, unsigned int steps){
+
+        ButcherTableau tableau = ExplicitRKTableaus::explicitMidPoint();
+
+        ExplicitRungeKuttaIntegrator<Step> eRKi(tableau);
+        return eRKi.solve(f, time, y0, steps);
+
+    }
+
+    // classical 4-th order runge kutta single step method
+    template <typename Step, typename Function>
+    std::vector<Step> classical4thOrderRuleIntegrator(Function f, double time, const Step &y0, unsigned int steps){
+
+        ButcherTableau tableau = ExplicitRKTableaus::classical4thOrder();
+
+        ExplicitRungeKuttaIntegrator<Step> eRKi(tableau);
+        return eRKi.solve(f, time, y0, steps);
+
+    }
+
+    // kutta's 3/8-rule of order 4
+    template <typename Step, typename Function>
+    std::vector<Step> kuttas38thRule(Function f, double time, const Step &y0, unsigned int steps){
+
+        ButcherTableau tableau = ExplicitRKTableaus::kuttas38th();
+
+        ExplicitRungeKuttaIntegrator<Step> eRKi(tableau);
         return eRKi.solve(f, time, y0, steps);
 
     }
@@ -103,12 +167,323 @@ namespace ExplicitRKSolvers{
 }
 
 
-// collection of common implicit RK methods.
-namespace ImplicitRKSolvers{
+// the embedded pairs for AdaptiveRungeKuttaIntegrator, see rk_adaptive.hpp
+namespace EmbeddedRKTableaus{
+
+    // Bogacki and Shampine's method of order 3 with an estimator of order 2 (FSAL) and a cubic dense output
+    inline EmbeddedButcherTableau bogackiShampine32(){
+
+        Eigen::MatrixXd A(3,3);
+        A << 0, 0, 0,
+             1.0/2, 0, 0,
+             0, 3.0/4, 0;
+
+        Eigen::VectorXd b(3);
+        b << 2.0/9, 1.0/3, 4.0/9;
+
+        Eigen::VectorXd e(4);
+        e << 5.0/72, -1.0/12, -1.0/9, 1.0/8;
+
+        Eigen::MatrixXd P(4,3);
+        P << 1, -4.0/3, 5.0/9,
+             0, 1, -2.0/3,
+             0, 4.0/3, -8.0/9,
+             0, -1, 1;
+
+        return {"Bogacki-Shampine 3(2)", A, b, e, Eigen::VectorXd(), 3, 2, Eigen::MatrixXd(), P};
+
+    }
+
+    // Dormand and Prince's method of order 5 with an estimator of order 4 (FSAL) and Shampine's dense output of order 4
+    inline EmbeddedButcherTableau dormandPrince54(){
+
+        Eigen::MatrixXd A(6,6);
+        A << 0, 0, 0, 0, 0, 0,
+             1.0/5, 0, 0, 0, 0, 0,
+             3.0/40, 9.0/40, 0, 0, 0, 0,
+             44.0/45, -56.0/15, 32.0/9, 0, 0, 0,
+             19372.0/6561, -25360.0/2187, 64448.0/6561, -212.0/729, 0, 0,
+             9017.0/3168, -355.0/33, 46732.0/5247, 49.0/176, -5103.0/18656, 0;
+
+        Eigen::VectorXd b(6);
+        b << 35.0/384, 0, 500.0/1113, 125.0/192, -2187.0/6784, 11.0/84;
+
+        Eigen::VectorXd e(7);
+        e << -71.0/57600, 0, 71.0/16695, -71.0/1920, 17253.0/339200, -22.0/525, 1.0/40;
+
+        Eigen::MatrixXd P(7,4);
+        P << 1, -8048581381.0/2820520608, 8663915743.0/2820520608, -12715105075.0/11282082432,
+             0, 0, 0, 0,
+             0, 131558114200.0/32700410799, -68118460800.0/10900136933, 87487479700.0/32700410799,
+             0, -1754552775.0/470086768, 14199869525.0/1410260304, -10690763975.0/1880347072,
+             0, 127303824393.0/49829197408, -318862633887.0/49829197408, 701980252875.0/199316789632,
+             0, -282668133.0/205662961, 2019193451.0/616988883, -1453857185.0/822651844,
+             0, 40617522.0/29380423, -110615467.0/29380423, 69997945.0/29380423;
+
+        return {"Dormand-Prince 5(4)", A, b, e, Eigen::VectorXd(), 5, 4, Eigen::MatrixXd(), P};
+
+    }
+
+    // Dormand and Prince's method of order 8 with estimators of order 5 and 3 and a dense output of order 7 (DOP853 of
+    // Hairer, Norsett, Wanner). The coefficients are the ones of the Fortran code, the dense output is written as b_i(theta).
+    inline EmbeddedButcherTableau dop853(){
+
+        Eigen::MatrixXd A = Eigen::MatrixXd::Zero(12,12);
+        A(1,0) = 5.26001519587677318785587544488e-2;
+        A(2,0) = 1.97250569845378994544595329183e-2; A(2,1) = 5.91751709536136983633785987549e-2;
+        A(3,0) = 2.95875854768068491816892993775e-2; A(3,2) = 8.87627564304205475450678981324e-2;
+        A(4,0) = 2.41365134159266685502369798665e-1; A(4,2) = -8.84549479328286085344864962717e-1; A(4,3) = 9.24834003261792003115737966543e-1;
+        A(5,0) = 3.7037037037037037037037037037e-2; A(5,3) = 1.70828608729473871279604482173e-1; A(5,4) = 1.25467687566822425016691814123e-1;
+        A(6,0) = 3.7109375e-2; A(6,3) = 1.70252211019544039314978060272e-1; A(6,4) = 6.02165389804559606850219397283e-2; A(6,5) = -1.7578125e-2;
+        A(7,0) = 3.70920001185047927108779319836e-2; A(7,3) = 1.70383925712239993810214054705e-1; A(7,4) = 1.07262030446373284651809199168e-1; A(7,5) = -1.53194377486244017527936158236e-2; A(7,6) = 8.27378916381402288758473766002e-3;
+        A(8,0) = 6.24110958716075717114429577812e-1; A(8,3) = -3.36089262944694129406857109825; A(8,4) = -8.68219346841726006818189891453e-1; A(8,5) = 2.75920996994467083049415600797e1; A(8,6) = 2.01540675504778934086186788979e1; A(8,7) = -4.34898841810699588477366255144e1;
+        A(9,0) = 4.77662536438264365890433908527e-1; A(9,3) = -2.48811461997166764192642586468; A(9,4) = -5.90290826836842996371446475743e-1; A(9,5) = 2.12300514481811942347288949897e1; A(9,6) = 1.52792336328824235832596922938e1; A(9,7) = -3.32882109689848629194453265587e1; A(9,8) = -2.03312017085086261358222928593e-2;
+        A(10,0) = -9.3714243008598732571704021658e-1; A(10,3) = 5.18637242884406370830023853209; A(10,4) = 1.09143734899672957818500254654; A(10,5) = -8.14978701074692612513997267357; A(10,6) = -1.85200656599969598641566180701e1; A(10,7) = 2.27394870993505042818970056734e1; A(10,8) = 2.49360555267965238987089396762; A(10,9) = -3.0467644718982195003823669022;
+        A(11,0) = 2.27331014751653820792359768449; A(11,3) = -1.05344954667372501984066689879e1; A(11,4) = -2.00087205822486249909675718444; A(11,5) = -1.79589318631187989172765950534e1; A(11,6) = 2.79488845294199600508499808837e1; A(11,7) = -2.85899827713502369474065508674; A(11,8) = -8.87285693353062954433549289258; A(11,9) = 1.23605671757943030647266201528e1; A(11,10) = 6.43392746015763530355970484046e-1;
+
+        Eigen::VectorXd b(12);
+        b << 5.42937341165687622380535766363e-2, 0, 0, 0, 0, 4.45031289275240888144113950566, 1.89151789931450038304281599044, -5.8012039600105847814672114227, 3.1116436695781989440891606237e-1, -1.52160949662516078556178806805e-1, 2.01365400804030348374776537501e-1, 4.47106157277725905176885569043e-2;
+
+        Eigen::VectorXd e(13);
+        e << 0.1312004499419488073250102996e-1, 0, 0, 0, 0, -0.1225156446376204440720569753e+1, -0.4957589496572501915214079952, 0.1664377182454986536961530415e+1, -0.3503288487499736816886487290, 0.3341791187130174790297318841, 0.8192320648511571246570742613e-1, -0.2235530786388629525884427845e-1, 0;
+
+        Eigen::VectorXd e3(13);
+        e3 << -0.18980075407240762, 0, 0, 0, 0, 4.450312892752409, 1.8915178993145003, -5.801203960010585, -0.4226823213237919, -0.1521609496625161, 0.20136540080403034, 0.02265179219836082, 0;
+
+        Eigen::MatrixXd denseA = Eigen::MatrixXd::Zero(3,16);
+        denseA(0,0) = 5.61675022830479523392909219681e-2; denseA(0,6) = 2.53500210216624811088794765333e-1; denseA(0,7) = -2.46239037470802489917441475441e-1; denseA(0,8) = -1.24191423263816360469010140626e-1; denseA(0,9) = 1.5329179827876569731206322685e-1; denseA(0,10) = 8.20105229563468988491666602057e-3; denseA(0,11) = 7.56789766054569976138603589584e-3; denseA(0,12) = -8.298e-3;
+        denseA(1,0) = 3.18346481635021405060768473261e-2; denseA(1,5) = 2.83009096723667755288322961402e-2; denseA(1,6) = 5.35419883074385676223797384372e-2; denseA(1,7) = -5.49237485713909884646569340306e-2; denseA(1,10) = -1.08347328697249322858509316994e-4; denseA(1,11) = 3.82571090835658412954920192323e-4; denseA(1,12) = -3.40465008687404560802977114492e-4; denseA(1,13) = 1.41312443674632500278074618366e-1;
+        denseA(2,0) = -4.28896301583791923408573538692e-1; denseA(2,5) = -4.69762141536116384314449447206; denseA(2,6) = 7.68342119606259904184240953878; denseA(2,7) = 4.06898981839711007970213554331; denseA(2,8) = 3.56727187455281109270669543021e-1; denseA(2,12) = -1.39902416515901462129418009734e-3; denseA(2,13) = 2.9475147891527723389556272149; denseA(2,14) = -9.15095847217987001081870187138;
+
+        Eigen::MatrixXd P(16,7);
+        P.row(0) << 1.0, -10.266057073759306, 48.161850968566455, -114.93304874997833, 147.46446875669767, -97.06685363011368, 25.69393346270375;
+        P.row(1) << 0, 0, 0, 0, 0, 0, 0;
+        P.row(2) << 0, 0, 0, 0, 0, 0, 0;
+        P.row(3) << 0, 0, 0, 0, 0, 0, 0;
+        P.row(4) << 0, 0, 0, 0, 0, 0, 0;
+        P.row(5) << 0, 13.917653631776604, -154.78787266663716, 522.9219089608218, -456.25918840208783, -75.53193732135753, 154.18974869023643;
+        P.row(6) << 0, 2.6056037519936095, -21.622822384626506, 2.535182028966755, 292.25417465990404, -505.40999933296894, 231.5293791760455;
+        P.row(7) << 0, -15.018944223519684, 160.09447708973047, -474.3071826037644, 135.96036916173838, 545.1091945264187, -357.6391179106141;
+        P.row(8) << 0, 3.050527683318488, -38.54396729189063, 174.47140009219885, -337.0513470238771, 291.78987509083254, -93.40532418362432;
+        P.row(9) << 0, -1.3278744327655212, 16.661770430049543, -74.44027814126304, 140.75210016191608, -119.2562021040512, 37.45832313645163;
+        P.row(10) << 0, 2.844533632672879, -36.55829548991012, 170.69007169147514, -345.9748485480496, 313.299553623578, -104.0996495089623;
+        P.row(11) << 0, 0.7657106259527866, -9.906995535619366, 46.8029919188744, -96.5198694669957, 88.74316650017616, -29.8402934266605;
+        P.row(12) << 0, -1.0889903364513334, 14.097013042320002, -66.68230591294363, 137.96299063474376, -127.82216401767992, 43.53345659001114;
+        P.row(13) << 0, 18.148505520854727, -127.63310949253875, 357.3419516129657, -500.7031507909224, 349.17035710882897, -96.32455395918828;
+        P.row(14) << 0, -9.194632392478356, 93.3567459327894, -282.6272618704363, 361.14007718803333, -201.85219053352347, 39.17726167561544;
+        P.row(15) << 0, -4.436036387594894, 56.68120539776666, -261.77342902691703, 520.9742236688993, -461.17279991013964, 149.72683625798564;
+
+        return {"DOP853", A, b, e, e3, 8, 7, denseA, P};
+
+    }
+
+    // Verner's "most efficient" method of order 6 with an estimator of order 5 (FSAL) and a dense output of order 5,
+    // the dense output needs one extra stage
+    inline EmbeddedButcherTableau verner65(){
+
+        Eigen::MatrixXd A = Eigen::MatrixXd::Zero(8,8);
+        A(1,0) = 0.06;
+        A(2,0) = 0.019239962962962962; A(2,1) = 0.07669337037037037;
+        A(3,0) = 0.035975; A(3,2) = 0.107925;
+        A(4,0) = 1.3186834152331484; A(4,2) = -5.042058063628562; A(4,3) = 4.220674648395414;
+        A(5,0) = -41.872591664327516; A(5,2) = 159.4325621631375; A(5,3) = -122.11921356501003; A(5,4) = 5.531743066200054;
+        A(6,0) = -54.430156935316504; A(6,2) = 207.06725136501848; A(6,3) = -158.61081378459; A(6,4) = 6.991816585950242; A(6,5) = -0.018597231062203234;
+        A(7,0) = -54.66374178728198; A(7,2) = 207.95280625538936; A(7,3) = -159.2889574744995; A(7,4) = 7.018743740796944; A(7,5) = -0.018338785905045722; A(7,6) = -0.0005119484997882099;
+
+        Eigen::VectorXd b(8);
+        b << 0.03438957868357036, 0, 0, 0.2582624555633503, 0.4209371189673537, 4.40539646966931, -176.48311902429865, 172.36413340141507;
+
+        Eigen::VectorXd e(9);
+        e << 0.002587021284660256, 0, 0, -0.005830208985945813, 0.008535021776411396, -0.6329133183195873, 31.037562869989195, -30.419941385744735, 0.01;
+
+        Eigen::MatrixXd denseA = Eigen::MatrixXd::Zero(1,10);
+        denseA(0,0) = 0.01176734028482295; denseA(0,3) = 0.3160329653003918; denseA(0,4) = 0.19142654244624643; denseA(0,5) = -0.13012608454015911; denseA(0,6) = 0.05036511727579873; denseA(0,7) = 0.054091333270383415; denseA(0,8) = 0.006442785962515752;
+
+        Eigen::MatrixXd P(10,5);
+        P.row(0) << 0.9970628963314967, -5.471134065432124, 10.951955199617226, -9.262755379265922, 2.8192609274328957;
+        P.row(1) << 0, 0, 0, 0, 0;
+        P.row(2) << 0, 0, 0, 0, 0;
+        P.row(3) << 0.006619167883271289, 6.639313118412185, -17.762101777910058, 16.771812377517996, -5.397380430340043;
+        P.row(4) << -0.009690002907550739, 6.338844328677944, -22.094500279521935, 27.46126309294707, -11.274980020228176;
+        P.row(5) << 0.7185607788013189, 4.324712374156165, -22.74567228154145, 40.8915446424861, -18.78374904423283;
+        P.row(6) << -35.23764582355151, -36.49705911248909, -26.81717858071627, -49.775263240185616, -28.15597226735617;
+        P.row(7) << 34.53644620920079, 33.17622943601785, 43.61506657641506, 18.869831418869254, 42.16655976091212;
+        P.row(8) << -0.011353225757819874, -0.5109060793429289, 2.852431143657428, -4.95643291236888, 2.6262610738122016;
+        P.row(9) << 0, -8.0, 32.0, -40.0, 16.0;
+
+        return {"Verner 6(5)", A, b, e, Eigen::VectorXd(), 6, 5, denseA, P};
+
+    }
+
+    // Verner's "most efficient" method of order 7 with an estimator of order 6 (the last stage is only used by the
+    // estimator) and a dense output of order 6, the dense output needs two extra stages
+    inline EmbeddedButcherTableau verner76(){
+
+        Eigen::MatrixXd A = Eigen::MatrixXd::Zero(10,10);
+        A(1,0) = 0.005;
+        A(2,0) = -1.07679012345679; A(2,1) = 1.185679012345679;
+        A(3,0) = 0.04083333333333333; A(3,2) = 0.1225;
+        A(4,0) = 0.6389139236255726; A(4,2) = -2.455672638223657; A(4,3) = 2.272258714598084;
+        A(5,0) = -2.6615773750187572; A(5,2) = 10.804513886456137; A(5,3) = -8.3539146573962; A(5,4) = 0.820487594956657;
+        A(6,0) = 6.067741434696771; A(6,2) = -24.711273635911084; A(6,3) = 20.427517930788895; A(6,4) = -1.9061579788166472; A(6,5) = 1.006172249242068;
+        A(7,0) = 12.054670076253203; A(7,2) = -49.75478495046899; A(7,3) = 41.142888638604674; A(7,4) = -4.461760149974004; A(7,5) = 2.042334822239175; A(7,6) = -0.09834843665406108;
+        A(8,0) = 10.138146522881808; A(8,2) = -42.6411360317175; A(8,3) = 35.76384003992257; A(8,4) = -4.3480228403929075; A(8,5) = 2.0098622683770357; A(8,6) = 0.3487490460338272; A(8,7) = -0.27143900510483127;
+        A(9,0) = -45.030072034298676; A(9,2) = 187.3272437654589; A(9,3) = -154.02882369350186; A(9,4) = 18.56465306347536; A(9,5) = -7.141809679295079; A(9,6) = 1.3088085781613785;
+
+        Eigen::VectorXd b(10);
+        b << 0.04715561848627222, 0, 0, 0.25750564298434153, 0.2621665397741262, 0.15216092656738558, 0.49399691700324844, -0.29430311714032503, 0.0813174723249511, 0;
+
+        Eigen::VectorXd e(11);
+        e << -0.0025470118799310456, 0, 0, 0.00965839487279575, -0.0420647097563969, 0.0666822437469301, -0.26500974646212816, 0.29430311714032503, -0.0813174723249511, 0.020295184663356284, 0;
+
+        Eigen::MatrixXd denseA = Eigen::MatrixXd::Zero(2,13);
+        denseA(0,0) = 0.04935344162716101; denseA(0,3) = 0.2438913338130126; denseA(0,4) = 0.06074107236984186; denseA(0,5) = -0.023254265531207758; denseA(0,6) = -0.0006325531528959077; denseA(0,7) = 0.005986934415802209; denseA(0,8) = 0.0016235423696241789; denseA(0,9) = 0.0038542800968922727; denseA(0,10) = -0.00823045267489712;
+        denseA(1,0) = 0.06563239092891009; denseA(1,3) = 0.17182101851995318; denseA(1,4) = 0.14315715051438163; denseA(1,5) = 0.09565382197947332; denseA(1,6) = 0.021141111596294174; denseA(1,7) = 0.009822190403189636; denseA(1,8) = -0.010816752217390807; denseA(1,9) = -0.0008173283283477226; denseA(1,10) = -0.003774615764481049; denseA(1,11) = 0.1748476790346842;
+
+        Eigen::MatrixXd P(13,6);
+        P.row(0) << 1.0005172639666402, -6.9412187371777625, 20.712959184295233, -29.649825320028224, 20.194332384560887, -5.269609157130499;
+        P.row(1) << 0, 0, 0, 0, 0, 0;
+        P.row(2) << 0, 0, 0, 0, 0, 0;
+        P.row(3) << -0.0019614905146865453, 14.955945235401817, -63.98896382516143, 105.011790160381, -76.2814016434423, 20.562097206319933;
+        P.row(4) << 0.008542778616622417, 9.069198754741182, -36.99574111421025, 56.40297164393527, -36.75784846644772, 8.535042943139025;
+        P.row(5) << -0.013542269738424852, 2.809684132795347, -4.575283872782744, -11.226789241071296, 26.226715671369156, -13.068623494004651;
+        P.row(6) << 0.053819926688758755, 0.29816544172034276, 4.809567817027313, -22.02607658253426, 29.91216157287581, -12.553641258774718;
+        P.row(7) << -0.059769017555846904, 0.1087582916198621, 2.6313356419072687, -13.09969565299891, 17.751023348751787, -7.625955728864486;
+        P.row(8) << 0.01651448845738763, -0.5423505537217761, 1.8344487407351981, -1.5034871438447288, -0.2939988137899766, 0.5701907544888469;
+        P.row(9) << -0.004121679920450593, -0.10818256537901151, 1.5716774281894068, -5.408887863838848, 6.649015946122355, -2.699501265173452;
+        P.row(10) << 0, 0.6, -7.0, 22.75, -27.9, 11.55;
+        P.row(11) << 0, -16.2, 81.0, -141.75, 105.3, -28.35;
+        P.row(12) << 0, -4.05, 0, 40.5, -64.8, 28.35;
+
+        return {"Verner 7(6)", A, b, e, Eigen::VectorXd(), 7, 6, denseA, P};
+
+    }
+
+    // Verner's "most efficient" method of order 8 with an estimator of order 7 (the last stage is only used by the
+    // estimator) and a dense output of order 7, the dense output needs three extra stages
+    inline EmbeddedButcherTableau verner87(){
+
+        Eigen::MatrixXd A = Eigen::MatrixXd::Zero(13,13);
+        A(1,0) = 0.05;
+        A(2,0) = -0.0069931640625; A(2,1) = 0.1135556640625;
+        A(3,0) = 0.0399609375; A(3,2) = 0.1198828125;
+        A(4,0) = 0.36139756280045754; A(4,2) = -1.3415240667004928; A(4,3) = 1.3701265039000352;
+        A(5,0) = 0.049047202797202795; A(5,3) = 0.23509720422144048; A(5,4) = 0.18085559298135673;
+        A(6,0) = 0.06169289044289044; A(6,3) = 0.11236568314640277; A(6,4) = -0.03885046071451367; A(6,5) = 0.01979188712522046;
+        A(7,0) = -1.767630240222327; A(7,3) = -62.5; A(7,4) = -6.061889377376669; A(7,5) = 5.6508231982227635; A(7,6) = 65.62169641937624;
+        A(8,0) = -1.1809450665549708; A(8,3) = -41.50473441114321; A(8,4) = -4.434438319103725; A(8,5) = 4.260408188586133; A(8,6) = 43.75364022446172; A(8,7) = 0.00787142548991231;
+        A(9,0) = -1.2814059994414884; A(9,3) = -45.047139960139866; A(9,4) = -4.731362069449577; A(9,5) = 4.514967016593808; A(9,6) = 47.44909557172985; A(9,7) = 0.010592282971116612; A(9,8) = -0.0057468422638446166;
+        A(10,0) = -1.7244701342624853; A(10,3) = -60.92349008483054; A(10,4) = -5.951518376222393; A(10,5) = 5.556523730698456; A(10,6) = 63.98301198033305; A(10,7) = 0.014642028250414961; A(10,8) = 0.06460408772358203; A(10,9) = -0.0793032316900888;
+        A(11,0) = -3.301622667747079; A(11,3) = -118.01127235975251; A(11,4) = -10.141422388456112; A(11,5) = 9.139311332232058; A(11,6) = 123.37594282840426; A(11,7) = 4.62324437887458; A(11,8) = -3.3832777380682018; A(11,9) = 4.527592100324618; A(11,10) = -5.828495485811623;
+        A(12,0) = -3.039515033766309; A(12,3) = -109.26086808941763; A(12,4) = -9.290642497400293; A(12,5) = 8.43050498176491; A(12,6) = 114.20100103783314; A(12,7) = -0.9637271342145479; A(12,8) = -5.0348840888021895; A(12,9) = 5.958130824002923;
+
+        Eigen::VectorXd b(13);
+        b << 0.04427989419007951, 0, 0, 0, 0, 0.3541049391724449, 0.2479692154956438, -15.694202038838084, 25.084064965558564, -31.738367786260277, 22.938283273988784, -0.2361324633071542, 0;
+
+        Eigen::VectorXd e(14);
+        e << 3.2721039010281375e-05, 0, 0, 0, 0, 0.0005046250618777704, -0.0001211723589784759, 20.142336771313868, -5.2371785994398286, 8.156744408794658, -22.938283273988784, 0.2361324633071542, -0.36016794372897754, 0;
+
+        Eigen::MatrixXd denseA = Eigen::MatrixXd::Zero(3,17);
+        denseA(0,0) = 0.04476954538012782; denseA(0,3) = 0.06097506157846564; denseA(0,4) = 0.027565238741970415; denseA(0,5) = 0.024828740740425487; denseA(0,6) = 0.18178446730730824; denseA(0,7) = 0.060393686871886024; denseA(0,8) = -0.04268358522631121; denseA(0,9) = -0.04180274588624563; denseA(0,10) = 0.04377761932550481; denseA(0,11) = -0.16705039742437733; denseA(0,12) = 0.15381640143913; denseA(0,13) = -0.013040699514550917;
+        denseA(1,0) = 0.05207714972210153; denseA(1,3) = 0.12773258797848677; denseA(1,4) = 0.035893188344137315; denseA(1,5) = 0.08120810485231302; denseA(1,6) = 0.08503033923190556; denseA(1,7) = -0.028699219126655486; denseA(1,8) = 0.01870385949092118; denseA(1,9) = 0.017237457987149592; denseA(1,10) = -0.02162274265646121; denseA(1,11) = 0.07088001585815494; denseA(1,12) = -0.0629295344486589; denseA(1,13) = 0.007573346144603097; denseA(1,14) = 0.11691544662200262;
+        denseA(2,0) = 0.047913185909568966; denseA(2,3) = 0.12035934958470257; denseA(2,4) = 0.06421619442653599; denseA(2,5) = 0.08495290011976829; denseA(2,6) = 0.12023814028799944; denseA(2,7) = -0.020133072148498625; denseA(2,8) = 0.03675461676857788; denseA(2,9) = 0.026612984596885464; denseA(2,10) = -0.01616742176554866; denseA(2,11) = 0.015441672330563204; denseA(2,12) = -0.017806277990851584; denseA(2,13) = -0.0033678914880620647; denseA(2,14) = 0.008689005041056087; denseA(2,15) = 0.19896328099396973;
+
+        Eigen::MatrixXd P(17,7);
+        P.row(0) << 0.9999943844804048, -7.758422242106383, 29.418536733046675, -60.8696663962452, 70.11030130964558, -42.18348896524277, 10.327025070611775;
+        P.row(1) << 0, 0, 0, 0, 0, 0, 0;
+        P.row(2) << 0, 0, 0, 0, 0, 0, 0;
+        P.row(3) << 0, 0, 0, 0, 0, 0, 0;
+        P.row(4) << 0, 0, 0, 0, 0, 0, 0;
+        P.row(5) << -8.660274884084873e-05, 22.625598052428522, -147.95903044306206, 411.1504923915148, -584.0891764574424, 415.91668631766316, -117.29037831918075;
+        P.row(6) << 2.0795359096944576e-05, 17.814661036400786, -103.39952752694575, 258.1653978704369, -330.3007972055056, 212.36528319184802, -54.39706894609781;
+        P.row(7) << -3.4567877504593874, 64.16490067739659, -804.024369780476, 3284.6815696413755, -6211.716885263868, 5472.333388596176, -1817.6760181589818;
+        P.row(8) << 0.898794168474761, 172.46786245425807, -1878.5951487112732, 7478.726357242513, -13884.471180365927, 12129.834029285428, -3993.7766491079146;
+        P.row(9) << -1.3998442423078532, -188.69184265180655, 2127.9576859080116, -8606.833927667582, 16110.948493726732, -14144.340612372655, 4670.621679513347;
+        P.row(10) << 3.9366225249008027, -42.39197889480048, 486.6425996609757, -1873.839910483075, 3448.144310249709, -2982.656555666049, 983.1031958823276;
+        P.row(11) << -0.04052458341419775, 1.862205414475759, -8.36729239389869, 9.213168710314296, 4.862753882267545, -13.481963010183959, 5.715519517132091;
+        P.row(12) << 0.06181130571521387, -2.756708816499208, 33.64301152490828, -135.77864239587555, 256.3250746997146, -228.20430830164472, 76.7097619836814;
+        P.row(13) << 0, -0.48843422333953396, 7.412141678319769, -33.46491874707173, 66.53311685137098, -60.87787305810817, 20.88596749882869;
+        P.row(14) << 0, -25.55843190241793, 195.28177057983913, -571.727258366727, 811.8508329500236, -561.854813607133, 152.00790034641523;
+        P.row(15) << 0, 0.14108837065147098, -37.668105843476944, 186.45935094203176, -335.0624782130513, 260.7138851206577, -74.58374037681271;
+        P.row(16) << 0, -11.430497274641093, 99.65772861403134, -345.8820127416088, 576.8656338363314, -457.5636575307564, 138.35280509664352;
+
+        return {"Verner 8(7)", A, b, e, Eigen::VectorXd(), 8, 7, denseA, P};
+
+    }
+
+    // Verner's "most efficient" method of order 9 with an estimator of order 8 (the last stage is only used by the
+    // estimator) and a dense output of order 8, the dense output needs four extra stages
+    inline EmbeddedButcherTableau verner98(){
+
+        Eigen::MatrixXd A = Eigen::MatrixXd::Zero(16,16);
+        A(1,0) = 0.03462;
+        A(2,0) = -0.038933543885728734; A(2,1) = 0.13595789452450918;
+        A(3,0) = 0.03638413148954267; A(3,2) = 0.109152394468628;
+        A(4,0) = 2.02576391439397; A(4,2) = -7.638023836496292; A(4,3) = 6.173259922102322;
+        A(5,0) = 0.05112275589406061; A(5,3) = 0.17708237945550215; A(5,4) = 0.0008027762409222502;
+        A(6,0) = 0.13160063579752163; A(6,3) = -0.29572762526696367; A(6,4) = 0.08781378035642952; A(6,5) = 0.6213052975225275;
+        A(7,0) = 0.07166666666666667; A(7,5) = 0.33055335789153195; A(7,6) = 0.24277997544180138;
+        A(8,0) = 0.071806640625; A(8,5) = 0.3294380283228177; A(8,6) = 0.11651900292718229; A(8,7) = -0.034013671875;
+        A(9,0) = 0.04836757646340647; A(9,5) = 0.03928989925676164; A(9,6) = 0.10547409458903446; A(9,7) = -0.021438652846483126; A(9,8) = -0.10412291746271944;
+        A(10,0) = -0.026645614872014785; A(10,5) = 0.03333333333333333; A(10,6) = -0.1631072244872467; A(10,7) = 0.033960816841277615; A(10,8) = 0.1572319413814626; A(10,9) = 0.21522674780318796;
+        A(11,0) = 0.036890092487086225; A(11,5) = -0.1465181576725543; A(11,6) = 0.22425777681720244; A(11,7) = 0.022944057170660725; A(11,8) = -0.003585005290572876; A(11,9) = 0.08669223316444385; A(11,10) = 0.43838406519683376;
+        A(12,0) = -0.48660122151133406; A(12,5) = -6.304602650282853; A(12,6) = -0.2812456182894726; A(12,7) = -2.6790192362198493; A(12,8) = 0.5188156639241576; A(12,9) = 1.3653531876033418; A(12,10) = 5.8850910885039465; A(12,11) = 2.8028087862720628;
+        A(13,0) = 0.41853674577534716; A(13,5) = 6.724547581906459; A(13,6) = -0.4254442801646118; A(13,7) = 3.3432791530012658; A(13,8) = 0.6170816631175378; A(13,9) = -0.9299661239399328; A(13,10) = -6.099948804751011; A(13,11) = -3.002206187889399; A(13,12) = 0.2553202529443446;
+        A(14,0) = -0.7793740861228846; A(14,5) = -13.937342538107776; A(14,6) = 1.2520488533793572; A(14,7) = -14.69150040801687; A(14,8) = -0.4947050585331417; A(14,9) = 2.2429749091462368; A(14,10) = 13.367893803828643; A(14,11) = 14.396650486650687; A(14,12) = -0.79758133317768; A(14,13) = 0.4409353709534278;
+        A(15,0) = 2.0580513374668863; A(15,5) = 22.357937727968032; A(15,6) = 0.9094981099755634; A(15,7) = 35.89110098240264; A(15,8) = -3.4425150276244536; A(15,9) = -4.8654813580363685; A(15,10) = -18.909803813543427; A(15,11) = -34.26354448030452; A(15,12) = 1.2647565216956427;
+
+        Eigen::VectorXd b(16);
+        b << 0.014611976858423152, 0, 0, 0, 0, 0, 0, -0.3915211862331339, 0.23109325002895065, 0.12747667699928525, 0.2246434176204158, 0.5684352689748513, 0.058258715572158275, 0.13643174034822156, 0.030570139830827976, 0;
+
+        Eigen::VectorXd e(17);
+        e << 0.005357988290444578, 0, 0, 0, 0, 0, 0, 2.583020491182464, -0.14252253154686625, -0.013420653512688676, 0.028672962914094935, -2.624999655215792, 0.2825509643291537, -0.13643174034822156, -0.030570139830827976, 0.048342313738239585, 0;
+
+        Eigen::MatrixXd denseA = Eigen::MatrixXd::Zero(4,21);
+        denseA(0,0) = 0.016381900033109287; denseA(0,5) = -0.19016502180994624; denseA(0,6) = 0.07368374621225826; denseA(0,7) = 0.5336923681491819; denseA(0,8) = -0.16759654119781772; denseA(0,9) = 0.13205261284622175; denseA(0,10) = 0.29221000633278765; denseA(0,11) = -0.49875762313540034; denseA(0,12) = 0.008498552569605433; denseA(0,14) = -0.003; denseA(0,15) = 0.002; denseA(0,16) = 0.001;
+        denseA(1,0) = 0.040841363971033655; denseA(1,5) = -0.03590895257062882; denseA(1,6) = 0.06683337561449884; denseA(1,7) = 0.39390157766808104; denseA(1,8) = -0.05951493760967479; denseA(1,9) = 0.06537998774714897; denseA(1,10) = 0.22655475681976275; denseA(1,11) = -0.3954718748060003; denseA(1,12) = 0.0043847031657786644; denseA(1,13) = 0.009; denseA(1,14) = 0.005; denseA(1,15) = -0.004; denseA(1,16) = -0.004; denseA(1,17) = 0.087;
+        denseA(2,0) = 0.031535326171666864; denseA(2,5) = 0.010901496548347028; denseA(2,6) = 0.13058233365982713; denseA(2,7) = 0.4468709443698095; denseA(2,8) = -0.033332119648556584; denseA(2,9) = 0.08749300623223977; denseA(2,10) = 0.16597791325614586; denseA(2,11) = -0.41876959830506205; denseA(2,12) = 0.0007406977155824486; denseA(2,13) = 0.01; denseA(2,14) = 0.002; denseA(2,15) = -0.014; denseA(2,16) = 0.009; denseA(2,17) = 0.061; denseA(2,18) = 0.11;
+        denseA(3,0) = 0.06342158288013737; denseA(3,5) = 0.11985753007193792; denseA(3,6) = 0.0650782157378874; denseA(3,7) = 0.4417143496186107; denseA(3,8) = 0.004161734941847359; denseA(3,9) = 0.014199011970954618; denseA(3,10) = 0.10101880468675574; denseA(3,11) = -0.2657488294023144; denseA(3,12) = 0.05129759949418331; denseA(3,13) = 0.002; denseA(3,14) = -0.049; denseA(3,15) = 0.005; denseA(3,16) = 0.042; denseA(3,17) = 0.09; denseA(3,18) = 0.049; denseA(3,19) = 0.066;
+
+        Eigen::MatrixXd P(21,8);
+        P.row(0) << 0.9998738611929633, -14.047636678181036, 85.64157764117246, -276.99372917762213, 510.4480929593482, -537.4940557259617, 300.8189254150564, -69.3584363181467;
+        P.row(1) << 0, 0, 0, 0, 0, 0, 0, 0;
+        P.row(2) << 0, 0, 0, 0, 0, 0, 0, 0;
+        P.row(3) << 0, 0, 0, 0, 0, 0, 0, 0;
+        P.row(4) << 0, 0, 0, 0, 0, 0, 0, 0;
+        P.row(5) << 0, 0, 0, 0, 0, 0, 0, 0;
+        P.row(6) << 0, 0, 0, 0, 0, 0, 0, 0;
+        P.row(7) << -0.060809973006160846, -1.1770181343967532, 9.876491671488825, 9.540386363655173, -160.5795920535067, 348.38933743872417, -296.0755397619046, 89.69522326271299;
+        P.row(8) << 0.0033552932799875436, 0.6798701310693089, 39.47495363421336, -301.70499203150246, 868.3929529189708, -1203.1580579513097, 808.2097134324229, -211.66670217711507;
+        P.row(9) << 0.00031595164677072874, 20.600949735819842, -173.9747474046527, 641.9152973248478, -1268.4049874923562, 1393.610182309504, -802.3921361855644, 188.77260243775424;
+        P.row(10) << -0.0006750244942944963, 8.264986093268227, -54.78164013362773, 193.5159479087828, -410.4325801058941, 510.38663820119973, -337.39527433714727, 90.66724081553299;
+        P.row(11) << 0.061798254686620646, -0.8072006267831933, 5.804239601139738, 31.633224466692063, -214.55641929656224, 417.48529102601196, -340.0850620259597, 101.0325638697496;
+        P.row(12) << -0.006651869999627823, 1.8731963266375455, -8.72156319411046, 3.691820608754087, 51.83181984090031, -124.75598181884753, 112.36597751938936, -36.22035869715153;
+        P.row(13) << 0.0032119026837301393, -1.788118466846512, 24.257548241570635, -123.7751338136751, 321.4967482765421, -452.287652578227, 325.5818301668218, -93.3520019885215;
+        P.row(14) << 0.0007196882038888535, -0.23029761563482332, 5.320002961141841, -35.01376345587532, 105.72324542538597, -162.80037367330243, 123.48188116700365, -36.45084435709196;
+        P.row(15) << -0.0011380841938779837, 0.7429984793391029, -5.220409837672977, 12.982703146860272, -10.791724365853241, -5.721023077719798, 13.578721256080305, -5.5701275168397855;
+        P.row(16) << 0, -0.1915199832549505, -4.918250459391324, 48.577270999806494, -168.28357732555168, 277.2160266943278, -219.15003321474018, 66.75008328880385;
+        P.row(17) << 0, -15.304686404647157, 177.2284887904045, -781.1264773091646, 1732.8757261069018, -2069.4371616466015, 1270.4387286850163, -314.6746182219095;
+        P.row(18) << 0, 0.8956126845673981, -82.09744720502495, 573.7928831402838, -1578.2350152300276, 2109.32121705479, -1373.9953610629125, 350.31811061832366;
+        P.row(19) << 0, -0.3438088547582233, 10.107437890085249, -167.50804343301328, 686.9886817736193, -1162.23967453031, 885.0711411499383, -252.0757339955614;
+        P.row(20) << 0, 0.8326733138012227, -27.99668219673646, 170.4726052611704, -466.47337143191646, 661.4852882777216, -470.4535122035004, 132.1329989794601;
+
+        return {"Verner 9(8)", A, b, e, Eigen::VectorXd(), 9, 8, denseA, P};
+
+    }
+
+    // all of the above, e.g. to compare the methods
+    inline std::vector<EmbeddedButcherTableau> all(){
+        return {bogackiShampine32(), dormandPrince54(), dop853(), verner65(), verner76(), verner87(), verner98()};
+    }
+
+}
+
+
+// the butcher tableaus of the methods in ImplicitRKSolvers
+namespace ImplicitRKTableaus{
 
     // traditional implicit euler method with convergence order 1, L-stable
-    template <typename Step, typename Function, typename Jacobian> 
-    std::vector<Step> implicitEulerRule(Function f, Jacobian df, double time, const Step &y0, unsigned int steps){
+    inline ButcherTableau implicitEuler(){
 
         Eigen::MatrixXd A(1,1);
         A << 1;
@@ -116,33 +491,25 @@ namespace ImplicitRKSolvers{
         Eigen::VectorXd b(1);
         b << 1;
 
-        ImplicitRungeKuttaIntegrator<Step> iRKi(A,b);
-        return iRKi.solve(f, df, time, y0, steps);
+        return {"Implicit Euler", A, b, 1};
 
     }
 
-
     // implicit midpoint method, order 2
-    template <typename Step, typename Function, typename Jacobian> 
-    std::vector<Step> implicitMidpointRule(Function f, Jacobian df, double time, const Step &y0, unsigned int steps){
+    inline ButcherTableau implicitMidpoint(){
 
         Eigen::MatrixXd A(1,1);
-        A << 1;
+        A << 0.5;
         
         Eigen::VectorXd b(1);
         b << 1;
 
-        ImplicitRungeKuttaIntegrator<Step> iRKi(A,b);
-        return iRKi.solve(f, df, time, y0, steps);
+        return {"Implicit midpoint rule", A, b, 2};
 
     }
 
-
-
-
     // third order Radau RK-SSM with convergence, L-stable
-    template <typename Step, typename Function, typename Jacobian> 
-    std::vector<Step> radauRKSSMRule3(Function f, Jacobian df, double time, const Step &y0, unsigned int steps){
+    inline ButcherTableau radauRKSSM3(){
 
         Eigen::MatrixXd A(2,2);
         A << 5.0/12, -1.0/12,
@@ -151,32 +518,292 @@ namespace ImplicitRKSolvers{
         Eigen::VectorXd b(2);
         b << 3.0/4, 1.0/4;
 
-        ImplicitRungeKuttaIntegrator<Step> iRKi(A,b);
-        return iRKi.solve(f, df, time, y0, steps);
+        return {"Radau IIA order 3", A, b, 3};
 
     }
 
-
     // fifth order Radau RK-SSM with convergence, L-stable
-    // METHOD NOT VERIFIED
-    template <typename Step, typename Function, typename Jacobian> 
-    std::vector<Step> radauRKSSMRule5(Function f, Jacobian df, double time, const Step &y0, unsigned int steps){
+    inline ButcherTableau radauRKSSM5(){
 
         Eigen::MatrixXd A(3,3);
-        A << (88-7*std::sqrt(6))/360 , (196-169*std::sqrt(6))/1800 , (-2+3*std::sqrt(6))/225,
-            (196+169*std::sqrt(6))/1800 , (88+7*std::sqrt(6))/360 , (-2-3*std::sqrt(6))/225,
+        A << (88-7*std::sqrt(6))/360 , (296-169*std::sqrt(6))/1800 , (-2+3*std::sqrt(6))/225,
+            (296+169*std::sqrt(6))/1800 , (88+7*std::sqrt(6))/360 , (-2-3*std::sqrt(6))/225,
             (16-std::sqrt(6))/36, (16+std::sqrt(6))/36, 1.0/9;
         
         Eigen::VectorXd b(3);
         b << (16-std::sqrt(6))/36 , (16+std::sqrt(6))/36, 1.0/9; 
 
-        ImplicitRungeKuttaIntegrator<Step> iRKi(A,b);
+        return {"Radau IIA order 5", A, b, 5};
+
+    }
+
+    // all of the above, e.g. to compare the methods
+    inline std::vector<ButcherTableau> all(){
+        return {implicitEuler(), implicitMidpoint(), radauRKSSM3(), radauRKSSM5()};
+    }
+
+}
+
+
+// collection of common implicit RK methods.
+namespace ImplicitRKSolvers{
+
+    // traditional implicit euler method with convergence order 1, L-stable
+    template <typename Step, typename Function, typename Jacobian> 
+    std::vector<Step> implicitEulerRule(Function f, Jacobian df, double time, const Step &y0, unsigned int steps){
+
+        ImplicitRungeKuttaIntegrator<Step> iRKi(ImplicitRKTableaus::implicitEuler());
+        return iRKi.solve(f, df, time, y0, steps);
+
+    }
+
+
+    // implicit midpoint method, order 2
+    template <typename Step, typename Function, typename Jacobian> 
+    std::vector<Step> implicitMidpointRule(Function f, Jacobian df, double time, const Step &y0, unsigned int steps){
+
+        ImplicitRungeKuttaIntegrator<Step> iRKi(ImplicitRKTableaus::implicitMidpoint());
         return iRKi.solve(f, df, time, y0, steps);
 
     }
 
 
 
+
+    // third order Radau RK-SSM with convergence, L-stable
+    template <typename Step, typename Function, typename Jacobian> 
+    std::vector<Step> radauRKSSMRule3(Function f, Jacobian df, double time, const Step &y0, unsigned int steps){
+
+        ImplicitRungeKuttaIntegrator<Step> iRKi(ImplicitRKTableaus::radauRKSSM3());
+        return iRKi.solve(f, df, time, y0, steps);
+
+    }
+
+
+    // fifth order Radau RK-SSM with convergence, L-stable
+    template <typename Step, typename Function, typename Jacobian> 
+    std::vector<Step> radauRKSSMRule5(Function f, Jacobian df, double time, const Step &y0, unsigned int steps){
+
+        ImplicitRungeKuttaIntegrator<Step> iRKi(ImplicitRKTableaus::radauRKSSM5());
+        return iRKi.solve(f, df, time, y0, steps);
+
+    }
+
+
+
+}
+
+
+// the partitioned tableaus of symplectic methods for PartitionedRungeKuttaIntegrator, see rk_partitioned.hpp
+namespace SymplecticTableaus{
+
+    // Stoermer-Verlet in velocity form (kick, drift, kick) of order 2, one force evaluation per step
+    inline PartitionedButcherTableau velocityVerlet(){
+        return PartitionedButcherTableau::composition("Velocity Verlet", {1}, 2);
+    }
+
+    // Stoermer-Verlet in position form (drift, kick, drift) of order 2, one force evaluation per step
+    inline PartitionedButcherTableau positionVerlet(){
+        return PartitionedButcherTableau::splitting("Position Verlet", {0.5, 0.5}, {1, 0}, 2);
+    }
+
+    // Ruth's method of order 3 (not symmetric), three force evaluations per step
+    inline PartitionedButcherTableau ruth3(){
+        return PartitionedButcherTableau::splitting("Ruth 3rd order", {0, 2.0/3, -2.0/3, 1}, {7.0/24, 3.0/4, -1.0/24, 0}, 3);
+    }
+
+    // Forest and Ruth's method of order 4 in position form (drift first), three force evaluations per step
+    inline PartitionedButcherTableau forestRuth(){
+        const double theta = 1/(2 - std::cbrt(2.0));
+        return PartitionedButcherTableau::splitting("Forest-Ruth", {theta/2, (1 - theta)/2, (1 - theta)/2, theta/2}, {theta, 1 - 2*theta, theta, 0}, 4);
+    }
+
+    // Yoshida's triple jump composition of velocity Verlet of order 4, three force evaluations per step
+    inline PartitionedButcherTableau yoshida4(){
+        const double w1 = 1/(2 - std::cbrt(2.0));
+        const double w0 = 1 - 2*w1;
+        return PartitionedButcherTableau::composition("Yoshida 4th order", {w1, w0, w1}, 4);
+    }
+
+    // Yoshida's composition of velocity Verlet of order 6 (solution A), seven force evaluations per step
+    inline PartitionedButcherTableau yoshida6(){
+        const double w1 = -1.17767998417887, w2 = 0.235573213359357, w3 = 0.784513610477560;
+        const double w0 = 1 - 2*(w1 + w2 + w3);
+        return PartitionedButcherTableau::composition("Yoshida 6th order", {w3, w2, w1, w0, w1, w2, w3}, 6);
+    }
+
+    // Yoshida's composition of velocity Verlet of order 8 (solution D), fifteen force evaluations per step
+    inline PartitionedButcherTableau yoshida8(){
+        const double w1 = 0.102799849391985, w2 = -1.96061023297549, w3 = 1.93813913762276, w4 = -0.158240635368243,
+                     w5 = -1.44485223686048, w6 = 0.253693336566229, w7 = 0.914844246229740;
+        const double w0 = 1 - 2*(w1 + w2 + w3 + w4 + w5 + w6 + w7);
+        return PartitionedButcherTableau::composition("Yoshida 8th order", {w7, w6, w5, w4, w3, w2, w1, w0, w1, w2, w3, w4, w5, w6, w7}, 8);
+    }
+
+    // all of the above, e.g. to compare the methods
+    inline std::vector<PartitionedButcherTableau> all(){
+        return {velocityVerlet(), positionVerlet(), ruth3(), forestRuth(), yoshida4(), yoshida6(), yoshida8()};
+    }
+
 }
 
 
+// the tableaus for RungeKuttaNystromIntegrator, see rk_nystrom.hpp
+namespace RKNTableaus{
+
+    // Nystroem's method of order 4 with 3 stages (the classical 4th order method needs 4)
+    inline RungeKuttaNystromTableau nystrom4(){
+
+        Eigen::MatrixXd Abar(3,3);
+        Abar << 0, 0, 0,
+                1.0/8, 0, 0,
+                0, 1.0/2, 0;
+
+        Eigen::VectorXd bbar(3);
+        bbar << 1.0/6, 1.0/3, 0;
+
+        Eigen::VectorXd b(3);
+        b << 1.0/6, 2.0/3, 1.0/6;
+
+        Eigen::VectorXd c(3);
+        c << 0, 1.0/2, 1;
+
+        return {"Nystroem 4th order", Abar, bbar, b, c, 4, Eigen::VectorXd(), Eigen::VectorXd(), Eigen::VectorXd(), Eigen::VectorXd(), 4};
+
+    }
+
+    // Nystroem's method of order 5 with 4 stages (explicit Runge Kutta methods of order 5 need 6)
+    inline RungeKuttaNystromTableau nystrom5(){
+
+        Eigen::MatrixXd Abar(4,4);
+        Abar << 0, 0, 0, 0,
+                1.0/50, 0, 0, 0,
+                -1.0/27, 7.0/27, 0, 0,
+                3.0/10, -2.0/35, 9.0/35, 0;
+
+        Eigen::VectorXd bbar(4);
+        bbar << 14.0/336, 100.0/336, 54.0/336, 0;
+
+        Eigen::VectorXd b(4);
+        b << 14.0/336, 125.0/336, 162.0/336, 35.0/336;
+
+        Eigen::VectorXd c(4);
+        c << 0, 1.0/5, 2.0/3, 1;
+
+        return {"Nystroem 5th order", Abar, bbar, b, c, 5, Eigen::VectorXd(), Eigen::VectorXd(), Eigen::VectorXd(), Eigen::VectorXd(), 5};
+
+    }
+
+    // an embedded pair 6(4) with 6 stages, the last one is at q1 and reused in the next step, hence 5 evaluations per step.
+    // The weights satisfy bbar = b(1 - c) and the coefficients the simplifying assumption sum_i b_i Abar(i,j) = b_j (1 - c_j)^2/2,
+    // the remaining order conditions of the trees up to order 6 were checked in rational arithmetic
+    inline RungeKuttaNystromTableau rkn64(){
+
+        Eigen::MatrixXd Abar(6,6);
+        Abar << 0, 0, 0, 0, 0, 0,
+                1.0/50, 0, 0, 0, 0, 0,
+                -1.0/248, 4.0/31, 0, 0, 0, 0,
+                2006.0/14641, 5355.0/117128, 6783.0/58564, 0, 0, 0,
+                -11313.0/85000, 427.0/900, 28.0/1875, 9317.0/191250, 0, 0,
+                19.0/306, 925.0/3969, 31.0/216, 14641.0/269892, 25.0/3528, 0;
+
+        Eigen::VectorXd bbar(6);
+        bbar << 19.0/306, 925.0/3969, 31.0/216, 14641.0/269892, 25.0/3528, 0;
+
+        Eigen::VectorXd b(6);
+        b << 19.0/306, 4625.0/15876, 31.0/108, 161051.0/674730, 125.0/1764, 1.0/20;
+
+        Eigen::VectorXd c(6);
+        c << 0, 1.0/5, 1.0/2, 17.0/22, 9.0/10, 1;
+
+        // the differences to the embedded weights of order 4, which do not use the fifth stage
+        Eigen::VectorXd ebar(6);
+        ebar << 65.0/1683, -3700.0/43659, 155.0/2376, -3245.0/269892, -25.0/3528, 0;
+
+        Eigen::VectorXd e(6);
+        e << 65.0/1683, -4625.0/43659, 155.0/1188, -7139.0/134946, -125.0/1764, 2.0/33;
+
+        return {"Runge Kutta Nystroem 6(4)", Abar, bbar, b, c, 6, ebar, e, Eigen::VectorXd(), Eigen::VectorXd(), 4};
+
+    }
+
+    // all of the above, e.g. to compare the methods
+    inline std::vector<RungeKuttaNystromTableau> all(){
+        return {nystrom4(), nystrom5(), rkn64()};
+    }
+
+}
+
+
+// the additive tableaus for AdditiveRungeKuttaIntegrator, see rk_imex.hpp
+namespace IMEXTableaus{
+
+    // Kennedy and Carpenter's ARK3(2)4L[2]SA of order 3 with an estimator of order 2, the implicit part is L-stable and stiffly accurate
+    inline AdditiveButcherTableau ark324L2SA(){
+
+        const double gamma = 1767732205903.0/4055673282236;
+
+        Eigen::VectorXd b(4);
+        b << 1471266399579.0/7840856788654, -4482444167858.0/7529755066697, 11266239266428.0/11593286722821, gamma;
+
+        Eigen::MatrixXd AE(4,4);
+        AE << 0, 0, 0, 0,
+              1767732205903.0/2027836641118, 0, 0, 0,
+              5535828885825.0/10492691773637, 788022342437.0/10882634858940, 0, 0,
+              6485989280629.0/16251701735622, -4246266847089.0/9704473918619, 10755448449292.0/10357097424841, 0;
+
+        Eigen::MatrixXd AI(4,4);
+        AI << 0, 0, 0, 0,
+              gamma, gamma, 0, 0,
+              2746238789719.0/10658868560708, -640167445237.0/6845629431997, gamma, 0,
+              b(0), b(1), b(2), gamma;
+
+        // the embedded method of order 2
+        Eigen::VectorXd bhat(4);
+        bhat << 2756255671327.0/12835298489170, -10771552573575.0/22201958757719, 9247589265047.0/10645013368117, 2193209047091.0/5459859503100;
+
+        return {"ARK3(2)4L[2]SA", AE, AI, b, b - bhat, 3, 2};
+
+    }
+
+    // Kennedy and Carpenter's ARK4(3)6L[2]SA of order 4 with an estimator of order 3, the implicit part is L-stable and stiffly accurate
+    inline AdditiveButcherTableau ark436L2SA(){
+
+        Eigen::VectorXd b(6);
+        b << 82889.0/524892, 0, 15625.0/83664, 69875.0/102672, -2260.0/8211, 1.0/4;
+
+        Eigen::MatrixXd AE(6,6);
+        AE << 0, 0, 0, 0, 0, 0,
+              1.0/2, 0, 0, 0, 0, 0,
+              13861.0/62500, 6889.0/62500, 0, 0, 0, 0,
+              -116923316275.0/2393684061468, -2731218467317.0/15368042101831, 9408046702089.0/11113171139209, 0, 0, 0,
+              -451086348788.0/2902428689909, -2682348792572.0/7519795681897, 12662868775082.0/11960479115383, 3355817975965.0/11060851509271, 0, 0,
+              647845179188.0/3216320057751, 73281519250.0/8382639484533, 552539513391.0/3454668386233, 3354512671639.0/8306763924573, 4040.0/17871, 0;
+
+        Eigen::MatrixXd AI(6,6);
+        AI << 0, 0, 0, 0, 0, 0,
+              1.0/4, 1.0/4, 0, 0, 0, 0,
+              8611.0/62500, -1743.0/31250, 1.0/4, 0, 0, 0,
+              5012029.0/34652500, -654441.0/2922500, 174375.0/388108, 1.0/4, 0, 0,
+              15267082809.0/155376265600, -71443401.0/120774400, 730878875.0/902184768, 2285395.0/8070912, 1.0/4, 0,
+              b(0), b(1), b(2), b(3), b(4), 1.0/4;
+
+        // the embedded method of order 3
+        Eigen::VectorXd bhat(6);
+        bhat << 4586570599.0/29645900160, 0, 178811875.0/945068544, 814220225.0/1159782912, -3700637.0/11593932, 61727.0/225920;
+
+        return {"ARK4(3)6L[2]SA", AE, AI, b, b - bhat, 4, 3};
+
+    }
+
+    // all of the above, e.g. to compare the methods
+    inline std::vector<AdditiveButcherTableau> all(){
+        return {ark324L2SA(), ark436L2SA()};
+    }
+
+}
+
+
+
+
+#endif
@@ -0,0 +1,157 @@
+#ifndef RKSTATISTICS
+
+#define RKSTATISTICS
+
+#include <chrono>
+
+
+
+
+/**
+ *
+ * Statistics of a single solve: how often the expensive operations have been performed and how the time was spent.
+ *
+ */
+struct SolverStatistics {
+    unsigned long rhsEvaluations = 0;
+    unsigned long acceptedSteps = 0;
+    unsigned long rejectedSteps = 0;
+    unsigned long newtonIterations = 0;
+    unsigned long jacobianEvaluations = 0;
+    unsigned long luFactorizations = 0;
+    unsigned long linearSolves = 0;
+
+    // in seconds
+    double stepTime = 0;
+    double rhsTime = 0;
+    double stageTime = 0;
+    double linearAlgebraTime = 0;
+    double outputTime = 0;
+};
+
+
+// the events counted in SolverStatistics
+enum class Event {
+    RhsEvaluation,
+    AcceptedStep,
+    RejectedStep,
+    NewtonIteration,
+    JacobianEvaluation,
+    LuFactorization,
+    LinearSolve
+};
+
+
+// the phases of a solve whose time is measured in SolverStatistics
+enum class Phase {
+    // a whole step, it contains the other phases except the output
+    Step,
+    // evaluating f (and its Jacobian)
+    Rhs,
+    // computing stage values and combining the stages to the next state
+    Stages,
+    // factorizing and solving linear systems
+    LinearAlgebra,
+    // handing states to the output
+    Output
+};
+
+
+
+
+/**
+ *
+ * The default instrumentation policy of the integrators, it does nothing. All its methods are empty and inlined,
+ * hence a build with this policy has no overhead at all.
+ *
+ * An instrumentation policy provides count(event, n), time(phase) returning an object which measures the time until
+ * its destruction, reset() and statistics().
+ *
+ */
+struct NoInstrumentation {
+
+    struct Timer {
+        // user provided such that unused timers do not cause warnings
+        ~Timer(){
+        }
+    };
+
+    void count(Event, unsigned long = 1){
+    }
+
+    Timer time(Phase){
+        return Timer();
+    }
+
+    void reset(){
+    }
+
+    SolverStatistics statistics() const {
+        return SolverStatistics();
+    }
+};
+
+
+
+
+/**
+ *
+ * The instrumentation policy collecting SolverStatistics. Measuring the time costs two clock readings per phase, which can
+ * be noticeable for very cheap right hand sides.
+ *
+ */
+class StatisticsInstrumentation {
+
+    public:
+        class Timer {
+            public:
+                Timer(double &accumulator) : accumulator(accumulator), start(std::chrono::steady_clock::now()){
+                }
+
+                ~Timer(){
+                    accumulator += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                }
+
+            private:
+                double &accumulator;
+                std::chrono::steady_clock::time_point start;
+        };
+
+        void count(Event event, unsigned long n = 1){
+            switch(event){
+                case Event::RhsEvaluation: collected.rhsEvaluations += n; break;
+                case Event::AcceptedStep: collected.acceptedSteps += n; break;
+                case Event::RejectedStep: collected.rejectedSteps += n; break;
+                case Event::NewtonIteration: collected.newtonIterations += n; break;
+                case Event::JacobianEvaluation: collected.jacobianEvaluations += n; break;
+                case Event::LuFactorization: collected.luFactorizations += n; break;
+                case Event::LinearSolve: collected.linearSolves += n; break;
+            }
+        }
+
+        Timer time(Phase phase){
+            switch(phase){
+                case Phase::Step: return Timer(collected.stepTime);
+                case Phase::Rhs: return Timer(collected.rhsTime);
+                case Phase::Stages: return Timer(collected.stageTime);
+                case Phase::LinearAlgebra: return Timer(collected.linearAlgebraTime);
+                default: return Timer(collected.outputTime);
+            }
+        }
+
+        void reset(){
+            collected = SolverStatistics();
+        }
+
+        const SolverStatistics &statistics() const {
+            return collected;
+        }
+
+    private:
+        SolverStatistics collected;
+};
+
+
+
+
+#endif
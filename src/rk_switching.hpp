@@ -0,0 +1,449 @@
+#ifndef RKSWITCHING
+
+#define RKSWITCHING
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "rk_adaptive.hpp"
+#include "rk_solvers.hpp"
+#include "rk_statistics.hpp"
+
+
+
+
+/**
+ *
+ * Implementation of an integrator with automatic stiffness detection in the spirit of LSODA: it starts with the explicit
+ * Dormand-Prince 5(4) pair and switches to the L-stable Rosenbrock method ROS3 of order 3 (Sandu et al., 1997) when the
+ * problem becomes stiff, and back when the stiffness is gone. Both methods have an adaptive step size.
+ *
+ * Stiffness is detected from the stability of the explicit method. The last stage of Dormand-Prince and f(y1) are both taken
+ * at the end of the step, their difference estimates h times the dominant eigenvalue of the Jacobian for free (Hairer, Wanner,
+ * Sec. IV.2). If it lies outside of the stability region (beyond 3.25) in 15 accepted steps without 6 unremarkable steps in
+ * between, the step size is limited by stability instead of accuracy and the integrator switches to ROS3. With ROS3 the
+ * Jacobian is known in every step, the integrator switches back once h times its induced infinity norm (the largest absolute
+ * row sum), an upper bound of the spectral radius, has been inside of the stability region of Dormand-Prince for 15
+ * consecutive steps.
+ *
+ * The methods only switch between steps and share the state and f(y), hence the solution is continuous. The states between
+ * the steps are interpolated with the cubic Hermite polynomial of y0, y1, f(y0) and f(y1) for both methods, so the output is
+ * continuously differentiable across a switch as well.
+ *
+ * Like for the implicit Runge-Kutta methods the Jacobian J(y) must be an Eigen::MatrixXd. It is evaluated once per step of
+ * ROS3 (and kept when a step is rejected), every step solves three linear systems with one LU factorization. The workspace is
+ * allocated once per solve.
+ *
+ * The Instrumentation policy decides whether statistics are collected, see ExplicitRungeKuttaIntegrator.
+ *
+ */
+template <class Step = Eigen::VectorXd, class Instrumentation = NoInstrumentation> class StiffnessSwitchingIntegrator {
+
+    public:
+        /**
+         * Constructor for the StiffnessSwitchingIntegrator
+         *
+         * @param rtol the relative tolerance of a step
+         * @param atol the absolute tolerance of a step
+         * @param maxStep the largest step size the integrator may use
+         */
+        StiffnessSwitchingIntegrator(double rtol = 1e-6, double atol = 1e-9, double maxStep = std::numeric_limits<double>::infinity())
+            : tableau(EmbeddedRKTableaus::dormandPrince54()), rtol(rtol), atol(atol), maxStep(maxStep){
+        }
+
+        /**
+         * Integrates over [0, time] with adaptive step sizes and hands the state after every accepted step to the output
+         *
+         * @param f the function we are integrating over
+         * @param J the jacobian of f
+         * @param time the time interval we want to integrate over
+         * @param y0 the initial state of the system
+         * @param output receives y0 and the state of every accepted step, see rk_trajectory.hpp for the interface of an output
+         *
+         * @exception if the step size becomes too small an error will be thrown
+         */
+        template<typename Function, typename Jacobian, typename Output>
+        void solve(Function &&f, Jacobian &&J, double time, const Step &y0, Output &output){
+
+            instrumentation.reset();
+
+            output.initialize(y0.size(), 0);
+            output.push(0.0, y0);
+
+            integrate(f, J, time, y0, [&] (double, double, double tNext) {
+                auto timer = instrumentation.time(Phase::Output);
+                output.push(tNext, y1);
+            });
+
+            output.finalize();
+
+        }
+
+        /**
+         * Integrates over [0, times.back()] with adaptive step sizes and hands the states at the given times to the output.
+         * The states between the steps are interpolated, hence the output times do not influence the step sizes.
+         *
+         * @param f the function we are integrating over
+         * @param J the jacobian of f
+         * @param times the times of the states handed to the output, sorted in ascending order and not negative
+         * @param y0 the initial state of the system
+         * @param output receives the states at the given times
+         *
+         * @exception if the times are not sorted or the step size becomes too small an error will be thrown
+         */
+        template<typename Function, typename Jacobian, typename Output>
+        void solve(Function &&f, Jacobian &&J, const std::vector<double> &times, const Step &y0, Output &output){
+
+            if(times.empty() || times.front() < 0 || !std::is_sorted(times.begin(), times.end())){
+                throw "Output times must be sorted and not negative";
+            }
+
+            instrumentation.reset();
+
+            output.initialize(y0.size(), times.size());
+
+            std::size_t next = 0;
+            for(; next < times.size() && times[next] == 0; next++){
+                output.push(0.0, y0);
+            }
+
+            integrate(f, J, times.back(), y0, [&] (double t, double h, double tNext) {
+                auto timer = instrumentation.time(Phase::Output);
+                for(; next < times.size() && times[next] <= tNext; next++){
+                    if(times[next] == tNext){
+                        output.push(times[next], y1);
+                    }else{
+                        // cubic Hermite interpolation, k[0] = f(y) and k[size] = f(y1)
+                        double theta = (times[next] - t)/h;
+                        double t2 = theta*theta, t3 = t2*theta;
+                        interpolated = (2*t3 - 3*t2 + 1)*y + (-2*t3 + 3*t2)*y1;
+                        interpolated += ((t3 - 2*t2 + theta)*h)*k[0] + ((t3 - t2)*h)*k[size];
+                        output.push(times[next], interpolated);
+                    }
+                }
+            });
+
+            output.finalize();
+
+        }
+
+        /**
+         * @return the number of switches between the explicit and the Rosenbrock method in the last solve
+         */
+        unsigned int switches() const {
+            return switchCount;
+        }
+
+        /**
+         * @return the number of accepted steps of the Rosenbrock method in the last solve
+         */
+        unsigned int stiffSteps() const {
+            return stiffStepCount;
+        }
+
+        /**
+         * @return the statistics of the last solve (all zero unless the integrator uses StatisticsInstrumentation)
+         */
+        SolverStatistics statistics() const {
+            return instrumentation.statistics();
+        }
+
+        /**
+         * @return the instrumentation policy, for the data of a policy which goes beyond SolverStatistics
+         */
+        const Instrumentation &instrumentationPolicy() const {
+            return instrumentation;
+        }
+
+    private:
+        /**
+         * The step size control loop, accepted(t, h, tNext) is called after every accepted step of size h from t to tNext while
+         * y holds the state at t, y1 the one at tNext, k[0] = f(y) and k[size] = f(y1). The last step ends exactly at time.
+         */
+        template<typename Function, typename Jacobian, typename Accepted>
+        void integrate(Function &&f, Jacobian &&J, double time, const Step &y0, Accepted &&accepted){
+
+            switchCount = 0;
+            stiffStepCount = 0;
+            if(time <= 0){
+                return;
+            }
+
+            prepare(y0);
+            y = y0;
+
+            double t = 0;
+            double h;
+            {
+                auto timer = instrumentation.time(Phase::Step);
+                evaluate(f, y, k[0]);
+                h = StepSizeControl::initialStep([&] (const Step &argument, Step &result) { evaluate(f, argument, result); },
+                                                 y, k[0], time, tableau.estimatorOrder, rtol, atol, maxStep, stage, k[1]);
+            }
+
+            bool stiff = false;
+            bool rejected = false;
+            // the Jacobian belongs to y, it is kept if a step of the Rosenbrock method is rejected
+            bool jacobianCurrent = false;
+            // the number of steps in which the test indicated stiffness and non stiffness
+            unsigned int stiffTests = 0;
+            unsigned int nonStiffTests = 0;
+
+            while(t < time){
+                // the last step ends exactly at time
+                bool last = t + h >= time;
+                if(last){
+                    h = time - t;
+                }
+
+                double error;
+                // h times the estimate of the dominant eigenvalue of the Jacobian
+                double stiffness;
+                if(stiff){
+                    if(!jacobianCurrent){
+                        auto timer = instrumentation.time(Phase::Step);
+                        jacobian = J(y);
+                        instrumentation.count(Event::JacobianEvaluation);
+                        jacobianCurrent = true;
+                    }
+                    error = rosenbrockStep(f, h);
+                    stiffness = h*jacobian.cwiseAbs().rowwise().sum().maxCoeff();
+                }else{
+                    error = explicitStep(f, h);
+                    auto timer = instrumentation.time(Phase::Stages);
+                    double denominator = (y1 - stage).norm();
+                    stiffness = denominator > 0 ? h*(k[size] - k[size - 1]).norm()/denominator : 0;
+                }
+
+                if(error <= 1){
+                    double tNext = last ? time : t + h;
+                    instrumentation.count(Event::AcceptedStep);
+                    accepted(t, h, tNext);
+
+                    t = tNext;
+                    std::swap(y, y1);
+                    std::swap(k[0], k[size]);
+                    jacobianCurrent = false;
+
+                    h = std::min(h*StepSizeControl::factor(error, estimatorOrder(stiff), rejected), maxStep);
+                    rejected = false;
+
+                    if(stiff){
+                        stiffStepCount++;
+                        // the step size of the Rosenbrock method would be stable for the explicit method as well
+                        nonStiffTests = stiffness <= stabilityBoundary ? nonStiffTests + 1 : 0;
+                        if(nonStiffTests == switchSteps){
+                            stiff = false;
+                            switchCount++;
+                            stiffTests = 0;
+                        }
+                    }else{
+                        if(stiffness > stabilityBoundary){
+                            nonStiffTests = 0;
+                            stiffTests++;
+                            if(stiffTests == switchSteps){
+                                stiff = true;
+                                switchCount++;
+                                nonStiffTests = 0;
+                            }
+                        }else{
+                            nonStiffTests++;
+                            if(nonStiffTests == 6){
+                                stiffTests = 0;
+                            }
+                        }
+                    }
+                }else{
+                    instrumentation.count(Event::RejectedStep);
+                    h *= StepSizeControl::factor(error, estimatorOrder(stiff));
+                    rejected = true;
+                }
+
+                if(t < time && StepSizeControl::tooSmall(h, t)){
+                    throw "Step size too small";
+                }
+            }
+
+        }
+
+        /**
+         * Sizes the workspace for states like y0, this is the only place where the integrator itself allocates memory
+         */
+        void prepare(const Step &y0){
+            k.assign(size + 1, y0);
+            stage = y0;
+            y1 = y0;
+            interpolated = y0;
+            rosenbrockStages.fill(y0);
+            jacobian.resize(y0.size(), y0.size());
+            W.resize(y0.size(), y0.size());
+            lu = Eigen::PartialPivLU<Eigen::MatrixXd>(y0.size());
+        }
+
+        template<typename Function>
+        void evaluate(Function &&f, const Step &argument, Step &result){
+            auto timer = instrumentation.time(Phase::Rhs);
+            result = f(argument);
+            instrumentation.count(Event::RhsEvaluation);
+        }
+
+        /**
+         * @return the error estimator order of the current method
+         */
+        unsigned int estimatorOrder(bool stiff) const {
+            return stiff ? 2 : tableau.estimatorOrder;
+        }
+
+        /**
+         * A step of size h of Dormand-Prince from y in y1 with f(y1) in k[size], k[0] = f(y) is known. Afterwards stage holds
+         * the argument of the last stage, which is taken at the end of the step like y1.
+         *
+         * @return the scaled RMS norm of the error estimate
+         */
+        template<typename Function>
+        double explicitStep(Function &&f, const double h){
+
+            auto stepTimer = instrumentation.time(Phase::Step);
+
+            for(unsigned int i = 1; i < size; i++){
+                {
+                    auto timer = instrumentation.time(Phase::Stages);
+                    stage = y;
+                    for(unsigned int j = 0; j < i; j++){
+                        if(tableau.A(i,j) != 0){
+                            stage += h*tableau.A(i,j) * k[j];
+                        }
+                    }
+                }
+                evaluate(f, stage, k[i]);
+            }
+
+            {
+                auto timer = instrumentation.time(Phase::Stages);
+                y1 = y;
+                for(unsigned int i = 0; i < size; i++){
+                    if(tableau.b(i) != 0){
+                        y1 += h*tableau.b(i) * k[i];
+                    }
+                }
+            }
+            evaluate(f, y1, k[size]);
+
+            auto timer = instrumentation.time(Phase::Stages);
+            // the error estimate is kept in interpolated, which is free at this point
+            interpolated.setZero();
+            for(unsigned int i = 0; i <= size; i++){
+                if(tableau.e(i) != 0){
+                    interpolated += tableau.e(i) * k[i];
+                }
+            }
+            return std::abs(h)*StepSizeControl::errorNorm(interpolated, y, y1, rtol, atol);
+        }
+
+        /**
+         * A step of size h of ROS3 from y in y1, k[0] = f(y) and the Jacobian at y are known. f(y1) is stored in k[size] if
+         * the step is accepted.
+         *
+         * @return the scaled RMS norm of the error estimate
+         */
+        template<typename Function>
+        double rosenbrockStep(Function &&f, const double h){
+
+            auto stepTimer = instrumentation.time(Phase::Step);
+
+            {
+                auto timer = instrumentation.time(Phase::LinearAlgebra);
+                W = -jacobian;
+                W.diagonal().array() += 1/(h*gamma);
+                lu.compute(W);
+                instrumentation.count(Event::LuFactorization);
+            }
+
+            Step &k1 = rosenbrockStages[0], &k2 = rosenbrockStages[1], &k3 = rosenbrockStages[2];
+            {
+                auto timer = instrumentation.time(Phase::LinearAlgebra);
+                k1 = lu.solve(k[0]);
+                instrumentation.count(Event::LinearSolve);
+            }
+
+            // the second and third stage share their argument y + k1, hence f is evaluated once
+            {
+                auto timer = instrumentation.time(Phase::Stages);
+                stage = y + k1;
+            }
+            evaluate(f, stage, k[1]);
+
+            {
+                auto timer = instrumentation.time(Phase::LinearAlgebra);
+                stage = k[1] + (c21/h)*k1;
+                k2 = lu.solve(stage);
+                stage = k[1] + (c31/h)*k1 + (c32/h)*k2;
+                k3 = lu.solve(stage);
+                instrumentation.count(Event::LinearSolve);
+                instrumentation.count(Event::LinearSolve);
+            }
+
+            double error;
+            {
+                auto timer = instrumentation.time(Phase::Stages);
+                y1 = y + m1*k1 + m2*k2 + m3*k3;
+                // the error estimate is kept in interpolated, which is free at this point
+                interpolated = e1*k1 + e2*k2 + e3*k3;
+                error = StepSizeControl::errorNorm(interpolated, y, y1, rtol, atol);
+            }
+
+            if(error <= 1){
+                evaluate(f, y1, k[size]);
+            }
+            return error;
+        }
+
+
+        EmbeddedButcherTableau tableau;
+        // the number of stages of Dormand-Prince
+        const unsigned int size = 6;
+        double rtol;
+        double atol;
+        double maxStep;
+        unsigned int switchCount = 0;
+        unsigned int stiffStepCount = 0;
+        Instrumentation instrumentation;
+
+        // where the stability region of Dormand-Prince ends on the negative real axis (approximately)
+        static constexpr double stabilityBoundary = 3.25;
+        // the number of steps which have to agree before the method is switched
+        static constexpr unsigned int switchSteps = 15;
+
+        // ROS3: (I/(h gamma) - J) k_i = f(y + sum_j a_ij k_j) + sum_j c_ij/h k_j with a21 = a31 = 1, a32 = 0
+        static constexpr double gamma = 0.43586652150845899942;
+        static constexpr double c21 = -1.0156171083877702091975600115545;
+        static constexpr double c31 = 4.0759956452537699824805835358067;
+        static constexpr double c32 = 9.2076794298330791242156818474003;
+        // y1 = y + sum_i m_i k_i, the error estimate is sum_i e_i k_i
+        static constexpr double m1 = 1;
+        static constexpr double m2 = 6.1697947043828245592553615689730;
+        static constexpr double m3 = -0.42772256543218573326238373806514;
+        static constexpr double e1 = 0.5;
+        static constexpr double e2 = -2.9079558716805469821718236208017;
+        static constexpr double e3 = 0.22354069897811569627360909276199;
+
+        // workspace: the stages of Dormand-Prince and f(y1), the state at the end of the step, the stages of ROS3 and the matrices
+        std::vector<Step> k;
+        Step stage;
+        Step y;
+        Step y1;
+        Step interpolated;
+        std::array<Step, 3> rosenbrockStages;
+        Eigen::MatrixXd jacobian;
+        Eigen::MatrixXd W;
+        Eigen::PartialPivLU<Eigen::MatrixXd> lu;
+};
+
+
+
+
+#endif
@@ -0,0 +1,317 @@
+#ifndef RKTRAJECTORY
+
+#define RKTRAJECTORY
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <vector>
+
+
+
+
+/**
+ *
+ * Outputs receive the states computed by the integrators' solve methods. Every output provides the following three methods:
+ *
+ *  - initialize(dimension, count): called once before the first state, with the dimension of a state and the number of states
+ *    which will be pushed (0 if that number is not known in advance).
+ *  - push(t, y): called for every state y at time t, the first call receives the initial state.
+ *  - finalize(): called once after the last state.
+ *
+ * A pushed state y is any Eigen object with direct access to its coefficients (y.data() and y.size()).
+ *
+ */
+
+
+
+
+/**
+ *
+ * A trajectory stores all states of an integration in one contiguous column-major matrix with one column per state.
+ *
+ * Compared to a std::vector of states this needs a single allocation (the trajectory is pre-sized in initialize) and keeps
+ * the states next to each other in memory. Rows (the evolution of a single component) can be viewed without copying.
+ *
+ */
+class Trajectory {
+
+    public:
+        Trajectory() : dimension(0), count(0){
+        }
+
+        /**
+         * Allocates memory for all states of the integration
+         *
+         * @param dimension the number of components of a single state
+         * @param expectedCount the number of states which will be pushed, if more states are pushed the trajectory grows
+         */
+        void initialize(unsigned int dimension, unsigned int expectedCount){
+            this->dimension = dimension;
+            count = 0;
+            data.resize(dimension, expectedCount);
+            timesVector.resize(expectedCount);
+        }
+
+        /**
+         * Appends a state to the trajectory
+         *
+         * @param t the time of the state
+         * @param y the state, must have as many components as given in initialize
+         */
+        template<typename State>
+        void push(double t, const State &y){
+
+            // only happens if the number of states was not known (or wrongly announced) in initialize
+            if(count == data.cols()){
+                Eigen::Index capacity = std::max<Eigen::Index>(2*data.cols(), 16);
+                data.conservativeResize(Eigen::NoChange, capacity);
+                timesVector.conservativeResize(capacity);
+            }
+
+            data.col(count) = Eigen::Map<const Eigen::VectorXd>(y.data(), dimension);
+            timesVector(count) = t;
+            count++;
+        }
+
+        void finalize(){
+        }
+
+        /**
+         * @return the number of states stored in the trajectory
+         */
+        unsigned int size() const {
+            return count;
+        }
+
+        /**
+         * @return the number of components of a single state
+         */
+        unsigned int dimensions() const {
+            return dimension;
+        }
+
+        /**
+         * @return a view of all states as a dimensions() x size() matrix, column i is the i-th state
+         */
+        Eigen::Map<const Eigen::MatrixXd> matrix() const {
+            return Eigen::Map<const Eigen::MatrixXd>(data.data(), dimension, count);
+        }
+
+        /**
+         * @return a view of the i-th state
+         */
+        Eigen::Map<const Eigen::VectorXd> operator[](unsigned int i) const {
+            return Eigen::Map<const Eigen::VectorXd>(data.col(i).data(), dimension);
+        }
+
+        /**
+         * @return a view of the evolution of the i-th component over all states
+         */
+        Eigen::Map<const Eigen::RowVectorXd, 0, Eigen::InnerStride<>> row(unsigned int i) const {
+            return Eigen::Map<const Eigen::RowVectorXd, 0, Eigen::InnerStride<>>(data.data() + i, count, Eigen::InnerStride<>(dimension));
+        }
+
+        /**
+         * @return a view of the times of all states
+         */
+        Eigen::Map<const Eigen::VectorXd> times() const {
+            return Eigen::Map<const Eigen::VectorXd>(timesVector.data(), count);
+        }
+
+        /**
+         * @return the last state pushed to the trajectory
+         */
+        Eigen::Map<const Eigen::VectorXd> back() const {
+            return (*this)[count - 1];
+        }
+
+    private:
+        Eigen::MatrixXd data;
+        Eigen::VectorXd timesVector;
+        unsigned int dimension;
+        unsigned int count;
+};
+
+
+
+
+/**
+ *
+ * An output which only keeps the last state, for integrations where only the final result is of interest.
+ *
+ */
+class FinalState {
+
+    public:
+        FinalState() : t(0){
+        }
+
+        void initialize(unsigned int dimension, unsigned int){
+            state.resize(dimension);
+        }
+
+        template<typename State>
+        void push(double t, const State &y){
+            this->t = t;
+            state = Eigen::Map<const Eigen::VectorXd>(y.data(), state.size());
+        }
+
+        void finalize(){
+        }
+
+        /**
+         * @return the last state pushed
+         */
+        const Eigen::VectorXd &value() const {
+            return state;
+        }
+
+        /**
+         * @return the time of the last state pushed
+         */
+        double time() const {
+            return t;
+        }
+
+    private:
+        Eigen::VectorXd state;
+        double t;
+};
+
+
+
+
+/**
+ *
+ * The identity projection, used if an output policy should store the states themselves.
+ *
+ */
+struct IdentityProjection {
+    template<typename State>
+    const State &operator()(const State &y) const {
+        return y;
+    }
+};
+
+
+
+
+/**
+ *
+ * An output policy sits between an integrator and an output and only forwards some of the states, either every n-th state or
+ * one state per time interval. Optionally every forwarded state is first mapped to an observable (e.g. a single component),
+ * only the observable is handed to the output.
+ *
+ * The integration itself is not affected, only the amount of stored data. Use the functions everyNthState and everyTimeInterval
+ * below to create a policy.
+ *
+ */
+template<typename Output, typename Projection = IdentityProjection> class OutputPolicy {
+
+    public:
+        /**
+         * Constructor for the OutputPolicy
+         *
+         * @param output the output receiving the selected states (or observables)
+         * @param stride if not 0, every stride-th state is forwarded
+         * @param interval if stride is 0, the first state at or after every multiple of interval is forwarded
+         * @param projection maps a state y to the observable which should be stored, obs(y) must return an Eigen vector
+         *
+         * @exception if stride is 0 and interval is not positive an error will be thrown
+         */
+        OutputPolicy(Output &output, unsigned int stride, double interval, Projection projection):
+            output(output),stride(stride),interval(interval),projection(projection),initialized(false),index(0),samples(0){
+            // also rejects NaN, t / interval has to be a finite number of intervals
+            if(stride == 0 && !(interval > 0)){
+                throw "The output interval must be positive";
+            }
+        }
+
+        void initialize(unsigned int dimension, unsigned int count){
+            index = 0;
+            samples = 0;
+            initialized = false;
+
+            // the output is initialized with the first observable, as only then we know its dimension
+            expectedCount = (stride > 0 && count > 0) ? (count - 1)/stride + 1 : 0;
+        }
+
+        template<typename State>
+        void push(double t, const State &y){
+
+            if(stride > 0 ? index++ % stride == 0 : t >= (samples - 1e-9)*interval){
+
+                const auto &observable = projection(y);
+                if(!initialized){
+                    output.initialize(observable.size(), expectedCount);
+                    initialized = true;
+                }
+                output.push(t, observable);
+
+                // if one integration step covers several intervals only one state is stored
+                samples++;
+                if(stride == 0){
+                    samples = std::max(samples, static_cast<unsigned long>(t / interval + 1e-9) + 1);
+                }
+            }
+        }
+
+        void finalize(){
+            output.finalize();
+        }
+
+    private:
+        Output &output;
+        unsigned int stride;
+        double interval;
+        Projection projection;
+        bool initialized;
+        unsigned int expectedCount;
+        unsigned long index;
+        unsigned long samples;
+};
+
+
+/**
+ * Creates an output policy forwarding every stride-th state (starting with the initial state) to output
+ *
+ * @param output the output receiving the selected states
+ * @param stride the distance between two stored states, in steps
+ * @param projection optional observable obs(y) which is stored instead of the state y
+ *
+ * @return the policy, pass it to solve in place of the output
+ *
+ * @exception if stride is 0 an error will be thrown
+ */
+template<typename Output, typename Projection = IdentityProjection>
+OutputPolicy<Output, Projection> everyNthState(Output &output, unsigned int stride, Projection projection = Projection()){
+    if(stride == 0){
+        throw "The output stride must be positive";
+    }
+    return OutputPolicy<Output, Projection>(output, stride, 0.0, projection);
+}
+
+
+/**
+ * Creates an output policy forwarding one state per time interval (starting with the initial state) to output
+ *
+ * @param output the output receiving the selected states
+ * @param interval the time between two stored states, a stored state is the first state at or after a multiple of interval
+ * @param projection optional observable obs(y) which is stored instead of the state y
+ *
+ * @return the policy, pass it to solve in place of the output
+ *
+ * @exception if interval is not positive an error will be thrown
+ */
+template<typename Output, typename Projection = IdentityProjection>
+OutputPolicy<Output, Projection> everyTimeInterval(Output &output, double interval, Projection projection = Projection()){
+    if(!(interval > 0)){
+        throw "The output interval must be positive";
+    }
+    return OutputPolicy<Output, Projection>(output, 0, interval, projection);
+}
+
+
+
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef RKCHECK
+
+#define RKCHECK
+
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+
+
+
+// helpers shared by the regression checks in tests/, every check prints one row of a table and the program fails at the end
+namespace Check{
+
+    /**
+     * Prints the header of the table of checks
+     */
+    inline void header(){
+        std::cout << std::left << std::setw(60) << "check" << std::setw(16) << "value" << std::setw(16) << "expected"
+                  << std::setw(12) << "tolerance" << "result" << std::endl;
+    }
+
+    /**
+     * Prints one check, it passes if value is within tolerance of expected
+     *
+     * @return false if the check failed
+     */
+    inline bool report(const std::string &check, double value, double expected, double tolerance){
+        const bool passed = std::abs(value - expected) <= tolerance;
+        std::cout << std::left << std::setw(60) << check << std::setw(16) << value << std::setw(16) << expected
+                  << std::setw(12) << tolerance << (passed ? "ok" : "FAILED") << std::endl;
+        return passed;
+    }
+
+    /**
+     * @return value as printed by a stream, for the names of checks
+     */
+    inline std::string format(double value){
+        std::ostringstream stream;
+        stream << value;
+        return stream.str();
+    }
+
+    /**
+     * The order of convergence observed from the errors of two runs, the second with half the step size
+     */
+    inline double observedOrder(double error, double halvedError){
+        return std::log2(error/halvedError);
+    }
+
+    /**
+     * Prints the summary of all checks
+     *
+     * @return the exit code of the program
+     */
+    inline int summary(bool success, const std::string &what){
+        if(!success){
+            std::cerr << "Some checks of the " << what << " failed" << std::endl;
+            return 1;
+        }
+        std::cerr << "All checks of the " << what << " passed" << std::endl;
+        return 0;
+    }
+
+}
+
+
+
+
+#endif
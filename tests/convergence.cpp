@@ -0,0 +1,440 @@
+/**
+ *
+ * Regression checks of the accuracy of the integrators, see README.md.
+ *
+ * Fixed step size integrators are checked with their observed order of convergence, the error of a run compared to the
+ * one with half the step size. Integrators with adaptive step size are checked with their error at the end of the time
+ * interval, which must stay within a small multiple of the tolerance. The program fails (exit code 1) if a check fails.
+ *
+ */
+
+
+
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <Eigen/Dense>
+#include "../src/rk_chebyshev.hpp"
+#include "../src/rk_exponential.hpp"
+#include "../src/rk_extrapolation.hpp"
+#include "../src/rk_multistep.hpp"
+#include "../src/rk_parareal.hpp"
+#include "../src/rk_solvers.hpp"
+#include "../src/rk_trajectory.hpp"
+#include "check.hpp"
+
+
+
+// the error of an adaptive run may exceed its tolerance by this factor, the error of a step is controlled, not the global one
+const double errorFactor = 100;
+
+
+/**
+ * The Prothero-Robinson problem y' = lambda (y - sin(t)) + cos(t) with the solution y = sin(t), t is the second component
+ */
+struct ProtheroRobinson {
+    double lambda;
+
+    Eigen::VectorXd f(const Eigen::VectorXd &y) const {
+        return Eigen::Vector2d(lambda*(y(0) - std::sin(y(1))) + std::cos(y(1)), 1);
+    }
+
+    Eigen::MatrixXd J(const Eigen::VectorXd &y) const {
+        Eigen::MatrixXd jacobian = Eigen::MatrixXd::Zero(2, 2);
+        jacobian(0,0) = lambda;
+        jacobian(0,1) = -lambda*std::cos(y(1)) - std::sin(y(1));
+        return jacobian;
+    }
+
+    double error(const Eigen::VectorXd &y, double time) const {
+        return std::abs(y(0) - std::sin(time));
+    }
+};
+
+
+/**
+ * The Kepler problem q'' = -q/|q|^3 with eccentricity 0.5, starting at the pericenter
+ */
+struct Kepler {
+    static constexpr double eccentricity = 0.5;
+
+    static Eigen::VectorXd g(const Eigen::VectorXd &q){
+        return -q/std::pow(q.norm(), 3);
+    }
+
+    // the first order system of the positions followed by the velocities
+    static Eigen::VectorXd f(const Eigen::VectorXd &y){
+        Eigen::VectorXd dy(4);
+        dy << y.tail(2), g(y.head(2));
+        return dy;
+    }
+
+    static Eigen::VectorXd q0(){
+        return Eigen::Vector2d(1 - eccentricity, 0);
+    }
+
+    static Eigen::VectorXd v0(){
+        return Eigen::Vector2d(0, std::sqrt((1 + eccentricity)/(1 - eccentricity)));
+    }
+
+    /**
+     * @return the distance of the positions in state to the exact ones at time, from Kepler's equation E - e sin(E) = t
+     */
+    static double error(const Eigen::VectorXd &state, double time){
+        double E = time;
+        for(unsigned int i = 0; i < 50; i++){
+            E -= (E - eccentricity*std::sin(E) - time)/(1 - eccentricity*std::cos(E));
+        }
+        const Eigen::Vector2d exact(std::cos(E) - eccentricity, std::sqrt(1 - eccentricity*eccentricity)*std::sin(E));
+        return (state.head(2) - exact).norm();
+    }
+};
+
+
+/**
+ * The Allen-Cahn equation u_t = 0.1 u_xx + u - u^3 on (0, 1) with u = 0 on the boundary, on 16 grid points: y' = L y + N(y)
+ */
+struct AllenCahn {
+    static constexpr unsigned int points = 16;
+
+    static Eigen::MatrixXd L(){
+        const double scale = 0.1*(points + 1)*(points + 1);
+        Eigen::MatrixXd laplacian = Eigen::MatrixXd::Zero(points, points);
+        for(unsigned int i = 0; i < points; i++){
+            laplacian(i,i) = -2*scale;
+            if(i > 0){
+                laplacian(i,i-1) = scale;
+                laplacian(i-1,i) = scale;
+            }
+        }
+        return laplacian;
+    }
+
+    static Eigen::VectorXd N(const Eigen::VectorXd &y){
+        return y - y.cwiseProduct(y).cwiseProduct(y);
+    }
+
+    // the Jacobian of N
+    static Eigen::MatrixXd JN(const Eigen::VectorXd &y){
+        return (1 - 3*y.array().square()).matrix().asDiagonal();
+    }
+
+    // the solution at time computed with 4096 steps of the IMEX method of order 4
+    static Eigen::VectorXd solution(double time){
+        const Eigen::MatrixXd laplacian = L();
+        AdditiveRungeKuttaIntegrator<Eigen::VectorXd> fine(IMEXTableaus::ark436L2SA());
+        return fine.solve(N, [&] (const Eigen::VectorXd &y) -> Eigen::VectorXd { return laplacian*y; },
+                          [&] (const Eigen::VectorXd &) -> Eigen::MatrixXd { return laplacian; }, time, y0(), 4096).back();
+    }
+
+    static Eigen::VectorXd y0(){
+        Eigen::VectorXd y(points);
+        for(unsigned int i = 0; i < points; i++){
+            const double x = (i + 1.0)/(points + 1);
+            y(i) = std::sin(M_PI*x) + 0.5*std::sin(2*M_PI*x);
+        }
+        return y;
+    }
+};
+
+
+/**
+ * The order observed from the differences of three runs, each with half the step size of the previous one
+ */
+template<typename Solve>
+double observedOrder(Solve &&solve, unsigned int steps){
+    const Eigen::VectorXd coarse = solve(steps);
+    const Eigen::VectorXd medium = solve(2*steps);
+    const Eigen::VectorXd fine = solve(4*steps);
+    return Check::observedOrder((coarse - medium).norm(), (medium - fine).norm());
+}
+
+
+/**
+ * Runs the Adams and BDF integrators on a non stiff and a stiff Prothero-Robinson problem
+ *
+ * @return false if an error exceeds the tolerance or BDF needs many steps for the stiff problem
+ */
+bool multistepMethods(){
+
+    const double time = 10;
+    const Eigen::VectorXd y0 = Eigen::VectorXd::Zero(2);
+
+    bool success = true;
+    for(double lambda : {-1.0, -1e4}){
+        const ProtheroRobinson problem{lambda};
+        auto f = [&] (const Eigen::VectorXd &y) { return problem.f(y); };
+        auto J = [&] (const Eigen::VectorXd &y) { return problem.J(y); };
+        const std::string name = " for lambda = " + Check::format(lambda);
+
+        for(double tolerance : {1e-6, 1e-9}){
+            const std::string suffix = name + ", tolerance " + Check::format(tolerance);
+            if(lambda == -1){
+                AdamsIntegrator<Eigen::VectorXd> adams(tolerance, tolerance);
+                FinalState state;
+                adams.solve(f, time, y0, state);
+                success = Check::report("Adams: error" + suffix, problem.error(state.value(), time), 0, errorFactor*tolerance) && success;
+            }
+
+            BDFIntegrator<Eigen::VectorXd, StatisticsInstrumentation> bdf(tolerance, tolerance);
+            FinalState state;
+            bdf.solve(f, J, time, y0, state);
+            success = Check::report("BDF: error" + suffix, problem.error(state.value(), time), 0, errorFactor*tolerance) && success;
+            if(lambda != -1){
+                // an explicit method would need about 10^5 steps
+                success = Check::report("BDF: steps" + suffix, bdf.statistics().acceptedSteps, 0, 2000) && success;
+            }
+        }
+    }
+    return success;
+}
+
+
+/**
+ * Runs all RKNTableaus with fixed step size and the embedded pair with adaptive step size on the Kepler problem, and
+ * compares the Nystroem form of the classical 4th order method with the method applied to the first order system
+ *
+ * @return false if an order or error differs from the expected one
+ */
+bool nystromMethods(){
+
+    // not a whole period, where errors cancel
+    const double time = 3;
+
+    bool success = true;
+    for(const RungeKuttaNystromTableau &tableau : RKNTableaus::all()){
+        RungeKuttaNystromIntegrator<Eigen::VectorXd> integrator(tableau);
+        const double error = Kepler::error(integrator.solve(Kepler::g, time, Kepler::q0(), Kepler::v0(), 100).back(), time);
+        const double halvedError = Kepler::error(integrator.solve(Kepler::g, time, Kepler::q0(), Kepler::v0(), 200).back(), time);
+        success = Check::report(tableau.name + ": observed order", Check::observedOrder(error, halvedError), tableau.order, 0.3) && success;
+
+        if(tableau.e.size() != 0){
+            for(double tolerance : {1e-6, 1e-9}){
+                RungeKuttaNystromIntegrator<Eigen::VectorXd> adaptive(tableau, tolerance, tolerance);
+                FinalState state;
+                adaptive.solveAdaptive(Kepler::g, time, Kepler::q0(), Kepler::v0(), state);
+                success = Check::report(tableau.name + ": error, tolerance " + Check::format(tolerance), Kepler::error(state.value(), time),
+                                        0, errorFactor*tolerance) && success;
+            }
+        }
+    }
+
+    // the Nystroem form computes the same steps
+    Eigen::VectorXd y0(4);
+    y0 << Kepler::q0(), Kepler::v0();
+    ExplicitRungeKuttaIntegrator<Eigen::VectorXd> firstOrder(ExplicitRKTableaus::classical4thOrder());
+    RungeKuttaNystromIntegrator<Eigen::VectorXd> nystrom(RungeKuttaNystromTableau::fromRungeKutta(ExplicitRKTableaus::classical4thOrder()));
+    const double difference = (firstOrder.solve(Kepler::f, time, y0, 100).back() - nystrom.solve(Kepler::g, time, Kepler::q0(), Kepler::v0(), 100).back()).norm();
+    success = Check::report("fromRungeKutta: difference to the first order form", difference, 0, 1e-12) && success;
+
+    return success;
+}
+
+
+/**
+ * Runs the exponential Runge Kutta and Rosenbrock methods on the Allen-Cahn equation
+ *
+ * @return false if an observed order differs from the order of the method
+ */
+bool exponentialMethods(){
+
+    const double time = 1;
+    const Eigen::MatrixXd L = AllenCahn::L();
+    const Eigen::VectorXd y0 = AllenCahn::y0();
+    auto F = [&] (const Eigen::VectorXd &y) -> Eigen::VectorXd { return L*y + AllenCahn::N(y); };
+    auto J = [&] (const Eigen::VectorXd &y) -> Eigen::MatrixXd { return L + AllenCahn::JN(y); };
+
+    const std::vector<std::pair<ExponentialMethod, std::string>> methods = {
+        {ExponentialMethod::ETDRK4, "ETDRK4"}, {ExponentialMethod::LawsonRK4, "Lawson RK4"}
+    };
+    bool success = true;
+    for(const auto &method : methods){
+        ExponentialRungeKuttaIntegrator<Eigen::VectorXd> integrator(method.first, L);
+        const double order = observedOrder([&] (unsigned int steps) { return integrator.solve(AllenCahn::N, time, y0, steps).back(); }, 64);
+        success = Check::report(method.second + ": observed order", order, 4, 0.3) && success;
+    }
+
+    const std::vector<std::tuple<ExponentialRosenbrockMethod, std::string, unsigned int>> rosenbrockMethods = {
+        {ExponentialRosenbrockMethod::RosenbrockEuler, "exponential Rosenbrock-Euler", 2}, {ExponentialRosenbrockMethod::EXPRB32, "exprb32", 3}
+    };
+    for(const auto &method : rosenbrockMethods){
+        ExponentialRosenbrockIntegrator<Eigen::VectorXd> integrator(std::get<0>(method));
+        const double order = observedOrder([&] (unsigned int steps) { return integrator.solve(F, J, time, y0, steps).back(); }, 64);
+        success = Check::report(std::get<1>(method) + ": observed order", order, std::get<2>(method), 0.3) && success;
+    }
+    return success;
+}
+
+
+/**
+ * Runs all IMEXTableaus on the Allen-Cahn equation, the diffusion is treated implicitly
+ *
+ * @return false if an observed order differs from the order of the method or an error exceeds the tolerance
+ */
+bool imexMethods(){
+
+    const double time = 1;
+    const Eigen::MatrixXd L = AllenCahn::L();
+    const Eigen::VectorXd y0 = AllenCahn::y0();
+    auto fI = [&] (const Eigen::VectorXd &y) -> Eigen::VectorXd { return L*y; };
+    auto JI = [&] (const Eigen::VectorXd &) -> Eigen::MatrixXd { return L; };
+
+    const Eigen::VectorXd reference = AllenCahn::solution(time);
+
+    bool success = true;
+    for(const AdditiveButcherTableau &tableau : IMEXTableaus::all()){
+        AdditiveRungeKuttaIntegrator<Eigen::VectorXd> integrator(tableau);
+        const double order = observedOrder([&] (unsigned int steps) { return integrator.solve(AllenCahn::N, fI, JI, time, y0, steps).back(); }, 64);
+        success = Check::report(tableau.name + ": observed order", order, tableau.order, 0.3) && success;
+
+        for(double tolerance : {1e-5, 1e-8}){
+            AdditiveRungeKuttaIntegrator<Eigen::VectorXd> adaptive(tableau, tolerance, tolerance);
+            FinalState state;
+            adaptive.solveAdaptive(AllenCahn::N, fI, JI, time, y0, state);
+            success = Check::report(tableau.name + ": error, tolerance " + Check::format(tolerance), (state.value() - reference).norm(),
+                                    0, errorFactor*tolerance) && success;
+        }
+    }
+    return success;
+}
+
+
+/**
+ * Runs RKC, ROCK2 and ROCK4 on the Kepler problem with a constant step size (the tolerance never rejects a step and the
+ * smallest degree is stable) and with adaptive step size on the Allen-Cahn equation
+ *
+ * @return false if an observed order differs from the order of the method or an error exceeds the tolerance
+ */
+bool chebyshevMethods(){
+
+    const double time = 3;
+    Eigen::VectorXd y0(4);
+    y0 << Kepler::q0(), Kepler::v0();
+
+    const Eigen::VectorXd reference = AllenCahn::solution(1);
+    auto F = [L = AllenCahn::L()] (const Eigen::VectorXd &y) -> Eigen::VectorXd { return L*y + AllenCahn::N(y); };
+
+    bool success = true;
+    for(unsigned int order : {0, 2, 4}){
+        const std::string name = order == 0 ? "RKC" : "ROCK" + std::to_string(order);
+        auto run = [&] (double rtol, double atol, double maxStep, auto &&f, double end, const Eigen::VectorXd &initial) {
+            FinalState state;
+            if(order == 0){
+                RungeKuttaChebyshevIntegrator<Eigen::VectorXd> integrator(rtol, atol, 250, maxStep);
+                integrator.solve(f, end, initial, state);
+            }else{
+                ROCKIntegrator<Eigen::VectorXd> integrator(order, rtol, atol, 250, maxStep);
+                integrator.solve(f, end, initial, state);
+            }
+            return state.value();
+        };
+
+        const double error = Kepler::error(run(1e6, 1e6, time/128, Kepler::f, time, y0), time);
+        const double halvedError = Kepler::error(run(1e6, 1e6, time/256, Kepler::f, time, y0), time);
+        success = Check::report(name + ": observed order", Check::observedOrder(error, halvedError), order == 0 ? 2 : order, 0.3) && success;
+
+        // the moderate tolerances of mildly stiff problems, the error of RKC is not proportional to tight tolerances
+        for(double tolerance : {1e-4, 1e-6}){
+            const Eigen::VectorXd y1 = run(tolerance, tolerance, std::numeric_limits<double>::infinity(), F, 1.0, AllenCahn::y0());
+            success = Check::report(name + ": error, tolerance " + Check::format(tolerance), (y1 - reference).norm(), 0, errorFactor*tolerance) && success;
+        }
+    }
+    return success;
+}
+
+
+/**
+ * Runs the extrapolation method on the Kepler problem with one and with four threads
+ *
+ * @return false if an error exceeds the tolerance or two runs with four threads differ
+ */
+bool extrapolationMethod(){
+
+    const double time = 3;
+    Eigen::VectorXd y0(4);
+    y0 << Kepler::q0(), Kepler::v0();
+
+    bool success = true;
+    for(double tolerance : {1e-6, 1e-10}){
+        const std::string suffix = ", tolerance " + Check::format(tolerance);
+        // more threads lead to higher orders, hence other steps
+        std::vector<Eigen::VectorXd> results;
+        for(unsigned int threads : {1, 4, 4}){
+            ExtrapolationIntegrator<Eigen::VectorXd> integrator(tolerance, tolerance, threads);
+            FinalState state;
+            integrator.solve(Kepler::f, time, y0, state);
+            results.push_back(state.value());
+        }
+        success = Check::report("Extrapolation: error, 1 thread" + suffix, Kepler::error(results[0], time), 0, errorFactor*tolerance) && success;
+        success = Check::report("Extrapolation: error, 4 threads" + suffix, Kepler::error(results[1], time), 0, errorFactor*tolerance) && success;
+        // the columns are computed independently, the distribution over the threads does not change the result
+        success = Check::report("Extrapolation: two runs differ, 4 threads" + suffix, (results[2] - results[1]).norm(), 0, 0) && success;
+    }
+    return success;
+}
+
+
+/**
+ * Compares Parareal on the Kepler problem with the sequential fine solution, once until the tolerance is reached and once
+ * with as many iterations as there are slices
+ *
+ * @return false if Parareal differs from the sequential solution by more than the tolerance or does not converge early
+ */
+bool pararealMethod(){
+
+    const double time = 3;
+    const unsigned int slices = 16;
+    const unsigned int fineSteps = 100;
+    Eigen::VectorXd y0(4);
+    y0 << Kepler::q0(), Kepler::v0();
+
+    ExplicitRungeKuttaIntegrator<Eigen::VectorXd> serial(ExplicitRKTableaus::classical4thOrder());
+    const Eigen::VectorXd reference = serial.solve(Kepler::f, time, y0, slices*fineSteps).back();
+
+    bool success = true;
+    for(double tolerance : {1e-6, 1e-10}){
+        PararealIntegrator<Eigen::VectorXd> parareal(ExplicitRKTableaus::classical4thOrder(), 2, ExplicitRKTableaus::classical4thOrder(), fineSteps,
+                                                     slices, tolerance, tolerance, 4);
+        Trajectory trajectory;
+        parareal.solve(Kepler::f, time, y0, trajectory);
+        const std::string suffix = ", tolerance " + Check::format(tolerance);
+        success = Check::report("Parareal: difference to serial" + suffix, (trajectory.back() - reference).norm(), 0, errorFactor*tolerance) && success;
+        success = Check::report("Parareal: iterations" + suffix, parareal.iterations(), 0, slices/2) && success;
+    }
+
+    // after as many iterations as slices Parareal is the fine solution up to round off
+    PararealIntegrator<Eigen::VectorXd> parareal(ExplicitRKTableaus::explicitEuler(), 1, ExplicitRKTableaus::classical4thOrder(), fineSteps, slices, 0, 0, 4);
+    Trajectory trajectory;
+    parareal.solve(Kepler::f, time, y0, trajectory);
+    success = Check::report("Parareal: difference to serial, all iterations", (trajectory.back() - reference).norm(), 0, 1e-12) && success;
+    success = Check::report("Parareal: states handed to the output", trajectory.size(), slices + 1, 0) && success;
+
+    return success;
+}
+
+
+int main() {
+
+    /**
+     * Usage: convergence
+     */
+
+    Check::header();
+
+    bool success = true;
+    success = multistepMethods() && success;
+    success = nystromMethods() && success;
+    success = exponentialMethods() && success;
+    success = imexMethods() && success;
+    success = chebyshevMethods() && success;
+    success = extrapolationMethod() && success;
+    success = pararealMethod() && success;
+
+    return Check::summary(success, "integrators");
+
+}
@@ -0,0 +1,125 @@
+#ifndef RKORDERCONDITIONS
+
+#define RKORDERCONDITIONS
+
+#include <Eigen/Dense>
+#include <cmath>
+#include <vector>
+
+
+
+
+/**
+ *
+ * The order conditions of Runge Kutta methods over rooted trees (Butcher, see Hairer, Norsett, Wanner, Sec. II.2).
+ * The weights b of the stages of A reach order p iff b^T Phi(t) = 1/gamma(t) for all trees t with at most p nodes, where
+ * Phi(t) = prod_k A Phi(t_k) (componentwise, Phi of a single node is 1) for the subtrees t_k of the root. A dense output
+ * b(theta) reaches order p at theta iff b(theta)^T Phi(t) = theta^|t|/gamma(t).
+ *
+ * For additive methods with the same weights b for several coefficient matrices (one per color) the nodes of the trees
+ * below the root are colored, and A Phi(t_k) uses the matrix of the color of the root of t_k. This adds the coupling
+ * conditions between the matrices.
+ *
+ */
+namespace OrderConditions{
+
+    struct Tree {
+        // the number of nodes
+        unsigned int order;
+        // the density gamma(t) = |t| prod_k gamma(t_k)
+        double density;
+        // the subtrees of the root in decreasing order, index*colors + color for the indices of smaller trees
+        std::vector<std::size_t> children;
+    };
+
+    /**
+     * Appends all multisets of the colored trees up to largest whose orders sum up to remaining, as decreasing indices
+     */
+    inline void subtrees(const std::vector<Tree> &trees, unsigned int colors, unsigned int remaining, std::size_t largest,
+                         std::vector<std::size_t> &current, std::vector<std::vector<std::size_t>> &result){
+        if(remaining == 0){
+            result.push_back(current);
+            return;
+        }
+        for(std::size_t i = 0; i <= largest && i < trees.size()*colors; i++){
+            if(trees[i/colors].order <= remaining){
+                current.push_back(i);
+                subtrees(trees, colors, remaining - trees[i/colors].order, i, current, result);
+                current.pop_back();
+            }
+        }
+    }
+
+    /**
+     * @param colors the number of coefficient matrices, 1 for a single method
+     *
+     * @return all rooted trees with at most maxOrder nodes (1205 for order 10), sorted by their number of nodes
+     */
+    inline std::vector<Tree> trees(unsigned int maxOrder, unsigned int colors = 1){
+        std::vector<Tree> result = {{1, 1, {}}};
+        for(unsigned int order = 2; order <= maxOrder; order++){
+            std::vector<std::vector<std::size_t>> children;
+            std::vector<std::size_t> current;
+            subtrees(result, colors, order - 1, result.size()*colors - 1, current, children);
+            for(const std::vector<std::size_t> &c : children){
+                double density = order;
+                for(std::size_t child : c){
+                    density *= result[child/colors].density;
+                }
+                result.push_back({order, density, c});
+            }
+        }
+        return result;
+    }
+
+    /**
+     * @param A the coefficient matrices, one per color of the trees
+     *
+     * @return Phi(t) of the stages for all trees
+     */
+    inline std::vector<Eigen::VectorXd> elementaryWeights(const std::vector<Tree> &trees, const std::vector<Eigen::MatrixXd> &A){
+        std::vector<Eigen::VectorXd> phi;
+        // A Phi(t) for every color, the stage values of the derivatives of the subtrees
+        std::vector<Eigen::VectorXd> APhi;
+        for(const Tree &tree : trees){
+            Eigen::VectorXd weights = Eigen::VectorXd::Ones(A[0].rows());
+            for(std::size_t child : tree.children){
+                weights = weights.cwiseProduct(APhi[child]);
+            }
+            for(const Eigen::MatrixXd &coefficients : A){
+                APhi.push_back(coefficients*weights);
+            }
+            phi.push_back(weights);
+        }
+        return phi;
+    }
+
+    /**
+     * The residuals of the order conditions are compared relative to sum_i |b_i Phi_i(t)|, such that round off of large
+     * coefficients does not count
+     *
+     * @param phi the elementary weights of the stages, see elementaryWeights
+     * @param b the weights of the stages
+     * @param theta the point of the dense output, 1 for the step itself
+     * @param tolerance the largest relative residual of a satisfied condition
+     *
+     * @return the largest p such that all conditions up to order p are satisfied
+     */
+    inline unsigned int order(const std::vector<Tree> &trees, const std::vector<Eigen::VectorXd> &phi, const Eigen::VectorXd &b,
+                              double theta = 1, double tolerance = 1e-12){
+        for(std::size_t i = 0; i < trees.size(); i++){
+            const double residual = b.dot(phi[i]) - std::pow(theta, trees[i].order)/trees[i].density;
+            const double scale = b.cwiseAbs().dot(phi[i].cwiseAbs()) + std::pow(theta, trees[i].order)/trees[i].density;
+            if(std::abs(residual) > tolerance*scale){
+                return trees[i].order - 1;
+            }
+        }
+        return trees.back().order;
+    }
+
+}
+
+
+
+
+#endif
@@ -0,0 +1,190 @@
+/**
+ *
+ * Regression checks of the sensitivities, see README.md.
+ *
+ * The sensitivities of the forward sensitivity integrator are the exact derivatives of the computed solution, hence they must
+ * agree with central finite differences of the same method with the same steps up to the error of the differences. The same
+ * holds for the gradients of the discrete adjoint, which also agree with the forward sensitivities and do not depend on the
+ * number of checkpoints. The program fails (exit code 1) if a check fails.
+ *
+ */
+
+
+
+#include <iostream>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <Eigen/Dense>
+#include "../src/rk_adjoint.hpp"
+#include "../src/rk_sensitivity.hpp"
+#include "../src/rk_solvers.hpp"
+#include "../src/rk_trajectory.hpp"
+#include "check.hpp"
+
+
+
+// the step of the central finite differences and the largest relative difference to them
+const double differenceStep = 1e-5;
+const double differenceTolerance = 1e-6;
+
+
+/**
+ * The Lotka-Volterra equations y1' = p1 y1 - p2 y1 y2, y2' = p2 y1 y2 - p3 y2 with the parameters p
+ */
+struct LotkaVolterra {
+    Eigen::Vector3d p;
+
+    Eigen::VectorXd f(const Eigen::VectorXd &y) const {
+        return Eigen::Vector2d(p(0)*y(0) - p(1)*y(0)*y(1), p(1)*y(0)*y(1) - p(2)*y(1));
+    }
+
+    Eigen::MatrixXd fy(const Eigen::VectorXd &y) const {
+        Eigen::MatrixXd jacobian(2, 2);
+        jacobian << p(0) - p(1)*y(1), -p(1)*y(0),
+                    p(1)*y(1), p(1)*y(0) - p(2);
+        return jacobian;
+    }
+
+    Eigen::MatrixXd fp(const Eigen::VectorXd &y) const {
+        Eigen::MatrixXd jacobian(2, 3);
+        jacobian << y(0), -y(0)*y(1), 0,
+                    0, y(0)*y(1), -y(1);
+        return jacobian;
+    }
+
+    static Eigen::Vector3d parameters(){
+        return Eigen::Vector3d(1.5, 1, 3);
+    }
+
+    static Eigen::VectorXd y0(){
+        return Eigen::Vector2d(1, 1);
+    }
+};
+
+
+/**
+ * Solves the Lotka-Volterra equations with the forward sensitivity integrator
+ *
+ * @return the final state and the final sensitivities dy/dp
+ */
+std::pair<Eigen::VectorXd, Eigen::MatrixXd> forwardSolve(ForwardSensitivityIntegrator<> &integrator, const Eigen::Vector3d &p, double time,
+                                                         const Eigen::VectorXd &y0, unsigned int steps){
+    const LotkaVolterra problem{p};
+    Trajectory states, sensitivities;
+    integrator.solve([&] (const Eigen::VectorXd &y) { return problem.f(y); }, [&] (const Eigen::VectorXd &y) { return problem.fy(y); },
+                     [&] (const Eigen::VectorXd &y) { return problem.fp(y); }, time, y0, Eigen::MatrixXd::Zero(2, 3), steps, states, sensitivities);
+    return {states.back(), Eigen::Map<const Eigen::MatrixXd>(sensitivities.back().data(), 2, 3)};
+}
+
+
+/**
+ * Compares the forward sensitivities of an explicit and an implicit method (in both modes) with finite differences
+ *
+ * @return false if the sensitivities differ from the finite differences
+ */
+bool forwardSensitivities(){
+
+    const double time = 5;
+    const unsigned int steps = 200;
+    const Eigen::Vector3d p = LotkaVolterra::parameters();
+
+    // explicit methods ignore the mode
+    const std::vector<std::tuple<ButcherTableau, SensitivityMode, std::string>> methods = {
+        {ExplicitRKTableaus::classical4thOrder(), SensitivityMode::Staggered, ""},
+        {ImplicitRKTableaus::radauRKSSM5(), SensitivityMode::Staggered, ", staggered"},
+        {ImplicitRKTableaus::radauRKSSM5(), SensitivityMode::Simultaneous, ", simultaneous"}
+    };
+    bool success = true;
+    for(const auto &method : methods){
+        ForwardSensitivityIntegrator<> integrator(std::get<0>(method), std::get<1>(method));
+        const Eigen::MatrixXd S = forwardSolve(integrator, p, time, LotkaVolterra::y0(), steps).second;
+
+        Eigen::MatrixXd differences(2, 3);
+        for(unsigned int j = 0; j < 3; j++){
+            const Eigen::Vector3d dp = differenceStep*Eigen::Vector3d::Unit(j);
+            differences.col(j) = (forwardSolve(integrator, p + dp, time, LotkaVolterra::y0(), steps).first
+                                  - forwardSolve(integrator, p - dp, time, LotkaVolterra::y0(), steps).first)/(2*differenceStep);
+        }
+        const std::string name = std::get<0>(method).name + std::get<2>(method);
+        success = Check::report(name + ": dy/dp against differences", (S - differences).norm()/differences.norm(), 0, differenceTolerance) && success;
+    }
+    return success;
+}
+
+
+/**
+ * Compares the gradients of the objective |y(T)|^2 computed with the adjoint with the forward sensitivities and with finite
+ * differences, for several numbers of checkpoints
+ *
+ * @return false if the gradients differ
+ */
+bool adjointSensitivities(){
+
+    const double time = 5;
+    const unsigned int steps = 200;
+    const Eigen::Vector3d p = LotkaVolterra::parameters();
+    const Eigen::VectorXd y0 = LotkaVolterra::y0();
+    const LotkaVolterra problem{p};
+    auto f = [&] (const Eigen::VectorXd &y) { return problem.f(y); };
+    auto fy = [&] (const Eigen::VectorXd &y) { return problem.fy(y); };
+    auto fp = [&] (const Eigen::VectorXd &y) { return problem.fp(y); };
+    auto dg = [] (const Eigen::VectorXd &y) -> Eigen::VectorXd { return 2*y; };
+
+    bool success = true;
+    for(const ButcherTableau &tableau : {ExplicitRKTableaus::classical4thOrder(), ImplicitRKTableaus::radauRKSSM5()}){
+        AdjointSensitivityIntegrator<> adjoint(tableau);
+        const Eigen::VectorXd gradient = adjoint.gradient(f, fy, fp, dg, time, y0, steps);
+        const Eigen::VectorXd initialGradient = adjoint.initialAdjoint();
+
+        ForwardSensitivityIntegrator<> forward(tableau);
+        const std::pair<Eigen::VectorXd, Eigen::MatrixXd> solution = forwardSolve(forward, p, time, y0, steps);
+        const Eigen::VectorXd forwardGradient = solution.second.transpose()*dg(solution.first);
+        success = Check::report(tableau.name + ": adjoint against forward", (gradient - forwardGradient).norm()/forwardGradient.norm(), 0, 1e-10) && success;
+
+        Eigen::VectorXd differences(3);
+        for(unsigned int j = 0; j < 3; j++){
+            const Eigen::Vector3d dp = differenceStep*Eigen::Vector3d::Unit(j);
+            differences(j) = (forwardSolve(forward, p + dp, time, y0, steps).first.squaredNorm()
+                              - forwardSolve(forward, p - dp, time, y0, steps).first.squaredNorm())/(2*differenceStep);
+        }
+        success = Check::report(tableau.name + ": adjoint against differences", (gradient - differences).norm()/differences.norm(), 0, differenceTolerance) && success;
+
+        Eigen::VectorXd initialDifferences(2);
+        for(unsigned int j = 0; j < 2; j++){
+            const Eigen::VectorXd dy0 = differenceStep*Eigen::Vector2d::Unit(j);
+            initialDifferences(j) = (forwardSolve(forward, p, time, y0 + dy0, steps).first.squaredNorm()
+                                     - forwardSolve(forward, p, time, y0 - dy0, steps).first.squaredNorm())/(2*differenceStep);
+        }
+        success = Check::report(tableau.name + ": dg/dy0 against differences", (initialGradient - initialDifferences).norm()/initialDifferences.norm(),
+                                0, differenceTolerance) && success;
+
+        // the checkpoints only decide which steps are recomputed, the default is log2(steps)
+        for(unsigned int checkpoints : {1, 3, 199}){
+            AdjointSensitivityIntegrator<> checkpointed(tableau, checkpoints);
+            const Eigen::VectorXd checkpointedGradient = checkpointed.gradient(f, fy, fp, dg, time, y0, steps);
+            success = Check::report(tableau.name + ": checkpoints " + std::to_string(checkpoints) + " against log2(steps)",
+                                    (checkpointedGradient - gradient).norm(), 0, 0) && success;
+        }
+    }
+    return success;
+}
+
+
+int main() {
+
+    /**
+     * Usage: sensitivities
+     */
+
+    Check::header();
+
+    bool success = true;
+    success = forwardSensitivities() && success;
+    success = adjointSensitivities() && success;
+
+    return Check::summary(success, "sensitivities");
+
+}
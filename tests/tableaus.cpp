@@ -0,0 +1,231 @@
+/**
+ *
+ * Regression checks of the coefficients of the built-in methods, see README.md.
+ *
+ * The orders of the embedded pairs (the propagated method, the error estimators and the dense output) are computed from the
+ * order conditions over all rooted trees up to order 10 and compared to the documented ones, exactly: a method of a higher
+ * order than documented fails as well, e.g. if the error estimate vanishes. The program fails (exit code 1) if a check fails.
+ *
+ */
+
+
+
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <Eigen/Dense>
+#include "../src/rk_chebyshev.hpp"
+#include "../src/rk_solvers.hpp"
+#include "check.hpp"
+#include "order_conditions.hpp"
+
+
+
+// the documented orders of an embedded pair, 0 if there is no second estimator
+struct EmbeddedOrders {
+    EmbeddedButcherTableau tableau;
+    unsigned int order;
+    unsigned int estimator;
+    unsigned int estimator2;
+    unsigned int dense;
+};
+
+
+/**
+ * Checks the orders of all EmbeddedRKTableaus
+ *
+ * @return false if an order differs from the documented one
+ */
+bool embeddedTableaus(const std::vector<OrderConditions::Tree> &trees){
+
+    const std::vector<EmbeddedOrders> pairs = {
+        {EmbeddedRKTableaus::bogackiShampine32(), 3, 2, 0, 3},
+        {EmbeddedRKTableaus::dormandPrince54(), 5, 4, 0, 4},
+        {EmbeddedRKTableaus::dop853(), 8, 5, 3, 7},
+        {EmbeddedRKTableaus::verner65(), 6, 5, 0, 5},
+        {EmbeddedRKTableaus::verner76(), 7, 6, 0, 6},
+        {EmbeddedRKTableaus::verner87(), 8, 7, 0, 7},
+        {EmbeddedRKTableaus::verner98(), 9, 8, 0, 8}
+    };
+
+    bool success = Check::report("EmbeddedRKTableaus::all() is checked", EmbeddedRKTableaus::all().size(), pairs.size(), 0);
+    for(const EmbeddedOrders &pair : pairs){
+        const EmbeddedButcherTableau &tableau = pair.tableau;
+        const Eigen::Index s = tableau.b.size();
+
+        // the stages of the step, f(y1) and the extra stages of the dense output
+        const Eigen::Index stages = s + 1 + tableau.denseA.rows();
+        Eigen::MatrixXd A = Eigen::MatrixXd::Zero(stages, stages);
+        A.topLeftCorner(s, s) = tableau.A;
+        A.block(s, 0, 1, s) = tableau.b.transpose();
+        if(tableau.denseA.rows() != 0){
+            A.bottomRows(tableau.denseA.rows()) = tableau.denseA;
+        }
+        const std::vector<Eigen::VectorXd> phi = OrderConditions::elementaryWeights(trees, {A});
+
+        Eigen::VectorXd b = Eigen::VectorXd::Zero(stages);
+        b.head(s) = tableau.b;
+        success = Check::report(tableau.name + ": order", OrderConditions::order(trees, phi, b), pair.order, 0) && success;
+
+        // b + e is the embedded method (up to the sign of e)
+        Eigen::VectorXd embedded = b;
+        embedded.head(s + 1) += tableau.e;
+        success = Check::report(tableau.name + ": estimator order", OrderConditions::order(trees, phi, embedded), pair.estimator, 0) && success;
+        if(tableau.e2.size() != 0){
+            embedded = b;
+            embedded.head(s + 1) += tableau.e2;
+            success = Check::report(tableau.name + ": second estimator order", OrderConditions::order(trees, phi, embedded), pair.estimator2, 0) && success;
+        }
+
+        for(double theta : {0.3, 0.7}){
+            Eigen::VectorXd dense = Eigen::VectorXd::Zero(stages);
+            for(Eigen::Index i = 0; i < tableau.P.rows(); i++){
+                for(Eigen::Index p = 0; p < tableau.P.cols(); p++){
+                    dense(i) += tableau.P(i, p)*std::pow(theta, p + 1);
+                }
+            }
+            success = Check::report(tableau.name + ": dense order at " + std::to_string(theta).substr(0, 3),
+                                    OrderConditions::order(trees, phi, dense, theta), pair.dense, 0) && success;
+        }
+    }
+    return success;
+}
+
+
+/**
+ * Checks the orders of all IMEXTableaus, of both methods on their own and with the coupling conditions
+ *
+ * @return false if an order differs from the documented one
+ */
+bool imexTableaus(const std::vector<OrderConditions::Tree> &trees){
+
+    // trees with nodes for the explicit and the implicit part
+    const std::vector<OrderConditions::Tree> coloredTrees = OrderConditions::trees(6, 2);
+
+    bool success = true;
+    for(const AdditiveButcherTableau &tableau : IMEXTableaus::all()){
+        const std::vector<Eigen::VectorXd> explicitPhi = OrderConditions::elementaryWeights(trees, {tableau.AE});
+        const std::vector<Eigen::VectorXd> implicitPhi = OrderConditions::elementaryWeights(trees, {tableau.AI});
+        const std::vector<Eigen::VectorXd> phi = OrderConditions::elementaryWeights(coloredTrees, {tableau.AE, tableau.AI});
+
+        success = Check::report(tableau.name + ": explicit order", OrderConditions::order(trees, explicitPhi, tableau.b), tableau.order, 0) && success;
+        success = Check::report(tableau.name + ": implicit order", OrderConditions::order(trees, implicitPhi, tableau.b), tableau.order, 0) && success;
+        success = Check::report(tableau.name + ": coupled order", OrderConditions::order(coloredTrees, phi, tableau.b), tableau.order, 0) && success;
+        if(tableau.e.size() != 0){
+            const Eigen::VectorXd embedded = tableau.b + tableau.e;
+            success = Check::report(tableau.name + ": coupled estimator order", OrderConditions::order(coloredTrees, phi, embedded),
+                                    tableau.estimatorOrder, 0) && success;
+        }
+    }
+    return success;
+}
+
+
+/**
+ * The stability function R(z) of a degree of ROCK2 or ROCK4, the result of one step of y' = z y from y0 = 1 with h = 1
+ *
+ * @param one the value 1, a number or a truncated power series in z
+ * @param z multiplies a value with z
+ */
+template<typename Value, typename Multiply>
+Value stabilityFunction(const OrthogonalChebyshev::Method &method, unsigned int order, const Value &one, Multiply &&z){
+
+    // the stages of P, nu_0 = 0
+    Value previous = one;
+    Value g = one;
+    for(std::size_t j = 0; j < method.mu.size(); j++){
+        const Value next = method.mu[j]*g + method.nu[j]*previous + method.kappa[j]*z(g);
+        previous = g;
+        g = next;
+    }
+
+    if(order == 2){
+        const Value stage = g + method.sigma*z(g);
+        return stage + method.sigma*z(stage) - method.sigma*(1 - method.tau/(method.sigma*method.sigma))*(z(stage) - z(g));
+    }
+    std::array<Value, 4> k;
+    Value y1 = g;
+    for(unsigned int i = 0; i < 4; i++){
+        Value stage = g;
+        for(unsigned int j = 0; j < i; j++){
+            stage += method.A(i,j)*k[j];
+        }
+        k[i] = z(stage);
+    }
+    for(unsigned int i = 0; i < 4; i++){
+        y1 += method.b(i)*k[i];
+    }
+    return y1;
+}
+
+
+/**
+ * Checks the stability polynomials of all degrees of ROCK2 and ROCK4: R must agree with exp(z) up to z^order and stay
+ * within [-1, 1] on the stability interval [-length, 0]
+ *
+ * @return false if a degree violates its order or stability interval
+ */
+bool chebyshevTables(){
+
+    typedef Eigen::Matrix<double, 6, 1> Series;
+    auto seriesTimesZ = [] (const Series &series) {
+        Series shifted = Series::Zero();
+        shifted.tail<5>() = series.head<5>();
+        return shifted;
+    };
+
+    bool success = true;
+    for(unsigned int order : {2, 4}){
+        const std::string name = "ROCK" + std::to_string(order);
+        const std::vector<OrthogonalChebyshev::Method> methods = OrthogonalChebyshev::methods(order, 250);
+
+        // the largest relative error of the Taylor coefficients and the largest |R|, over all degrees
+        double taylorError = 0;
+        double largest = 0;
+        for(const OrthogonalChebyshev::Method &method : methods){
+            const Series R = stabilityFunction(method, order, Series(Series::Unit(0)), seriesTimesZ);
+            double factorial = 1;
+            for(unsigned int k = 0; k <= order; k++){
+                factorial *= std::max(k, 1u);
+                taylorError = std::max(taylorError, std::abs(R(k)*factorial - 1));
+            }
+
+            // about 20 points between the extrema of R
+            const unsigned int points = 20*method.stages;
+            for(unsigned int i = 0; i <= points; i++){
+                const double x = -method.length*i/points;
+                largest = std::max(largest, std::abs(stabilityFunction(method, order, 1.0, [x] (double value) { return x*value; })));
+            }
+        }
+        success = Check::report(name + ": degrees up to 250 stages", methods.back().stages, 250, 10) && success;
+        success = Check::report(name + ": error of the Taylor coefficients of R", taylorError, 0, 1e-10) && success;
+        success = Check::report(name + ": largest |R| on the stability intervals", largest, 0, 1 + 1e-9) && success;
+        // the documented length of the stability interval
+        const double length = methods.back().length/(methods.back().stages*methods.back().stages);
+        success = Check::report(name + ": stability interval over stages^2", length, order == 2 ? 0.82 : 0.35, 0.01) && success;
+    }
+    return success;
+}
+
+
+int main() {
+
+    /**
+     * Usage: tableaus
+     */
+
+    Check::header();
+
+    const std::vector<OrderConditions::Tree> trees = OrderConditions::trees(10);
+
+    bool success = true;
+    success = embeddedTableaus(trees) && success;
+    success = imexTableaus(trees) && success;
+    success = chebyshevTables() && success;
+
+    return Check::summary(success, "tableaus");
+
+}
@@ -4,6 +4,7 @@
 #include <Eigen/Dense>
 #include "src/rk_implementer.hpp"
 #include "src/rk_solvers.hpp"
+#include "src/rk_trajectory.hpp"
 
 
 int main() {
@@ -36,7 +37,7 @@ int main() {
 
   std::cout << "The classical 4th order Runge-Kutta method gives us" << y1Vec.back().transpose() << std::endl;
 
-  for(int i = 0; i < y1Vec.size(); i++){
+  for(std::size_t i = 0; i < y1Vec.size(); i++){
     std::cout << y1Vec.at(i).transpose() << " \n";
   }
 
@@ -55,6 +56,15 @@ int main() {
   std::vector<Eigen::VectorXd> y2Vec = Solver.solve(f,2,y0,10);
 
   std::cout << "SSPRK3 3rd order Runge-Kutta method gives us = " << y2Vec[10].transpose() << std::endl;
+
+  /**
+   * Store all states in one contiguous matrix instead of a std::vector:
+   */
+
+  Trajectory trajectory;
+  Solver.solve(f,2,y0,10,trajectory);
+
+  std::cout << "The prey population over time is " << trajectory.row(0) << std::endl;
   
 }
 